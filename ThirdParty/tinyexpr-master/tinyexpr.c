@@ -22,6 +22,11 @@
  * 3. This notice may not be removed or altered from any source distribution.
  */
 
+/*
+ * Altered for MultiDiner: flat postfix programs (te_lower, te_run, te_run_batch,
+ * te_program_free) were added at the end of the evaluation section.
+ */
+
 /* COMPILE TIME OPTIONS */
 
 /* Exponentiation associativity:
@@ -584,6 +589,250 @@ double te_interp(const char *expression, int *error) {
     return ret;
 }
 
+/* Flat programs: the tree in postfix order, arithmetic operators get their own opcodes. */
+
+enum {
+    OP_CONSTANT, OP_VARIABLE,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_NEGATE,
+    OP_FUNCTION, OP_CLOSURE
+};
+
+#define TE_BLOCK 64
+
+typedef struct te_instruction {
+    int op;
+    int arity;
+    union {double value; const double *bound; const void *function;};
+    void *context;
+} te_instruction;
+
+struct te_program {
+    int count;
+    int depth;
+    te_instruction code[1];
+};
+
+
+static int count_nodes(const te_expr *n) {
+    int i, count = 1;
+    const int arity = ARITY(n->type);
+    for (i = 0; i < arity; ++i) {
+        count += count_nodes(n->parameters[i]);
+    }
+    return count;
+}
+
+
+/* Writes code of n starting at p->code[*pos], returns stack depth needed by n. */
+static int lower(const te_expr *n, te_program *p, int *pos) {
+    const int arity = ARITY(n->type);
+    int i, depth = 1;
+    te_instruction *ins;
+
+    /* Parameter i is evaluated while i values are already on the stack. */
+    for (i = 0; i < arity; ++i) {
+        const int d = lower(n->parameters[i], p, pos) + i;
+        if (d > depth) depth = d;
+    }
+
+    ins = &p->code[(*pos)++];
+    ins->arity = arity;
+    ins->context = 0;
+
+    switch(TYPE_MASK(n->type)) {
+        case TE_CONSTANT: ins->op = OP_CONSTANT; ins->value = n->value; break;
+        case TE_VARIABLE: ins->op = OP_VARIABLE; ins->bound = n->bound; break;
+
+        case TE_FUNCTION0: case TE_FUNCTION1: case TE_FUNCTION2: case TE_FUNCTION3:
+        case TE_FUNCTION4: case TE_FUNCTION5: case TE_FUNCTION6: case TE_FUNCTION7:
+            ins->op = OP_FUNCTION;
+            ins->function = n->function;
+            if (arity == 2 && n->function == (const void*)add) ins->op = OP_ADD;
+            if (arity == 2 && n->function == (const void*)sub) ins->op = OP_SUB;
+            if (arity == 2 && n->function == (const void*)mul) ins->op = OP_MUL;
+            if (arity == 2 && n->function == (const void*)divide) ins->op = OP_DIV;
+            if (arity == 1 && n->function == (const void*)negate) ins->op = OP_NEGATE;
+            break;
+
+        case TE_CLOSURE0: case TE_CLOSURE1: case TE_CLOSURE2: case TE_CLOSURE3:
+        case TE_CLOSURE4: case TE_CLOSURE5: case TE_CLOSURE6: case TE_CLOSURE7:
+            ins->op = OP_CLOSURE;
+            ins->function = n->function;
+            ins->context = n->parameters[arity];
+            break;
+
+        default: return -1;
+    }
+
+    return depth;
+}
+
+
+te_program *te_lower(const te_expr *n) {
+    int count, pos = 0;
+    te_program *p;
+
+    if (!n) return 0;
+
+    count = count_nodes(n);
+    p = malloc(sizeof(te_program) + sizeof(te_instruction) * (count - 1));
+    if (!p) return 0;
+
+    p->count = count;
+    p->depth = lower(n, p, &pos);
+    if (p->depth < 0) {
+        free(p);
+        return 0;
+    }
+    return p;
+}
+
+
+#define TE_FUN(...) ((double(*)(__VA_ARGS__))ins->function)
+#define A(e) (args[e])
+
+static double call(const te_instruction *ins, const double *args) {
+    if (ins->op == OP_FUNCTION) {
+        switch(ins->arity) {
+            case 0: return TE_FUN(void)();
+            case 1: return TE_FUN(double)(A(0));
+            case 2: return TE_FUN(double, double)(A(0), A(1));
+            case 3: return TE_FUN(double, double, double)(A(0), A(1), A(2));
+            case 4: return TE_FUN(double, double, double, double)(A(0), A(1), A(2), A(3));
+            case 5: return TE_FUN(double, double, double, double, double)(A(0), A(1), A(2), A(3), A(4));
+            case 6: return TE_FUN(double, double, double, double, double, double)(A(0), A(1), A(2), A(3), A(4), A(5));
+            case 7: return TE_FUN(double, double, double, double, double, double, double)(A(0), A(1), A(2), A(3), A(4), A(5), A(6));
+            default: return NAN;
+        }
+    } else {
+        switch(ins->arity) {
+            case 0: return TE_FUN(void*)(ins->context);
+            case 1: return TE_FUN(void*, double)(ins->context, A(0));
+            case 2: return TE_FUN(void*, double, double)(ins->context, A(0), A(1));
+            case 3: return TE_FUN(void*, double, double, double)(ins->context, A(0), A(1), A(2));
+            case 4: return TE_FUN(void*, double, double, double, double)(ins->context, A(0), A(1), A(2), A(3));
+            case 5: return TE_FUN(void*, double, double, double, double, double)(ins->context, A(0), A(1), A(2), A(3), A(4));
+            case 6: return TE_FUN(void*, double, double, double, double, double, double)(ins->context, A(0), A(1), A(2), A(3), A(4), A(5));
+            case 7: return TE_FUN(void*, double, double, double, double, double, double, double)(ins->context, A(0), A(1), A(2), A(3), A(4), A(5), A(6));
+            default: return NAN;
+        }
+    }
+}
+
+#undef TE_FUN
+#undef A
+
+
+double te_run(const te_program *p) {
+    double small[16];
+    double *stack = small;
+    double ret;
+    int i, sp = 0;
+
+    if (!p) return NAN;
+    if (p->depth > 16) {
+        stack = malloc(sizeof(double) * p->depth);
+        if (!stack) return NAN;
+    }
+
+    for (i = 0; i < p->count; ++i) {
+        const te_instruction *ins = &p->code[i];
+        switch(ins->op) {
+            case OP_CONSTANT: stack[sp++] = ins->value; break;
+            case OP_VARIABLE: stack[sp++] = *ins->bound; break;
+            case OP_ADD: --sp; stack[sp-1] = stack[sp-1] + stack[sp]; break;
+            case OP_SUB: --sp; stack[sp-1] = stack[sp-1] - stack[sp]; break;
+            case OP_MUL: --sp; stack[sp-1] = stack[sp-1] * stack[sp]; break;
+            case OP_DIV: --sp; stack[sp-1] = stack[sp-1] / stack[sp]; break;
+            case OP_NEGATE: stack[sp-1] = -stack[sp-1]; break;
+            default:
+                sp -= ins->arity;
+                stack[sp] = call(ins, stack + sp);
+                ++sp;
+        }
+    }
+
+    /* an empty program leaves nothing on the stack */
+    ret = sp > 0 ? stack[sp-1] : NAN;
+    if (stack != small) free(stack);
+    return ret;
+}
+
+
+void te_run_batch(const te_program *p, const double *const *bindings, const double *const *columns,
+                  int columns_count, int count, double *results) {
+    /* Every stack slot holds a block of TE_BLOCK rows, each opcode runs over the whole block. */
+    double *stack;
+    double args[7];
+    int begin, i, j, k;
+
+    if (!p) {
+        for (i = 0; i < count; ++i) results[i] = NAN;
+        return;
+    }
+
+    stack = malloc(sizeof(double) * TE_BLOCK * p->depth);
+    if (!stack) {
+        for (i = 0; i < count; ++i) results[i] = NAN;
+        return;
+    }
+
+    for (begin = 0; begin < count; begin += TE_BLOCK) {
+        const int size = (count - begin < TE_BLOCK) ? count - begin : TE_BLOCK;
+        int sp = 0;
+
+        for (i = 0; i < p->count; ++i) {
+            const te_instruction *ins = &p->code[i];
+            double *top = stack + TE_BLOCK * (sp > 0 ? sp - 1 : 0);
+            double *next = stack + TE_BLOCK * sp;
+            const double *column = 0;
+
+            switch(ins->op) {
+                case OP_CONSTANT:
+                    for (k = 0; k < size; ++k) next[k] = ins->value;
+                    ++sp;
+                    break;
+
+                case OP_VARIABLE:
+                    for (j = 0; j < columns_count; ++j) {
+                        if (bindings[j] == ins->bound) column = columns[j] + begin;
+                    }
+                    if (column) {
+                        for (k = 0; k < size; ++k) next[k] = column[k];
+                    } else {
+                        for (k = 0; k < size; ++k) next[k] = *ins->bound;
+                    }
+                    ++sp;
+                    break;
+
+                case OP_ADD: for (k = 0; k < size; ++k) top[k - TE_BLOCK] = top[k - TE_BLOCK] + top[k]; --sp; break;
+                case OP_SUB: for (k = 0; k < size; ++k) top[k - TE_BLOCK] = top[k - TE_BLOCK] - top[k]; --sp; break;
+                case OP_MUL: for (k = 0; k < size; ++k) top[k - TE_BLOCK] = top[k - TE_BLOCK] * top[k]; --sp; break;
+                case OP_DIV: for (k = 0; k < size; ++k) top[k - TE_BLOCK] = top[k - TE_BLOCK] / top[k]; --sp; break;
+                case OP_NEGATE: for (k = 0; k < size; ++k) top[k] = -top[k]; break;
+
+                default:
+                    sp -= ins->arity;
+                    for (k = 0; k < size; ++k) {
+                        for (j = 0; j < ins->arity; ++j) args[j] = stack[TE_BLOCK * (sp + j) + k];
+                        stack[TE_BLOCK * sp + k] = call(ins, args);
+                    }
+                    ++sp;
+            }
+        }
+
+        for (k = 0; k < size; ++k) results[begin + k] = stack[k];
+    }
+
+    free(stack);
+}
+
+
+void te_program_free(te_program *p) {
+    free(p);
+}
+
+
 static void pn (const te_expr *n, int depth) {
     int i, arity;
     printf("%*s", depth, "");
@@ -22,6 +22,11 @@
  * 3. This notice may not be removed or altered from any source distribution.
  */
 
+/*
+ * Altered for MultiDiner: flat postfix programs (te_lower, te_run, te_run_batch,
+ * te_program_free) were added. The original API is unchanged.
+ */
+
 #ifndef __TINYEXPR_H__
 #define __TINYEXPR_H__
 
@@ -79,6 +84,27 @@ void te_print(const te_expr *n);
 void te_free(te_expr *n);
 
 
+/* Expression lowered into contiguous postfix code evaluated on a value stack. */
+typedef struct te_program te_program;
+
+/* Lowers the syntax tree, the tree may be freed afterwards. */
+/* Variables stay bound to the same addresses. Returns NULL on error. */
+te_program *te_lower(const te_expr *n);
+
+/* Evaluates the program, gives the same result as te_eval on the tree. */
+double te_run(const te_program *p);
+
+/* Evaluates the program count times, a block of rows at a time. */
+/* For run i the variable bound to bindings[j] takes columns[j][i], */
+/* other variables are read from their bound addresses. */
+void te_run_batch(const te_program *p, const double *const *bindings, const double *const *columns,
+                  int columns_count, int count, double *results);
+
+/* Frees the program. */
+/* This is safe to call on NULL pointers. */
+void te_program_free(te_program *p);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui svg
+QT       += core gui svg concurrent
 CONFIG -= console
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -14,6 +14,11 @@ TEMPLATE = app
 CONFIG -= debug_and_release debug_and_release_target
 #CONFIG += c++11
 
+# operation counters and timers, qmake CONFIG+=mg_stats
+CONFIG(mg_stats) {
+    DEFINES += MG_ENABLE_STATS
+}
+
 # The following define makes your compiler emit warnings if you use
 # any feature of Qt which as been marked as deprecated (the exact warnings
 # depend on your compiler). Please consult the documentation of the
@@ -28,13 +33,35 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += main.cpp\
         mainwindow.cpp \
+    graphrenderer.cpp \
     mgexception.cpp \
+    expressioncache.cpp \
+    money.cpp \
+    csvimporter.cpp \
+    statspanel.cpp \
+    tracer.cpp \
     ../ThirdParty/tinyexpr-master/tinyexpr.c
 
 HEADERS  += mainwindow.h \
+    graphrenderer.h \
+    components.h \
     edge.h \
     multigraph.h \
+    dotwriter.h \
+    threadpool.h \
     mgexception.h \
+    mgstats.h \
+    statspanel.h \
+    tracer.h \
+    status.h \
+    expressioncache.h \
+    money.h \
+    csvimporter.h \
+    groupexpense.h \
+    mutation.h \
+    undohistory.h \
+    balance.h \
+    reduction.h \
     wheelevent_forqsceneview.h \
     ../ThirdParty/tinyexpr-master/tinyexpr.h \
     vertex.h
@@ -0,0 +1,105 @@
+#ifndef BALANCE_H
+#define BALANCE_H
+
+#include "multigraph.h"
+#include "money.h"
+
+#include <vector>
+#include <unordered_map>
+
+namespace mg
+{
+  /// Net balance of every vertex of @param graph in order of getVertexes():
+  /// lent minus borrowed, edges and debts derived from group expenses are both counted
+  template<typename V, typename E>
+  std::vector<E> balances(const Multigraph<V, E>& graph);
+
+  /// Integer kernel for Money: minor units are added up in int64_t, the result is exact and
+  /// doesn't depend on the order of the edges; vertex positions are looked up only for group expenses
+  template<typename V>
+  std::vector<Money> balances(const Multigraph<V, Money>& graph);
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename V, typename E>
+  std::vector<E> balances(const Multigraph<V, E>& graph)
+  {
+    const auto& vertexes = graph.getVertexes();
+    std::vector<E> result(vertexes.size(), E());
+
+    std::unordered_map<const Vertex<V, E>*, size_t> positions;
+    positions.reserve(vertexes.size());
+    size_t position = 0;
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i, ++position)
+    {
+      positions[*i] = position;
+      const auto& outgoingEdges = (*i)->getOutgoingEdges();
+      for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+        result[position] = result[position] + (*j)->getValue();
+
+      const auto& incomingEdges = (*i)->getIncomingEdges();
+      for(auto j = incomingEdges.begin(); j != incomingEdges.end(); ++j)
+        result[position] = result[position] - (*j)->getValue();
+    }
+
+    const auto& groupExpenses = graph.getGroupExpenses();
+    for(auto i = groupExpenses.begin(); i != groupExpenses.end(); ++i)
+    {
+      i->forEachDebt([&](const Vertex<V, E>* payer, const Vertex<V, E>* participant, const E& amount)
+      {
+        E& lent = result[positions[payer]];
+        E& borrowed = result[positions[participant]];
+        lent = lent + amount;
+        borrowed = borrowed - amount;
+      });
+    }
+    return result;
+  }
+
+  template<typename V>
+  std::vector<Money> balances(const Multigraph<V, Money>& graph)
+  {
+    const auto& vertexes = graph.getVertexes();
+    std::vector<Money> result(vertexes.size());
+
+    size_t position = 0;
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i, ++position)
+    {
+      int64_t balance = 0;
+      const auto& outgoingEdges = (*i)->getOutgoingEdges();
+      for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+        balance += (*j)->getValue().getMinor();
+
+      const auto& incomingEdges = (*i)->getIncomingEdges();
+      for(auto j = incomingEdges.begin(); j != incomingEdges.end(); ++j)
+        balance -= (*j)->getValue().getMinor();
+      result[position] = Money::fromMinor(balance);
+    }
+
+    const auto& groupExpenses = graph.getGroupExpenses();
+    if(groupExpenses.empty())
+      return result;
+
+    std::unordered_map<const Vertex<V, Money>*, size_t> positions;
+    positions.reserve(vertexes.size());
+    position = 0;
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i, ++position)
+      positions[*i] = position;
+    for(auto i = groupExpenses.begin(); i != groupExpenses.end(); ++i)
+    {
+      i->forEachDebt([&](const Vertex<V, Money>* payer, const Vertex<V, Money>* participant, const Money& amount)
+      {
+        result[positions[payer]] += amount;
+        result[positions[participant]] -= amount;
+      });
+    }
+    return result;
+  }
+
+} // end of namespace
+
+#endif // BALANCE_H
@@ -0,0 +1,241 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include "multigraph.h"
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+namespace mg
+{
+  /// Disjoint set union with path compression and union by rank,
+  /// every operation runs in amortized inverse Ackermann time
+  class DisjointSet
+  {
+  public:
+    explicit DisjointSet(size_t size = 0);
+
+    /// Adds a new singleton set, returns its element
+    size_t add();
+    size_t find(size_t element);
+    /// Returns false if the elements already were in the same set
+    bool unite(size_t a, size_t b);
+
+    size_t size() const {return parent.size();}
+    size_t setsCount() const {return sets;}
+
+  private:
+    std::vector<size_t> parent;
+    std::vector<unsigned char> rank;
+    size_t sets;
+  };
+
+  /// Weakly connected components (edge direction is ignored) maintained incrementally:
+  /// vertexes and edges may be added at any time, removals require a rebuild
+  template<typename V, typename E>
+  class ConnectedComponents
+  {
+  public:
+    ConnectedComponents() {}
+    explicit ConnectedComponents(const Multigraph<V, E>& graph);
+
+    void addVertex(Vertex<V, E>* vertex);
+    /// Unknown endpoints are added automatically
+    void addEdge(const Edge<V, E>* edge);
+
+    /// Returns representative of the vertex component, the vertex has to be added before
+    size_t componentOf(const Vertex<V, E>* vertex);
+    bool connected(const Vertex<V, E>* a, const Vertex<V, E>* b);
+    size_t count() const {return sets.setsCount();}
+
+    /// Dense component id of every vertex in order of addition,
+    /// ids are numbered in order of the first vertex of each component
+    std::vector<size_t> ids();
+    /// Vertexes grouped by component, in order of ids()
+    std::vector<std::vector<Vertex<V, E>*> > groups();
+
+  private:
+    size_t indexOf(Vertex<V, E>* vertex);
+
+    DisjointSet sets;
+    std::unordered_map<const Vertex<V, E>*, size_t> index;
+    std::vector<Vertex<V, E>*> vertexes;
+  };
+
+  /// Component id of every vertex of @param graph, in order of getVertexes()
+  template<typename V, typename E>
+  std::vector<size_t> connectedComponents(const Multigraph<V, E>& graph);
+
+  /// Splits vertexes into weakly connected components.
+  /// Components follow the order of their first vertex in @param vertexes.
+  template<typename V, typename E>
+  std::vector<std::vector<Vertex<V, E>*> > weakComponents(const std::list<Vertex<V, E>*>& vertexes);
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  inline DisjointSet::DisjointSet(size_t size):
+    parent(size), rank(size, 0), sets(size)
+  {
+    for(size_t i = 0; i < size; i++)
+      parent[i] = i;
+  }
+
+  inline size_t DisjointSet::add()
+  {
+    parent.push_back(parent.size());
+    rank.push_back(0);
+    sets++;
+    return parent.size() - 1;
+  }
+
+  inline size_t DisjointSet::find(size_t element)
+  {
+    size_t root = element;
+    while(parent[root] != root)
+      root = parent[root];
+
+    // path compression, second pass
+    while(parent[element] != root)
+    {
+      size_t next = parent[element];
+      parent[element] = root;
+      element = next;
+    }
+    return root;
+  }
+
+  inline bool DisjointSet::unite(size_t a, size_t b)
+  {
+    a = find(a);
+    b = find(b);
+    if(a == b)
+      return false;
+
+    if(rank[a] < rank[b])
+      std::swap(a, b);
+    parent[b] = a;
+    if(rank[a] == rank[b])
+      rank[a]++;
+    sets--;
+    return true;
+  }
+
+  template<typename V, typename E>
+  ConnectedComponents<V, E>::ConnectedComponents(const Multigraph<V, E>& graph)
+  {
+    const auto& graphVertexes = graph.getVertexes();
+    index.reserve(graphVertexes.size());
+    vertexes.reserve(graphVertexes.size());
+
+    for(auto i = graphVertexes.begin(); i != graphVertexes.end(); ++i)
+      addVertex(*i);
+
+    for(auto i = graphVertexes.begin(); i != graphVertexes.end(); ++i)
+    {
+      const auto& outgoingEdges = (*i)->getOutgoingEdges();
+      for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+        addEdge(*j);
+    }
+  }
+
+  template<typename V, typename E>
+  void ConnectedComponents<V, E>::addVertex(Vertex<V, E>* vertex)
+  {
+    indexOf(vertex);
+  }
+
+  template<typename V, typename E>
+  void ConnectedComponents<V, E>::addEdge(const Edge<V, E>* edge)
+  {
+    sets.unite(indexOf(edge->getSource()), indexOf(edge->getDestination()));
+  }
+
+  template<typename V, typename E>
+  size_t ConnectedComponents<V, E>::componentOf(const Vertex<V, E>* vertex)
+  {
+    auto pos = index.find(vertex);
+    if(pos == index.end())
+    {
+      THROW_MG_VERTEX_EXISTING_EXCEPTION("Vertex wasn't added to components!", NULL, V(), V, E);
+      return 0;
+    }
+    return sets.find(pos->second);
+  }
+
+  template<typename V, typename E>
+  bool ConnectedComponents<V, E>::connected(const Vertex<V, E>* a, const Vertex<V, E>* b)
+  {
+    return componentOf(a) == componentOf(b);
+  }
+
+  template<typename V, typename E>
+  std::vector<size_t> ConnectedComponents<V, E>::ids()
+  {
+    const size_t unnumbered = static_cast<size_t>(-1);
+    std::vector<size_t> denseIds(sets.size(), unnumbered);
+    std::vector<size_t> result(vertexes.size());
+    size_t counter = 0;
+
+    for(size_t i = 0; i < vertexes.size(); i++)
+    {
+      size_t root = sets.find(i);
+      if(denseIds[root] == unnumbered)
+        denseIds[root] = counter++;
+      result[i] = denseIds[root];
+    }
+    return result;
+  }
+
+  template<typename V, typename E>
+  std::vector<std::vector<Vertex<V, E>*> > ConnectedComponents<V, E>::groups()
+  {
+    std::vector<std::vector<Vertex<V, E>*> > result(count());
+    std::vector<size_t> componentIds = ids();
+    for(size_t i = 0; i < vertexes.size(); i++)
+      result[componentIds[i]].push_back(vertexes[i]);
+    return result;
+  }
+
+  template<typename V, typename E>
+  size_t ConnectedComponents<V, E>::indexOf(Vertex<V, E>* vertex)
+  {
+    auto inserted = index.insert(std::make_pair(vertex, sets.size()));
+    if(inserted.second)
+    {
+      sets.add();
+      vertexes.push_back(vertex);
+    }
+    return inserted.first->second;
+  }
+
+  template<typename V, typename E>
+  std::vector<size_t> connectedComponents(const Multigraph<V, E>& graph)
+  {
+    ConnectedComponents<V, E> components(graph);
+    return components.ids();
+  }
+
+  template<typename V, typename E>
+  std::vector<std::vector<Vertex<V, E>*> > weakComponents(const std::list<Vertex<V, E>*>& vertexes)
+  {
+    ConnectedComponents<V, E> components;
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+      components.addVertex(*i);
+
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+    {
+      const auto& outgoingEdges = (*i)->getOutgoingEdges();
+      for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+        components.addEdge(*j);
+    }
+    return components.groups();
+  }
+
+} // end of namespace
+
+#endif // COMPONENTS_H
@@ -0,0 +1,234 @@
+#ifndef CONCURRENTMULTIGRAPH_H
+#define CONCURRENTMULTIGRAPH_H
+
+#include "multigraph.h"
+#include "sharedmutex.h"
+
+#include <mutex>
+#include <vector>
+#include <type_traits>
+
+namespace mg
+{
+  /// One edge of a batch for ConcurrentMultigraph::addEdges()
+  template<typename V, typename E>
+  struct EdgeRecord
+  {
+    EdgeRecord(): creditor(), debtor(), value() {}
+    EdgeRecord(const V& creditor, const V& debtor, const E& value):
+      creditor(creditor), debtor(debtor), value(value) {}
+
+    V creditor;
+    V debtor;
+    E value;
+  };
+
+  /// Multigraph shared between threads. Locking model: every read runs under the shared lock,
+  /// any number of readers at once; every mutation runs under the exclusive lock.
+  /// Pointers to vertexes and edges are only valid inside read() and write() callbacks.
+  /// Ingest threads should parse outside the lock and insert whole batches with addEdges(),
+  /// so the exclusive lock is taken once per batch instead of once per edge.
+  template<typename V, typename E>
+  class ConcurrentMultigraph
+  {
+  public:
+    typedef Multigraph<V, E> Graph;
+
+    ConcurrentMultigraph() {}
+
+    ConcurrentMultigraph(const ConcurrentMultigraph&) = delete;
+    ConcurrentMultigraph& operator= (const ConcurrentMultigraph&) = delete;
+
+    /// Calls @param f(const Graph&) under the shared lock, returns its result
+    template<typename F>
+    typename std::result_of<F(const Graph&)>::type read(F f) const;
+
+    /// Calls @param f(Graph&) under the exclusive lock, returns its result
+    template<typename F>
+    typename std::result_of<F(Graph&)>::type write(F f);
+
+    // mutation, same semantics as Multigraph
+    Status tryAddVertex(const V& value);
+    Status tryAddEdge(const V& src, const V& dst, const E& value);
+    Status tryDeleteEdge(const V& src, const V& dst, const E& value);
+    void addVertex(const V& value);
+    void addEdge(const V& src, const V& dst, const E& value);
+    void deleteVertex(const V& value);
+    void deleteEdge(const V& src, const V& dst, const E& value);
+    void clear();
+
+    /// Inserts the batch under one exclusive lock, unknown endpoints are added when
+    /// @param createVertexes is set. Returns the number of added edges, loops and
+    /// edges with unknown endpoints are skipped.
+    size_t addEdges(const std::vector<EdgeRecord<V, E> >& batch, bool createVertexes = true);
+
+    // access
+    bool hasVertex(const V& value) const;
+    size_t getVertexesCount() const;
+    size_t getEdgesCount() const;
+    uint64_t getContentHash() const;
+    std::string dotText(const DotOptions& options = DotOptions()) const;
+
+    template <typename V2, typename E2>
+    friend std::ostream& operator<< (std::ostream& os, const ConcurrentMultigraph<V2, E2>& dt);
+
+    template <typename V2, typename E2>
+    friend std::istream& operator>> (std::istream& is, ConcurrentMultigraph<V2, E2>& dt);
+
+  private:
+    mutable SharedMutex mutex;
+    Graph graph;
+  };
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename V, typename E>
+  template<typename F>
+  typename std::result_of<F(const Multigraph<V, E>&)>::type ConcurrentMultigraph<V, E>::read(F f) const
+  {
+    SharedLock<SharedMutex> lock(mutex);
+    return f(static_cast<const Graph&>(graph));
+  }
+
+  template<typename V, typename E>
+  template<typename F>
+  typename std::result_of<F(Multigraph<V, E>&)>::type ConcurrentMultigraph<V, E>::write(F f)
+  {
+    std::lock_guard<SharedMutex> lock(mutex);
+    return f(graph);
+  }
+
+  template<typename V, typename E>
+  Status ConcurrentMultigraph<V, E>::tryAddVertex(const V &value)
+  {
+    std::lock_guard<SharedMutex> lock(mutex);
+    return graph.tryAddVertex(value);
+  }
+
+  template<typename V, typename E>
+  Status ConcurrentMultigraph<V, E>::tryAddEdge(const V &src, const V &dst, const E &value)
+  {
+    std::lock_guard<SharedMutex> lock(mutex);
+    return graph.tryAddEdge(src, dst, value);
+  }
+
+  template<typename V, typename E>
+  Status ConcurrentMultigraph<V, E>::tryDeleteEdge(const V &src, const V &dst, const E &value)
+  {
+    std::lock_guard<SharedMutex> lock(mutex);
+    return graph.tryDeleteEdge(src, dst, value);
+  }
+
+  template<typename V, typename E>
+  void ConcurrentMultigraph<V, E>::addVertex(const V &value)
+  {
+    std::lock_guard<SharedMutex> lock(mutex);
+    graph.addVertex(value);
+  }
+
+  template<typename V, typename E>
+  void ConcurrentMultigraph<V, E>::addEdge(const V &src, const V &dst, const E &value)
+  {
+    std::lock_guard<SharedMutex> lock(mutex);
+    graph.addEdge(src, dst, value);
+  }
+
+  template<typename V, typename E>
+  void ConcurrentMultigraph<V, E>::deleteVertex(const V &value)
+  {
+    std::lock_guard<SharedMutex> lock(mutex);
+    graph.deleteVertex(value);
+  }
+
+  template<typename V, typename E>
+  void ConcurrentMultigraph<V, E>::deleteEdge(const V &src, const V &dst, const E &value)
+  {
+    std::lock_guard<SharedMutex> lock(mutex);
+    graph.deleteEdge(src, dst, value);
+  }
+
+  template<typename V, typename E>
+  void ConcurrentMultigraph<V, E>::clear()
+  {
+    std::lock_guard<SharedMutex> lock(mutex);
+    graph.clear();
+  }
+
+  template<typename V, typename E>
+  size_t ConcurrentMultigraph<V, E>::addEdges(const std::vector<EdgeRecord<V, E> > &batch, bool createVertexes)
+  {
+    size_t added = 0;
+    std::lock_guard<SharedMutex> lock(mutex);
+    for(auto i = batch.begin(); i != batch.end(); ++i)
+    {
+      Vertex<V, E>* src = graph.findVertex(i->creditor);
+      Vertex<V, E>* dst = graph.findVertex(i->debtor);
+      if((!src || !dst) && !createVertexes)
+        continue;
+      if(!src)
+        graph.tryAddVertex(i->creditor, &src);
+      if(!dst)
+        graph.tryAddVertex(i->debtor, &dst);
+
+      if(graph.tryAddEdge(src, dst, i->value) == MG_OK)
+        added++;
+    }
+    return added;
+  }
+
+  template<typename V, typename E>
+  bool ConcurrentMultigraph<V, E>::hasVertex(const V &value) const
+  {
+    SharedLock<SharedMutex> lock(mutex);
+    return graph.findVertex(value) != NULL;
+  }
+
+  template<typename V, typename E>
+  size_t ConcurrentMultigraph<V, E>::getVertexesCount() const
+  {
+    SharedLock<SharedMutex> lock(mutex);
+    return graph.getVertexes().size();
+  }
+
+  template<typename V, typename E>
+  size_t ConcurrentMultigraph<V, E>::getEdgesCount() const
+  {
+    SharedLock<SharedMutex> lock(mutex);
+    return graph.getEdgesCount();
+  }
+
+  template<typename V, typename E>
+  uint64_t ConcurrentMultigraph<V, E>::getContentHash() const
+  {
+    SharedLock<SharedMutex> lock(mutex);
+    return graph.getContentHash();
+  }
+
+  template<typename V, typename E>
+  std::string ConcurrentMultigraph<V, E>::dotText(const DotOptions &options) const
+  {
+    SharedLock<SharedMutex> lock(mutex);
+    return graph.dotText(options);
+  }
+
+  template<typename V, typename E>
+  std::ostream& operator<< (std::ostream& os, const ConcurrentMultigraph<V, E>& dt)
+  {
+    SharedLock<SharedMutex> lock(dt.mutex);
+    return os << dt.graph;
+  }
+
+  template<typename V, typename E>
+  std::istream& operator>> (std::istream& is, ConcurrentMultigraph<V, E>& dt)
+  {
+    std::lock_guard<SharedMutex> lock(dt.mutex);
+    return is >> dt.graph;
+  }
+
+} // end of namespace
+
+#endif // CONCURRENTMULTIGRAPH_H
@@ -0,0 +1,208 @@
+#include "csvimporter.h"
+#include "expressioncache.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+using namespace mg;
+
+namespace
+{
+  struct Field
+  {
+    size_t begin;
+    size_t size;
+  };
+
+  bool isSpace(char c)
+  {
+    return c == ' ' || c == '\t';
+  }
+
+  // names are whitespace separated in *.mg files
+  void replaceSpaces(char* text, const Field& field)
+  {
+    for(size_t i = field.begin; i < field.begin + field.size; i++)
+      if(isSpace(text[i]) || text[i] == '\n' || text[i] == '\r')
+        text[i] = '_';
+  }
+
+  void trim(const char* text, Field& field)
+  {
+    while(field.size && isSpace(text[field.begin]))
+    {
+      field.begin++;
+      field.size--;
+    }
+    while(field.size && isSpace(text[field.begin + field.size - 1]))
+      field.size--;
+  }
+
+  /// Reads fields of the row starting at @param pos, returns position after the row.
+  /// Quoted fields are unescaped in place.
+  size_t readRow(char* text, size_t size, size_t pos, char delimiter, std::vector<Field>& fields)
+  {
+    fields.clear();
+    for(;;)
+    {
+      Field field;
+      if(pos < size && text[pos] == '"')
+      {
+        // "" inside quotes is a quote, the unescaped field is written over itself
+        size_t read = pos + 1;
+        size_t write = pos;
+        field.begin = pos;
+        while(read < size)
+        {
+          if(text[read] == '"')
+          {
+            if(read + 1 < size && text[read + 1] == '"')
+            {
+              text[write++] = '"';
+              read += 2;
+              continue;
+            }
+            read++;
+            break;
+          }
+          text[write++] = text[read++];
+        }
+        field.size = write - field.begin;
+
+        // anything between the closing quote and the delimiter is ignored
+        pos = read;
+        while(pos < size && text[pos] != delimiter && text[pos] != '\n')
+          pos++;
+      }
+      else
+      {
+        field.begin = pos;
+        while(pos < size && text[pos] != delimiter && text[pos] != '\n')
+          pos++;
+        field.size = pos - field.begin;
+        if(field.size && text[pos - 1] == '\r')
+          field.size--;
+      }
+      fields.push_back(field);
+
+      if(pos >= size)
+        return size;
+      if(text[pos] == '\n')
+        return pos + 1;
+      pos++; // delimiter
+    }
+  }
+
+  bool parseAmount(const char* text, const Field& field, double& amount)
+  {
+    if(!field.size)
+      return false;
+
+    // plain numbers skip tinyexpr, it would parse them with strtod as well
+    char* end = NULL;
+    amount = std::strtod(text + field.begin, &end);
+    if(end != text + field.begin + field.size)
+    {
+      static thread_local ExpressionCache expressions;
+      int error = 0;
+      amount = expressions.evaluate(std::string(text + field.begin, field.size), NULL, &error);
+      if(error)
+        return false;
+    }
+    return std::isfinite(amount);
+  }
+}
+
+size_t mg::csvCompleteRowsSize(const char *data, size_t size)
+{
+  // fast path: without quotes the last newline ends the last complete row
+  if(!std::memchr(data, '"', size))
+  {
+    for(size_t i = size; i > 0; i--)
+      if(data[i - 1] == '\n')
+        return i;
+    return 0;
+  }
+
+  size_t complete = 0;
+  bool quoted = false;
+  for(size_t i = 0; i < size; i++)
+  {
+    if(data[i] == '"')
+      quoted = !quoted;
+    else if(data[i] == '\n' && !quoted)
+      complete = i + 1;
+  }
+  return complete;
+}
+
+void mg::parseCsvChunk(CsvChunk &chunk, const CsvImportOptions &options, bool skipFirstRow)
+{
+  char* text = &chunk.text[0];
+  const size_t size = chunk.text.size();
+  const size_t columnsCount = std::max(options.creditorColumn,
+                                       std::max(options.debtorColumn, options.amountColumn)) + 1;
+
+  std::vector<Field> fields;
+  fields.reserve(columnsCount + 4);
+  chunk.records.reserve(size / 24);
+
+  size_t pos = 0;
+  while(pos < size)
+  {
+    size_t row = chunk.rows++;
+    pos = readRow(text, size, pos, options.delimiter, fields);
+
+    if(skipFirstRow && row == 0)
+      continue;
+
+    // empty lines are counted, but not reported
+    if(fields.size() == 1 && fields[0].size == 0)
+      continue;
+
+    if(fields.size() < columnsCount)
+    {
+      chunk.failedRows.push_back(row);
+      continue;
+    }
+
+    Field creditor = fields[options.creditorColumn];
+    Field debtor = fields[options.debtorColumn];
+    Field amountField = fields[options.amountColumn];
+    trim(text, creditor);
+    trim(text, debtor);
+    trim(text, amountField);
+
+    CsvChunk::Record record;
+    if(!creditor.size || !debtor.size || !parseAmount(text, amountField, record.amount))
+    {
+      chunk.failedRows.push_back(row);
+      continue;
+    }
+
+    replaceSpaces(text, creditor);
+    replaceSpaces(text, debtor);
+
+    record.creditorBegin = static_cast<uint32_t>(creditor.begin);
+    record.creditorSize = static_cast<uint32_t>(creditor.size);
+    record.debtorBegin = static_cast<uint32_t>(debtor.begin);
+    record.debtorSize = static_cast<uint32_t>(debtor.size);
+    record.amountBegin = static_cast<uint32_t>(amountField.begin);
+    record.amountSize = static_cast<uint32_t>(amountField.size);
+    record.row = row;
+    chunk.records.push_back(record);
+  }
+}
+
+bool mg::csvAmount(const CsvChunk::Record &record, const char *text, Money &amount)
+{
+  // decimal numbers are taken as written, results of formulas are rounded to cents
+  if(parseMoney(text + record.amountBegin, record.amountSize, amount))
+    return true;
+  if(!(std::fabs(record.amount) * Money::scale < 9.2e18))
+    return false;
+  amount = Money(record.amount);
+  return true;
+}
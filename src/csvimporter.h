@@ -0,0 +1,233 @@
+#ifndef CSVIMPORTER_H
+#define CSVIMPORTER_H
+
+#include "multigraph.h"
+#include "currency.h"
+#include "threadpool.h"
+
+#include <istream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <future>
+#include <cstdint>
+#include <algorithm>
+
+namespace mg
+{
+  struct CsvImportOptions
+  {
+    CsvImportOptions(): delimiter(','), header(true), creditorColumn(0), debtorColumn(1), amountColumn(2),
+      createVertexes(true), chunkSize(1 << 20) {}
+
+    char delimiter;
+    /// The first row holds column names and is skipped
+    bool header;
+    size_t creditorColumn;
+    size_t debtorColumn;
+    /// Number or tinyexpr expression, e.g. 120/3
+    size_t amountColumn;
+    /// Unknown persons are added, otherwise their rows fail
+    bool createVertexes;
+    /// Bytes read and parsed as one task
+    size_t chunkSize;
+  };
+
+  struct CsvImportResult
+  {
+    CsvImportResult(): rows(0), imported(0) {}
+
+    size_t rows;
+    size_t imported;
+    /// 1-based numbers of rows which weren't imported, the header is row 1
+    std::vector<size_t> failedRows;
+  };
+
+  /// Rows of one chunk of csv text. Fields are kept as offsets into the chunk text,
+  /// quoted fields are unescaped in place, so parsing doesn't allocate per cell.
+  struct CsvChunk
+  {
+    struct Record
+    {
+      uint32_t creditorBegin, creditorSize;
+      uint32_t debtorBegin, debtorSize;
+      /// Text of the amount, for edge types which take it exactly
+      uint32_t amountBegin, amountSize;
+      double amount;
+      size_t row;
+    };
+
+    CsvChunk(): rows(0) {}
+
+    std::string text;
+    std::vector<Record> records;
+    /// Rows relative to the chunk beginning
+    std::vector<size_t> failedRows;
+    size_t rows;
+  };
+
+  /// Returns the length of the longest prefix of @param data made of whole rows,
+  /// newlines inside quoted fields don't end a row
+  size_t csvCompleteRowsSize(const char* data, size_t size);
+
+  /// Splits chunk.text into records, evaluates amounts with tinyexpr (compiled formulas
+  /// are cached per thread), whitespace in names is replaced with '_' as the GUI does
+  void parseCsvChunk(CsvChunk& chunk, const CsvImportOptions& options, bool skipFirstRow);
+
+  /// Edge value of @param record of a chunk with @param text, returns false if it doesn't fit @param amount.
+  /// Amounts are taken from the parsed double, money from the text, so "0.285" is 0.29 as typed.
+  template<typename E>
+  bool csvAmount(const CsvChunk::Record& record, const char* text, E& amount);
+  bool csvAmount(const CsvChunk::Record& record, const char* text, Money& amount);
+  bool csvAmount(const CsvChunk::Record& record, const char* text, CurrencyAmount& amount);
+
+  /// Parses one chunk on a worker thread, the text is moved in, not copied
+  struct CsvParseTask
+  {
+    CsvParseTask(std::string& text, const CsvImportOptions& options, bool skipFirstRow):
+      options(options), skipFirstRow(skipFirstRow)
+    {
+      this->text.swap(text);
+    }
+
+    CsvChunk operator()()
+    {
+      CsvChunk chunk;
+      chunk.text.swap(text);
+      parseCsvChunk(chunk, options, skipFirstRow);
+      return chunk;
+    }
+
+    std::string text;
+    CsvImportOptions options;
+    bool skipFirstRow;
+  };
+
+  /// Streams csv rows (creditor, debtor, amount) from @param input into @param graph.
+  /// Chunks are parsed on @param pool while the calling thread inserts parsed chunks in file order.
+  template<typename V, typename E>
+  CsvImportResult importCsv(std::istream& input, Multigraph<V, E>& graph,
+                            const CsvImportOptions& options = CsvImportOptions(),
+                            ThreadPool& pool = ThreadPool::global());
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename E>
+  bool csvAmount(const CsvChunk::Record& record, const char*, E& amount)
+  {
+    amount = E(record.amount);
+    return true;
+  }
+
+  inline bool csvAmount(const CsvChunk::Record& record, const char* text, CurrencyAmount& amount)
+  {
+    Money value;
+    if(!csvAmount(record, text, value))
+      return false;
+    amount = CurrencyAmount(value);
+    return true;
+  }
+
+  template<typename V, typename E>
+  void insertCsvChunk(const CsvChunk& chunk, size_t firstRow, Multigraph<V, E>& graph,
+                      const CsvImportOptions& options, CsvImportResult& result)
+  {
+    for(auto i = chunk.failedRows.begin(); i != chunk.failedRows.end(); ++i)
+      result.failedRows.push_back(firstRow + *i);
+
+    const char* text = chunk.text.data();
+    for(auto i = chunk.records.begin(); i != chunk.records.end(); ++i)
+    {
+      V creditor(std::string(text + i->creditorBegin, i->creditorSize));
+      V debtor(std::string(text + i->debtorBegin, i->debtorSize));
+
+      // loops are rejected by the multigraph, before any endpoint is created
+      if(creditor == debtor)
+      {
+        result.failedRows.push_back(firstRow + i->row);
+        continue;
+      }
+
+      Vertex<V, E>* src = graph.findVertex(creditor);
+      Vertex<V, E>* dst = graph.findVertex(debtor);
+      if((!src || !dst) && !options.createVertexes)
+      {
+        result.failedRows.push_back(firstRow + i->row);
+        continue;
+      }
+      if(!src)
+        graph.tryAddVertex(creditor, &src);
+      if(!dst)
+        graph.tryAddVertex(debtor, &dst);
+
+      E amount;
+      if(!csvAmount(*i, text, amount) || graph.tryAddEdge(src, dst, amount) != MG_OK)
+      {
+        result.failedRows.push_back(firstRow + i->row);
+        continue;
+      }
+      result.imported++;
+    }
+  }
+
+  template<typename V, typename E>
+  CsvImportResult importCsv(std::istream& input, Multigraph<V, E>& graph,
+                            const CsvImportOptions& options, ThreadPool& pool)
+  {
+    CsvImportResult result;
+
+    // parsed chunks waiting for insertion, in file order
+    std::deque<std::future<CsvChunk> > inFlight;
+    const size_t maxInFlight = pool.size() * 2;
+    size_t nextRow = 1;
+
+    auto insertFront = [&]()
+    {
+      CsvChunk chunk = inFlight.front().get();
+      inFlight.pop_front();
+      insertCsvChunk(chunk, nextRow, graph, options, result);
+      nextRow += chunk.rows;
+      result.rows += chunk.rows;
+    };
+
+    std::string carry;
+    bool firstChunk = true;
+    while(input)
+    {
+      std::string text;
+      text.swap(carry);
+      size_t carrySize = text.size();
+      text.resize(carrySize + options.chunkSize);
+      input.read(&text[carrySize], options.chunkSize);
+      text.resize(carrySize + static_cast<size_t>(input.gcount()));
+
+      // the incomplete last row goes to the next chunk, at the end of file it is complete
+      size_t complete = input ? csvCompleteRowsSize(text.data(), text.size()) : text.size();
+      carry.assign(text, complete, std::string::npos);
+      text.resize(complete);
+      if(text.empty())
+        continue;
+
+      CsvParseTask task(text, options, firstChunk && options.header);
+      firstChunk = false;
+
+      if(inFlight.size() >= maxInFlight)
+        insertFront();
+      inFlight.push_back(pool.submit(std::move(task)));
+    }
+
+    while(!inFlight.empty())
+      insertFront();
+
+    // rows failed while parsing and while inserting were reported separately
+    std::sort(result.failedRows.begin(), result.failedRows.end());
+    return result;
+  }
+
+} // end of namespace
+
+#endif // CSVIMPORTER_H
@@ -0,0 +1,191 @@
+#include "currency.h"
+
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+using namespace mg;
+
+namespace
+{
+  const uint32_t unknownSlot = 0;
+  const uint32_t noneSlot = 1;
+}
+
+std::ostream& mg::operator<< (std::ostream &os, const CurrencyAmount &value)
+{
+  char buffer[28];
+  size_t size = formatMoney(value.getAmount(), buffer);
+  if(!value.getCurrency().isNone())
+  {
+    std::string name = value.getCurrency().getName();
+    name.copy(buffer + size, 3);
+    size += 3;
+  }
+  os.write(buffer, static_cast<std::streamsize>(size));
+  return os;
+}
+
+std::istream& mg::operator>> (std::istream &is, CurrencyAmount &value)
+{
+  std::string token;
+  if(!(is >> token))
+    return is;
+
+  // a trailing code is three letters after the number, exponents end with a digit
+  Currency currency;
+  size_t size = token.size();
+  if(size > 3 && std::isalpha(static_cast<unsigned char>(token[size - 1])))
+  {
+    if(!Currency::parse(token.data() + size - 3, 3, currency))
+    {
+      is.setstate(std::ios::failbit);
+      return is;
+    }
+    size -= 3;
+  }
+
+  Money amount;
+  if(!parseMoney(token.data(), size, amount))
+    is.setstate(std::ios::failbit);
+  else
+    value = CurrencyAmount(amount, currency);
+  return is;
+}
+
+RateTable::RateTable(Currency base): base(base), slots(Currency::codes, unknownSlot), values(2, 0.0)
+{
+  values[noneSlot] = 1.0;
+  slots[0] = noneSlot;
+  if(!base.isNone())
+    setRate(base, 1.0);
+}
+
+void RateTable::setBase(Currency base)
+{
+  this->base = base;
+  if(base.isNone())
+    return;
+  if(!hasRate(base))
+  {
+    setRate(base, 1.0);
+    return;
+  }
+  double rate = values[slots[base.getCode()]];
+  for(size_t i = noneSlot + 1; i < values.size(); i++)
+    values[i] /= rate;
+}
+
+void RateTable::setRate(Currency currency, double rate)
+{
+  if(!(rate > 0.0) || !std::isfinite(rate))
+    THROW_MG_EXCEPTION("Rate of a currency has to be finite and positive!");
+  if(currency.isNone())
+    THROW_MG_EXCEPTION("No currency has always rate 1!");
+
+  uint32_t& slot = slots[currency.getCode()];
+  if(slot == unknownSlot)
+  {
+    if(values.size() > 255)
+      THROW_MG_EXCEPTION("Too many currencies in the rate table!");
+    slot = static_cast<uint32_t>(values.size());
+    values.push_back(rate);
+  }
+  else
+    values[slot] = rate;
+}
+
+double RateTable::getRate(Currency currency) const
+{
+  uint32_t slot = slots[currency.getCode()];
+  if(slot == unknownSlot)
+    THROW_MG_EXCEPTION("No rate for currency " + currency.getName() + "!");
+  return values[slot];
+}
+
+Money RateTable::convert(const CurrencyAmount &amount) const
+{
+  return convert(amount, base).getAmount();
+}
+
+CurrencyAmount RateTable::convert(const CurrencyAmount &amount, Currency currency) const
+{
+  if(amount.getCurrency() == currency || (amount.getCurrency().isNone() && currency == base)
+     || (currency.isNone() && amount.getCurrency() == base))
+    return CurrencyAmount(amount.getAmount(), currency);
+
+  int64_t minor = amount.getAmount().getMinor(), result;
+  uint16_t code = amount.getCurrency().getCode();
+  if(!convertMinor(&minor, &code, 1, &result, currency))
+    THROW_MG_EXCEPTION("No rate for currency " + amount.getCurrency().getName() + "!");
+  return CurrencyAmount(Money::fromMinor(result), currency);
+}
+
+bool RateTable::convertMinor(const int64_t *minor, const uint16_t *codes, size_t count, int64_t *result,
+                             Currency currency) const
+{
+  const double factor = 1.0 / getRate(currency);
+  const uint32_t* slotsData = slots.data();
+  const double* valuesData = values.data();
+
+  // unknown currencies have rate 0, they are detected by their slot instead of a branch
+  unsigned known = 1;
+  for(size_t i = 0; i < count; i++)
+  {
+    uint32_t slot = slotsData[codes[i]];
+    known &= slot != unknownSlot;
+    double x = static_cast<double>(minor[i]) * (valuesData[slot] * factor);
+    result[i] = static_cast<int64_t>(x + (x < 0.0 ? -0.5 : 0.5));
+  }
+  return known != 0;
+}
+
+void RateTable::load(std::istream &input)
+{
+  std::string line;
+  size_t lineNumber = 0;
+  while(std::getline(input, line))
+  {
+    lineNumber++;
+    size_t comment = line.find('#');
+    if(comment != std::string::npos)
+      line.erase(comment);
+
+    std::istringstream fields(line);
+    std::string name, value, rest;
+    if(!(fields >> name))
+      continue;   // empty line
+
+    std::ostringstream where;
+    where << "Malformed rate in line " << lineNumber << "!";
+
+    Currency currency;
+    if(name == "base")
+    {
+      if(!(fields >> value) || (fields >> rest) || !Currency::parse(value.data(), value.size(), currency))
+        THROW_MG_EXCEPTION(where.str());
+      setBase(currency);
+      continue;
+    }
+
+    if(!Currency::parse(name.data(), name.size(), currency) || !(fields >> value) || (fields >> rest))
+      THROW_MG_EXCEPTION(where.str());
+    char* end = NULL;
+    double rate = std::strtod(value.c_str(), &end);
+    if(end == value.c_str() || *end != '\0' || !(rate > 0.0) || !std::isfinite(rate))
+      THROW_MG_EXCEPTION(where.str());
+    setRate(currency, rate);
+  }
+  if(input.bad())
+    THROW_MG_EXCEPTION("Reading of the rate table failed!");
+}
+
+void RateTable::loadFile(const std::string &path)
+{
+  std::ifstream file(path.c_str());
+  if(!file)
+    THROW_MG_EXCEPTION("Can't open the rate table " + path + "!");
+  load(file);
+}
@@ -0,0 +1,244 @@
+#ifndef CURRENCY_H
+#define CURRENCY_H
+
+#include "money.h"
+#include "mgexception.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <functional>
+#include <type_traits>
+
+namespace mg
+{
+  /// Three letter currency code, e.g. EUR, packed into 15 bits: five bits per letter A-Z.
+  /// The default one is no currency, amounts without a currency are in the base currency.
+  class Currency
+  {
+  public:
+    enum { codes = 1 << 15 };
+
+    Currency(): code(0) {}
+    /// Throws if @param name isn't three letters A-Z
+    explicit Currency(const std::string& name);
+
+    /// Returns false if @param text isn't three letters A-Z
+    static bool parse(const char* text, size_t size, Currency& currency);
+    static Currency fromCode(uint16_t code) {Currency result; result.code = code; return result;}
+
+    uint16_t getCode() const {return code;}
+    bool isNone() const {return code == 0;}
+    /// Empty for no currency
+    std::string getName() const;
+
+    friend bool operator== (const Currency& a, const Currency& b) {return a.code == b.code;}
+    friend bool operator!= (const Currency& a, const Currency& b) {return a.code != b.code;}
+    friend bool operator< (const Currency& a, const Currency& b) {return a.code < b.code;}
+
+  private:
+    uint16_t code;
+  };
+
+  /// Money in a currency, the edge value of multi-currency ledgers. Amounts are added, subtracted
+  /// and ordered only within one currency, mixing currencies throws; an amount without a currency,
+  /// such as E() or a count, takes the currency of the other operand. == compares both parts.
+  /// Written as "12.50EUR", "12.50" for no currency, so single currency files load unchanged.
+  /// Use RateTable or the functions of multicurrency.h to bring amounts to one currency.
+  class CurrencyAmount
+  {
+  public:
+    CurrencyAmount() {}
+    explicit CurrencyAmount(const Money& amount, Currency currency = Currency()): amount(amount), currency(currency) {}
+
+    /// No currency, CurrencyAmount(3) is 3.00
+    template<typename T>
+    explicit CurrencyAmount(T value, typename std::enable_if<std::is_arithmetic<T>::value>::type* = 0):
+      amount(value) {}
+
+    const Money& getAmount() const {return amount;}
+    Currency getCurrency() const {return currency;}
+
+    CurrencyAmount operator- () const {return CurrencyAmount(-amount, currency);}
+
+    friend CurrencyAmount operator+ (const CurrencyAmount& a, const CurrencyAmount& b)
+    {
+      return CurrencyAmount(a.amount + b.amount, common(a, b));
+    }
+    friend CurrencyAmount operator- (const CurrencyAmount& a, const CurrencyAmount& b)
+    {
+      return CurrencyAmount(a.amount - b.amount, common(a, b));
+    }
+    /// Scaling, e.g. a part of a group expense: the currency is the one of the amount
+    friend CurrencyAmount operator* (const CurrencyAmount& a, const CurrencyAmount& b)
+    {
+      return CurrencyAmount(a.amount * b.amount, a.currency.isNone() ? b.currency : a.currency);
+    }
+    friend CurrencyAmount operator/ (const CurrencyAmount& a, const CurrencyAmount& b)
+    {
+      return CurrencyAmount(a.amount / b.amount, a.currency.isNone() ? b.currency : a.currency);
+    }
+
+    friend bool operator== (const CurrencyAmount& a, const CurrencyAmount& b)
+    {
+      return a.amount == b.amount && a.currency == b.currency;
+    }
+    friend bool operator!= (const CurrencyAmount& a, const CurrencyAmount& b) {return !(a == b);}
+    friend bool operator< (const CurrencyAmount& a, const CurrencyAmount& b) {common(a, b); return a.amount < b.amount;}
+    friend bool operator> (const CurrencyAmount& a, const CurrencyAmount& b) {return b < a;}
+    friend bool operator<= (const CurrencyAmount& a, const CurrencyAmount& b) {return !(b < a);}
+    friend bool operator>= (const CurrencyAmount& a, const CurrencyAmount& b) {return !(a < b);}
+
+  private:
+    static Currency common(const CurrencyAmount& a, const CurrencyAmount& b);
+
+    Money amount;
+    Currency currency;
+  };
+
+  /// Equal split in minor units of the currency, see equalPart(const Money&, size_t, size_t)
+  inline CurrencyAmount equalPart(const CurrencyAmount& total, size_t count, size_t i)
+  {
+    return CurrencyAmount(equalPart(total.getAmount(), count, i), total.getCurrency());
+  }
+
+  /// Weighted split in minor units of the currency of @param total, weights are plain numbers
+  inline void weightedParts(const CurrencyAmount& total, const std::vector<CurrencyAmount>& weights,
+                            const CurrencyAmount& sum, std::vector<CurrencyAmount>& parts)
+  {
+    std::vector<Money> amounts(weights.size()), amountParts;
+    for(size_t i = 0; i < weights.size(); i++)
+      amounts[i] = weights[i].getAmount();
+    weightedParts(total.getAmount(), amounts, sum.getAmount(), amountParts);
+    parts.resize(amountParts.size());
+    for(size_t i = 0; i < amountParts.size(); i++)
+      parts[i] = CurrencyAmount(amountParts[i], total.getCurrency());
+  }
+
+  std::ostream& operator<< (std::ostream& os, const CurrencyAmount& value);
+  /// Reads one whitespace separated token, sets failbit if it isn't an amount
+  std::istream& operator>> (std::istream& is, CurrencyAmount& value);
+
+  /// Exchange rates: how many units of the base currency one unit of a currency is worth.
+  /// No currency and the base currency have rate 1. Loaded from text, one rate per line:
+  ///
+  ///   # comment
+  ///   base EUR
+  ///   USD 0.92
+  ///   GBP 1.17
+  ///
+  /// Up to 254 currencies. Rates are looked up through a table of slots by code, conversion
+  /// of many amounts touches only the few cache lines of the codes in use.
+  class RateTable
+  {
+  public:
+    explicit RateTable(Currency base = Currency());
+
+    Currency getBase() const {return base;}
+    /// Rates are rescaled so that @param base has rate 1
+    void setBase(Currency base);
+
+    /// @param rate is finite and positive, otherwise throws
+    void setRate(Currency currency, double rate);
+    bool hasRate(Currency currency) const {return slots[currency.getCode()] != 0;}
+    /// Throws for a currency without a rate
+    double getRate(Currency currency) const;
+    /// Currencies with rates, without no currency
+    size_t size() const {return values.size() - 2;}
+
+    /// Amount in the base currency, rounded to cents
+    Money convert(const CurrencyAmount& amount) const;
+    /// Amount in @param currency, rounded to cents
+    CurrencyAmount convert(const CurrencyAmount& amount, Currency currency) const;
+
+    /// Bulk conversion of @param count amounts given by minor units and currency codes into
+    /// minor units of @param currency. The loop is a gather of rates and a multiply, without
+    /// branches or dependencies between iterations, compilers vectorize it where the target has
+    /// gathers and double to int64 conversion (AVX-512). Returns false if some currency has no rate,
+    /// its amounts convert to 0.
+    bool convertMinor(const int64_t* minor, const uint16_t* codes, size_t count, int64_t* result,
+                      Currency currency = Currency()) const;
+
+    /// Rates from @param input are added to the table, throws on a malformed line
+    void load(std::istream& input);
+    void loadFile(const std::string& path);
+
+  private:
+    Currency base;
+    /// Slot of every code, 0 is no rate; 32 bits wide to be gathered by vector loads
+    std::vector<uint32_t> slots;
+    /// Rate of every slot, the unknown slot 0 has rate 0, slot 1 is no currency
+    std::vector<double> values;
+  };
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  inline Currency::Currency(const std::string &name): code(0)
+  {
+    if(!parse(name.data(), name.size(), *this))
+      THROW_MG_EXCEPTION("Currency \"" + name + "\" isn't three letters A-Z!");
+  }
+
+  inline bool Currency::parse(const char* text, size_t size, Currency &currency)
+  {
+    if(size != 3)
+      return false;
+    uint16_t code = 0;
+    for(size_t i = 0; i < 3; i++)
+    {
+      if(text[i] < 'A' || text[i] > 'Z')
+        return false;
+      code = static_cast<uint16_t>(code << 5 | (text[i] - 'A' + 1));
+    }
+    currency.code = code;
+    return true;
+  }
+
+  inline std::string Currency::getName() const
+  {
+    if(!code)
+      return std::string();
+    std::string name(3, ' ');
+    for(size_t i = 0; i < 3; i++)
+      name[i] = static_cast<char>('A' - 1 + ((code >> (5 * (2 - i))) & 31));
+    return name;
+  }
+
+  inline Currency CurrencyAmount::common(const CurrencyAmount &a, const CurrencyAmount &b)
+  {
+    if(a.currency == b.currency || b.currency.isNone())
+      return a.currency;
+    if(a.currency.isNone())
+      return b.currency;
+    THROW_MG_EXCEPTION("Amounts in " + a.currency.getName() + " and " + b.currency.getName() + " can't be mixed!");
+    return Currency();
+  }
+
+} // end of namespace
+
+namespace std
+{
+  template<>
+  struct hash<mg::Currency>
+  {
+    size_t operator() (const mg::Currency& value) const {return std::hash<uint16_t>()(value.getCode());}
+  };
+
+  template<>
+  struct hash<mg::CurrencyAmount>
+  {
+    size_t operator() (const mg::CurrencyAmount& value) const
+    {
+      return std::hash<mg::Money>()(value.getAmount()) ^ (static_cast<size_t>(value.getCurrency().getCode()) << 1);
+    }
+  };
+}
+
+#endif // CURRENCY_H
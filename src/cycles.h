@@ -0,0 +1,320 @@
+#ifndef CYCLES_H
+#define CYCLES_H
+
+#include "multigraph.h"
+#include "threadpool.h"
+
+#include <vector>
+#include <future>
+#include <unordered_map>
+#include <algorithm>
+
+namespace mg
+{
+  template<typename E>
+  struct CycleCancellation
+  {
+    CycleCancellation(): cycles(0), removedEdges(0), cancelled() {}
+
+    size_t cycles;
+    size_t removedEdges;
+    /// Sum of the amounts taken off the edges
+    E cancelled;
+  };
+
+  /// Edges of a multigraph in compressed sparse row form: outgoing edges of vertex v are
+  /// positions offsets[v] .. offsets[v + 1] - 1, vertexes are numbered in order of getVertexes()
+  template<typename V, typename E>
+  struct DebtDigraph
+  {
+    explicit DebtDigraph(const Multigraph<V, E>& graph);
+
+    size_t size() const {return vertexes.size();}
+
+    std::vector<Vertex<V, E>*> vertexes;
+    std::vector<size_t> offsets;
+    std::vector<size_t> targets;
+    std::vector<Edge<V, E>*> edges;
+  };
+
+  /// Strongly connected component id of every vertex of @param graph, in order of getVertexes().
+  /// Iterative Tarjan, O(V + E) without recursion, ids are in reverse topological order.
+  template<typename V, typename E>
+  std::vector<size_t> stronglyConnectedComponents(const Multigraph<V, E>& graph);
+
+  /// Removes every debt cycle, e.g. A->B->C->A, by taking the minimum amount of the cycle off
+  /// each of its edges; emptied edges are deleted, balances of the vertexes are preserved.
+  /// Components are processed on @param pool in parallel, one depth first pass each.
+  /// Amounts not above @param epsilon count as zero.
+  template<typename V, typename E>
+  CycleCancellation<E> cancelCycles(Multigraph<V, E>& graph, const E& epsilon = E(),
+                                    ThreadPool& pool = ThreadPool::global());
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename V, typename E>
+  DebtDigraph<V, E>::DebtDigraph(const Multigraph<V, E> &graph)
+  {
+    const auto& graphVertexes = graph.getVertexes();
+    vertexes.assign(graphVertexes.begin(), graphVertexes.end());
+
+    std::unordered_map<const Vertex<V, E>*, size_t> positions;
+    positions.reserve(vertexes.size());
+    for(size_t i = 0; i < vertexes.size(); i++)
+      positions[vertexes[i]] = i;
+
+    offsets.reserve(vertexes.size() + 1);
+    offsets.push_back(0);
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+    {
+      const auto& outgoingEdges = (*i)->getOutgoingEdges();
+      for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+      {
+        targets.push_back(positions[(*j)->getDestination()]);
+        edges.push_back(*j);
+      }
+      offsets.push_back(edges.size());
+    }
+  }
+
+  /// Tarjan's algorithm with an explicit stack of (vertex, next edge) frames
+  template<typename V, typename E>
+  std::vector<size_t> stronglyConnectedComponents(const DebtDigraph<V, E>& digraph)
+  {
+    const size_t unvisited = static_cast<size_t>(-1);
+    const size_t n = digraph.size();
+    std::vector<size_t> index(n, unvisited), low(n), component(n, unvisited);
+    std::vector<size_t> stack;
+    std::vector<std::pair<size_t, size_t> > frames;
+    size_t counter = 0, components = 0;
+
+    for(size_t root = 0; root < n; root++)
+    {
+      if(index[root] != unvisited)
+        continue;
+
+      index[root] = low[root] = counter++;
+      stack.push_back(root);
+      frames.push_back(std::make_pair(root, digraph.offsets[root]));
+
+      while(!frames.empty())
+      {
+        size_t v = frames.back().first;
+        size_t& next = frames.back().second;
+
+        if(next < digraph.offsets[v + 1])
+        {
+          size_t w = digraph.targets[next++];
+          if(index[w] == unvisited)
+          {
+            index[w] = low[w] = counter++;
+            stack.push_back(w);
+            frames.push_back(std::make_pair(w, digraph.offsets[w]));
+          }
+          else if(component[w] == unvisited)   // w is on the stack
+            low[v] = std::min(low[v], index[w]);
+          continue;
+        }
+
+        frames.pop_back();
+        if(!frames.empty())
+          low[frames.back().first] = std::min(low[frames.back().first], low[v]);
+
+        if(low[v] == index[v])
+        {
+          size_t w;
+          do
+          {
+            w = stack.back();
+            stack.pop_back();
+            component[w] = components;
+          } while(w != v);
+          components++;
+        }
+      }
+    }
+    return component;
+  }
+
+  template<typename V, typename E>
+  std::vector<size_t> stronglyConnectedComponents(const Multigraph<V, E>& graph)
+  {
+    return stronglyConnectedComponents(DebtDigraph<V, E>(graph));
+  }
+
+  /// Cancels all cycles among @param members, vertexes of one strongly connected component.
+  /// Depth first search keeps the current path; an edge back to the path closes a cycle,
+  /// its minimum is subtracted and the path is cut back to the first emptied edge.
+  /// Vertexes which finish only point to finished vertexes, so each edge is scanned once.
+  template<typename V, typename E>
+  CycleCancellation<E> cancelComponentCycles(const DebtDigraph<V, E>& digraph, const std::vector<size_t>& component,
+                                             const std::vector<size_t>& members, std::vector<E>& amounts,
+                                             std::vector<size_t>& cursors, std::vector<unsigned char>& states,
+                                             std::vector<size_t>& pathPositions, const E& epsilon)
+  {
+    enum { WHITE, ON_PATH, DONE };
+    CycleCancellation<E> result;
+    std::vector<size_t> pathVertexes, pathEdges;
+
+    for(auto root = members.begin(); root != members.end(); ++root)
+    {
+      if(states[*root] != WHITE)
+        continue;
+
+      states[*root] = ON_PATH;
+      pathPositions[*root] = 0;
+      pathVertexes.assign(1, *root);
+      pathEdges.clear();
+
+      while(!pathVertexes.empty())
+      {
+        size_t v = pathVertexes.back();
+        size_t& cursor = cursors[v];
+
+        // skip other components (their state belongs to other tasks), emptied edges and finished vertexes
+        while(cursor < digraph.offsets[v + 1]
+              && (component[digraph.targets[cursor]] != component[v] || !(amounts[cursor] > epsilon)
+                  || states[digraph.targets[cursor]] == DONE))
+          cursor++;
+
+        if(cursor == digraph.offsets[v + 1])
+        {
+          states[v] = DONE;
+          pathVertexes.pop_back();
+          if(!pathEdges.empty())
+            pathEdges.pop_back();
+          continue;
+        }
+
+        size_t w = digraph.targets[cursor];
+        if(states[w] == WHITE)
+        {
+          states[w] = ON_PATH;
+          pathPositions[w] = pathVertexes.size();
+          pathVertexes.push_back(w);
+          pathEdges.push_back(cursor);
+          continue;
+        }
+
+        // cycle: path edges from w to v, closed by the current edge
+        pathEdges.push_back(cursor);
+        size_t first = pathPositions[w];
+        E minimum = amounts[pathEdges[first]];
+        for(size_t i = first + 1; i < pathEdges.size(); i++)
+          minimum = std::min(minimum, amounts[pathEdges[i]]);
+
+        size_t cut = pathEdges.size();
+        for(size_t i = first; i < pathEdges.size(); i++)
+        {
+          amounts[pathEdges[i]] = amounts[pathEdges[i]] - minimum;
+          result.cancelled = result.cancelled + minimum;
+          if(!(amounts[pathEdges[i]] > epsilon) && cut == pathEdges.size())
+            cut = i;
+        }
+        result.cycles++;
+
+        // the path continues from the source of the first emptied edge, vertexes above it
+        // leave the path unfinished, their scanned edges lead only to finished vertexes
+        for(size_t i = cut + 1; i < pathVertexes.size(); i++)
+          states[pathVertexes[i]] = WHITE;
+        pathVertexes.resize(cut + 1);
+        pathEdges.resize(cut);
+      }
+    }
+    return result;
+  }
+
+  template<typename V, typename E>
+  CycleCancellation<E> cancelCycles(Multigraph<V, E>& graph, const E& epsilon, ThreadPool& pool)
+  {
+    DebtDigraph<V, E> digraph(graph);
+    std::vector<size_t> component = stronglyConnectedComponents(digraph);
+
+    // members of every component with more than one vertex, only they have cycles
+    std::vector<std::vector<size_t> > members;
+    {
+      std::vector<size_t> sizes(digraph.size() + 1, 0);
+      for(size_t v = 0; v < digraph.size(); v++)
+        sizes[component[v]]++;
+      std::vector<size_t> slots(digraph.size() + 1, static_cast<size_t>(-1));
+      for(size_t v = 0; v < digraph.size(); v++)
+      {
+        if(sizes[component[v]] < 2)
+          continue;
+        if(slots[component[v]] == static_cast<size_t>(-1))
+        {
+          slots[component[v]] = members.size();
+          members.push_back(std::vector<size_t>());
+        }
+        members[slots[component[v]]].push_back(v);
+      }
+    }
+
+    std::vector<E> amounts(digraph.edges.size());
+    for(size_t i = 0; i < amounts.size(); i++)
+      amounts[i] = digraph.edges[i]->getValue();
+
+    // components touch disjoint vertexes and edges, so tasks share the arrays without locking;
+    // small components are batched to keep the tasks worth scheduling
+    std::vector<size_t> cursors(digraph.offsets.begin(), digraph.offsets.end() - 1);
+    std::vector<unsigned char> states(digraph.size(), 0);
+    std::vector<size_t> pathPositions(digraph.size(), 0);
+    const size_t batchEdges = 4096;
+
+    std::vector<std::future<CycleCancellation<E> > > tasks;
+    for(size_t begin = 0; begin < members.size(); )
+    {
+      size_t end = begin, edges = 0;
+      while(end < members.size() && (end == begin || edges < batchEdges))
+      {
+        for(auto v = members[end].begin(); v != members[end].end(); ++v)
+          edges += digraph.offsets[*v + 1] - digraph.offsets[*v];
+        end++;
+      }
+
+      tasks.push_back(pool.submit([&, begin, end]()
+      {
+        CycleCancellation<E> batch;
+        for(size_t i = begin; i < end; i++)
+        {
+          CycleCancellation<E> part = cancelComponentCycles(digraph, component, members[i], amounts,
+                                                            cursors, states, pathPositions, epsilon);
+          batch.cycles += part.cycles;
+          batch.cancelled = batch.cancelled + part.cancelled;
+        }
+        return batch;
+      }));
+      begin = end;
+    }
+
+    CycleCancellation<E> result;
+    for(auto i = tasks.begin(); i != tasks.end(); ++i)
+    {
+      CycleCancellation<E> part = i->get();
+      result.cycles += part.cycles;
+      result.cancelled = result.cancelled + part.cancelled;
+    }
+
+    // untouched edges keep their values, even ones which were not above epsilon
+    for(size_t i = 0; i < amounts.size(); i++)
+    {
+      if(amounts[i] == digraph.edges[i]->getValue())
+        continue;
+      if(amounts[i] > epsilon)
+        graph.setEdgeValue(digraph.edges[i], amounts[i]);
+      else
+      {
+        graph.deleteEdge(digraph.edges[i]);
+        result.removedEdges++;
+      }
+    }
+    return result;
+  }
+
+} // end of namespace
+
+#endif // CYCLES_H
@@ -0,0 +1,297 @@
+#ifndef DOTWRITER_H
+#define DOTWRITER_H
+
+#include "vertex.h"
+#include "edge.h"
+#include "threadpool.h"
+#include "money.h"
+
+#include <list>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+namespace mg
+{
+  struct DotOptions
+  {
+    DotOptions(): colorByBalance(false), creditorColor("forestgreen"), debtorColor("firebrick") {}
+
+    /// Paints vertexes with positive balance (creditors) and negative balance (debtors)
+    bool colorByBalance;
+    const char* creditorColor;
+    const char* debtorColor;
+  };
+
+  /// Writes multigraph in DOT language to the sink.
+  /// Sink is any object with method append(const char* data, size_t size), std::string fits.
+  template<typename V, typename E, typename Sink>
+  class DotWriter
+  {
+  public:
+    DotWriter(Sink& sink, const DotOptions& options = DotOptions()): sink(sink), options(options) {}
+
+    /// @param vertexes is any container of Vertex<V, E>*, edges leading outside of it are written too
+    template<typename Container>
+    void write(const Container& vertexes);
+
+    void writeHeader();
+    void writeVertex(const Vertex<V, E>* vertex);
+    void writeOutgoingEdges(const Vertex<V, E>* vertex);
+    void writeFooter();
+
+  private:
+    void put(const char* str, size_t size) {sink.append(str, size);}
+    void put(const char* str) {sink.append(str, std::strlen(str));}
+
+    void putQuoted(const std::string& value) {putQuoted(value.data(), value.size());}
+    void putQuoted(const Money& value)
+    {
+      char buffer[24];
+      putQuoted(buffer, formatMoney(value, buffer));
+    }
+    void putQuoted(const char* str, size_t size);
+
+    template<typename T>
+    void putQuoted(const T& value)
+    {
+      putValue(value, std::integral_constant<bool, std::is_arithmetic<T>::value>());
+    }
+
+    template<typename T>
+    void putValue(const T& value, std::true_type);
+    template<typename T>
+    void putValue(const T& value, std::false_type);
+
+    Sink& sink;
+    DotOptions options;
+  };
+
+  /// Writes exactly the same text as DotWriter::write. Vertex range is split into chunks
+  /// of similar size, every chunk is formatted on @param pool into its own buffers,
+  /// buffers are appended to the sink in order. Must not be called from a task of the same pool.
+  template<typename V, typename E, typename Sink>
+  void writeDotParallel(const std::list<Vertex<V, E>*>& vertexes, Sink& sink, ThreadPool& pool,
+                        const DotOptions& options = DotOptions());
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename V, typename E, typename Sink>
+  template<typename Container>
+  void DotWriter<V, E, Sink>::write(const Container& vertexes)
+  {
+    writeHeader();
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+      writeVertex(*i);
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+      writeOutgoingEdges(*i);
+    writeFooter();
+  }
+
+  template<typename V, typename E, typename Sink>
+  void DotWriter<V, E, Sink>::writeHeader()
+  {
+    put("digraph {\n");
+  }
+
+  template<typename V, typename E, typename Sink>
+  void DotWriter<V, E, Sink>::writeVertex(const Vertex<V, E>* vertex)
+  {
+    putQuoted(vertex->getData());
+
+    if(options.colorByBalance)
+    {
+      const auto& outgoingEdges = vertex->getOutgoingEdges();
+      const auto& incomingEdges = vertex->getIncomingEdges();
+
+      E balance = E();
+      for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+        balance = balance + (*j)->getValue();
+      for(auto j = incomingEdges.begin(); j != incomingEdges.end(); ++j)
+        balance = balance - (*j)->getValue();
+
+      const char* color = NULL;
+      if(E() < balance)
+        color = options.creditorColor;
+      else if(balance < E())
+        color = options.debtorColor;
+
+      if(color)
+      {
+        put("[color=\"");
+        put(color);
+        put("\", fontcolor=\"");
+        put(color);
+        put("\"]");
+      }
+    }
+
+    put(";\n", 2);
+  }
+
+  template<typename V, typename E, typename Sink>
+  void DotWriter<V, E, Sink>::writeOutgoingEdges(const Vertex<V, E>* vertex)
+  {
+    const auto& outgoingEdges = vertex->getOutgoingEdges();
+    for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+    {
+      putQuoted(vertex->getData());
+      put("->", 2);
+      putQuoted((*j)->getDestination()->getData());
+      put("[label=");
+      putQuoted((*j)->getValue());
+      put("];\n", 3);
+    }
+  }
+
+  template<typename V, typename E, typename Sink>
+  void DotWriter<V, E, Sink>::writeFooter()
+  {
+    put("}\n", 2);
+  }
+
+  template<typename V, typename E, typename Sink>
+  void DotWriter<V, E, Sink>::putQuoted(const char* str, size_t size)
+  {
+    put("\"", 1);
+
+    // copy runs of plain characters at once, escape only what DOT treats specially
+    size_t runBegin = 0;
+    for(size_t i = 0; i < size; i++)
+    {
+      const char* escape = NULL;
+      switch(str[i])
+      {
+        case '"':  escape = "\\\""; break;
+        case '\\': escape = "\\\\"; break;
+        case '\n': escape = "\\n";  break;
+        case '\r': escape = "";     break;
+        default: continue;
+      }
+
+      put(str + runBegin, i - runBegin);
+      put(escape);
+      runBegin = i + 1;
+    }
+    put(str + runBegin, size - runBegin);
+
+    put("\"", 1);
+  }
+
+  template<typename V, typename E, typename Sink>
+  template<typename T>
+  void DotWriter<V, E, Sink>::putValue(const T& value, std::true_type)
+  {
+    // same text as std::ostream with default flags prints
+    char buffer[32];
+    int size;
+    if(std::is_floating_point<T>::value)
+      size = std::snprintf(buffer, sizeof(buffer), "%g", static_cast<double>(value));
+    else if(std::is_signed<T>::value)
+      size = std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+    else
+      size = std::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(value));
+
+    put("\"", 1);
+    put(buffer, static_cast<size_t>(size));
+    put("\"", 1);
+  }
+
+  template<typename V, typename E, typename Sink>
+  template<typename T>
+  void DotWriter<V, E, Sink>::putValue(const T& value, std::false_type)
+  {
+    std::ostringstream oss;
+    oss << value;
+    putQuoted(oss.str());
+  }
+
+  template<typename V, typename E, typename Sink>
+  void writeDotParallel(const std::list<Vertex<V, E>*>& vertexes, Sink& sink, ThreadPool& pool,
+                        const DotOptions& options)
+  {
+    // chunks smaller than this are formatted faster than they are scheduled
+    const size_t minChunkWeight = 4096;
+
+    // weight of a vertex is its node statement plus its edge statements
+    std::vector<const Vertex<V, E>*> order;
+    order.reserve(vertexes.size());
+    size_t totalWeight = 0;
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+    {
+      order.push_back(*i);
+      totalWeight += 1 + (*i)->getOutgoingEdges().size();
+    }
+
+    size_t chunksCount = std::min(pool.size() * 4, totalWeight / minChunkWeight);
+    if(chunksCount < 2)
+    {
+      DotWriter<V, E, Sink> writer(sink, options);
+      writer.write(vertexes);
+      return;
+    }
+
+    std::vector<size_t> bounds(1, 0);
+    size_t chunkWeight = totalWeight / chunksCount;
+    size_t weight = 0;
+    for(size_t i = 0; i < order.size(); i++)
+    {
+      weight += 1 + order[i]->getOutgoingEdges().size();
+      if(weight >= chunkWeight * bounds.size() && bounds.size() < chunksCount)
+        bounds.push_back(i + 1);
+    }
+    if(bounds.back() != order.size())
+      bounds.push_back(order.size());
+
+    struct ChunkText
+    {
+      std::string vertexes;
+      std::string edges;
+    };
+
+    std::vector<std::future<ChunkText> > futures;
+    futures.reserve(bounds.size() - 1);
+    for(size_t c = 0; c + 1 < bounds.size(); c++)
+    {
+      size_t begin = bounds[c];
+      size_t end = bounds[c + 1];
+      futures.push_back(pool.submit([&order, &options, begin, end]()
+      {
+        ChunkText text;
+        text.vertexes.reserve((end - begin) * 24);
+        text.edges.reserve((end - begin) * 48);
+        DotWriter<V, E, std::string> vertexesWriter(text.vertexes, options);
+        DotWriter<V, E, std::string> edgesWriter(text.edges, options);
+        for(size_t i = begin; i < end; i++)
+        {
+          vertexesWriter.writeVertex(order[i]);
+          edgesWriter.writeOutgoingEdges(order[i]);
+        }
+        return text;
+      }));
+    }
+
+    std::vector<ChunkText> texts;
+    texts.reserve(futures.size());
+    for(auto i = futures.begin(); i != futures.end(); ++i)
+      texts.push_back(i->get());
+
+    DotWriter<V, E, Sink> writer(sink, options);
+    writer.writeHeader();
+    for(auto i = texts.begin(); i != texts.end(); ++i)
+      sink.append(i->vertexes.data(), i->vertexes.size());
+    for(auto i = texts.begin(); i != texts.end(); ++i)
+      sink.append(i->edges.data(), i->edges.size());
+    writer.writeFooter();
+  }
+
+} // end of namespace
+
+#endif // DOTWRITER_H
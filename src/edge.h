@@ -20,7 +20,7 @@ public:
 
   Vertex<V, E>* getSource() const {return source;}
 
-  E getValue() const {return value;}
+  const E& getValue() const {return value;}
   void setValue(const E &value) {this->value = value;}
 
 private:
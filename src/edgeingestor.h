@@ -0,0 +1,150 @@
+#ifndef EDGEINGESTOR_H
+#define EDGEINGESTOR_H
+
+#include "concurrentmultigraph.h"
+#include "ringbuffer.h"
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+
+namespace mg
+{
+  /// Lock-free front of a ConcurrentMultigraph: any number of producer threads enqueue
+  /// debt records, one applier thread drains the queue and inserts whole batches,
+  /// so the graph is locked once per batch instead of once per record.
+  template<typename V, typename E>
+  class EdgeIngestor
+  {
+  public:
+    typedef EdgeRecord<V, E> Record;
+
+    /// @param capacity records may wait in the queue, at most @param batchSize are applied at once
+    explicit EdgeIngestor(ConcurrentMultigraph<V, E>& graph, size_t capacity = 1 << 16,
+                          size_t batchSize = 4096, bool createVertexes = true);
+    /// Applies everything enqueued before stopping
+    ~EdgeIngestor();
+
+    EdgeIngestor(const EdgeIngestor&) = delete;
+    EdgeIngestor& operator= (const EdgeIngestor&) = delete;
+
+    /// Never blocks, returns false if the queue is full
+    bool tryEnqueue(const V& creditor, const V& debtor, const E& value);
+    /// Waits for free space while the queue is full
+    void enqueue(const V& creditor, const V& debtor, const E& value);
+
+    /// Returns once everything enqueued before the call is in the graph
+    void flush();
+
+    /// Records inserted into the graph and records skipped, as by ConcurrentMultigraph::addEdges()
+    size_t getApplied() const {return applied.load();}
+    size_t getRejected() const {return rejected.load();}
+
+  private:
+    void apply();
+    static void backOff(unsigned& idleRounds);
+
+    ConcurrentMultigraph<V, E>& graph;
+    MpscRingBuffer<Record> queue;
+    size_t batchSize;
+    bool createVertexes;
+
+    std::atomic<size_t> enqueued;
+    std::atomic<size_t> applied;
+    std::atomic<size_t> rejected;
+    std::atomic<bool> stopping;
+    std::thread applier;
+  };
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename V, typename E>
+  EdgeIngestor<V, E>::EdgeIngestor(ConcurrentMultigraph<V, E> &graph, size_t capacity,
+                                   size_t batchSize, bool createVertexes):
+    graph(graph), queue(capacity), batchSize(batchSize ? batchSize : 1), createVertexes(createVertexes),
+    enqueued(0), applied(0), rejected(0), stopping(false)
+  {
+    applier = std::thread(&EdgeIngestor::apply, this);
+  }
+
+  template<typename V, typename E>
+  EdgeIngestor<V, E>::~EdgeIngestor()
+  {
+    stopping = true;
+    applier.join();
+  }
+
+  template<typename V, typename E>
+  bool EdgeIngestor<V, E>::tryEnqueue(const V &creditor, const V &debtor, const E &value)
+  {
+    Record record(creditor, debtor, value);
+    if(!queue.tryPush(record))
+      return false;
+    enqueued.fetch_add(1, std::memory_order_release);
+    return true;
+  }
+
+  template<typename V, typename E>
+  void EdgeIngestor<V, E>::enqueue(const V &creditor, const V &debtor, const E &value)
+  {
+    Record record(creditor, debtor, value);
+    unsigned idleRounds = 0;
+    while(!queue.tryPush(record))
+      backOff(idleRounds);
+    enqueued.fetch_add(1, std::memory_order_release);
+  }
+
+  template<typename V, typename E>
+  void EdgeIngestor<V, E>::flush()
+  {
+    size_t target = enqueued.load(std::memory_order_acquire);
+    unsigned idleRounds = 0;
+    while(applied.load() + rejected.load() < target)
+      backOff(idleRounds);
+  }
+
+  template<typename V, typename E>
+  void EdgeIngestor<V, E>::apply()
+  {
+    std::vector<Record> batch;
+    batch.reserve(batchSize);
+    unsigned idleRounds = 0;
+
+    for(;;)
+    {
+      // read the flag first, records enqueued before stopping are still drained
+      bool last = stopping.load();
+      batch.clear();
+      if(!queue.popBatch(batch, batchSize))
+      {
+        if(last)
+          return;
+        backOff(idleRounds);
+        continue;
+      }
+
+      idleRounds = 0;
+      size_t added = graph.addEdges(batch, createVertexes);
+      rejected += batch.size() - added;
+      applied += added;
+    }
+  }
+
+  template<typename V, typename E>
+  void EdgeIngestor<V, E>::backOff(unsigned &idleRounds)
+  {
+    // spin briefly for short pauses, sleep when idle for longer
+    if(++idleRounds < 64)
+      std::this_thread::yield();
+    else
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+
+} // end of namespace
+
+#endif // EDGEINGESTOR_H
@@ -0,0 +1,144 @@
+#include "expressioncache.h"
+#include "../ThirdParty/tinyexpr-master/tinyexpr.h"
+
+#include <algorithm>
+#include <limits>
+#include <cctype>
+#include <cmath>
+
+using namespace mg;
+
+ExpressionCache::ExpressionCache(size_t capacity):
+  capacity(capacity)
+{
+
+}
+
+ExpressionCache::~ExpressionCache()
+{
+  clear();
+}
+
+void ExpressionCache::setVariables(const std::vector<std::string> &names)
+{
+  // compiled expressions point to the slots
+  clear();
+  this->names = names;
+  slots.assign(names.size(), 0.0);
+}
+
+double ExpressionCache::evaluate(const std::string &expression, const double *values, int *error)
+{
+  const te_program* program = compile(expression, error);
+  if(!program)
+    return std::numeric_limits<double>::quiet_NaN();
+
+  for(size_t i = 0; values && i < slots.size(); i++)
+    slots[i] = values[i];
+
+  return te_run(program);
+}
+
+bool ExpressionCache::evaluateBatch(const std::string &expression, const std::vector<const double*> &columns,
+                                    size_t rows, double *results, int *error)
+{
+  const te_program* program = compile(expression, error);
+  if(!program)
+    return false;
+
+  const size_t variablesCount = std::min(columns.size(), slots.size());
+  std::vector<const double*> bindings(variablesCount);
+  for(size_t i = 0; i < variablesCount; i++)
+    bindings[i] = &slots[i];
+
+  // te_run_batch counts rows in int
+  const size_t maxRows = static_cast<size_t>(std::numeric_limits<int>::max());
+  for(size_t begin = 0; begin < rows; begin += maxRows)
+  {
+    int count = static_cast<int>(std::min(rows - begin, maxRows));
+    std::vector<const double*> blockColumns(variablesCount);
+    for(size_t i = 0; i < variablesCount; i++)
+      blockColumns[i] = columns[i] + begin;
+    te_run_batch(program, bindings.data(), blockColumns.data(), static_cast<int>(variablesCount),
+                 count, results + begin);
+  }
+  return true;
+}
+
+void ExpressionCache::clear()
+{
+  for(auto i = compiled.begin(); i != compiled.end(); ++i)
+    te_program_free(i->second);
+  compiled.clear();
+}
+
+const te_program *ExpressionCache::compile(const std::string &expression, int *error)
+{
+  auto pos = compiled.find(expression);
+  if(pos != compiled.end())
+  {
+    if(error)
+      *error = 0;
+    return pos->second;
+  }
+
+  std::vector<te_variable> variables(names.size());
+  for(size_t i = 0; i < names.size(); i++)
+  {
+    variables[i].name = names[i].c_str();
+    variables[i].address = &slots[i];
+    variables[i].type = TE_VARIABLE;
+    variables[i].context = NULL;
+  }
+
+  int compileError = 0;
+  te_expr* expr = te_compile(expression.c_str(), variables.data(), static_cast<int>(variables.size()), &compileError);
+  if(error)
+    *error = compileError;
+  if(!expr)
+    return NULL;
+
+  // variables stay bound to the slots, the tree isn't needed after lowering
+  te_program* program = te_lower(expr);
+  te_free(expr);
+  if(!program)
+  {
+    if(error)
+      *error = 1;
+    return NULL;
+  }
+
+  // simple eviction: formulas of one import fit easily, start over when they don't
+  if(compiled.size() >= capacity)
+    clear();
+  compiled.insert(std::make_pair(expression, program));
+  return program;
+}
+
+Money mg::evaluateMoney(const std::string &expression, ExpressionCache &expressions, int *error)
+{
+  int localError = 0;
+  if(!error)
+    error = &localError;
+  *error = 0;
+
+  // plain numbers are taken as written, 0.1 stays ten cents without a trip through double
+  size_t begin = 0, end = expression.size();
+  while(begin < end && std::isspace(static_cast<unsigned char>(expression[begin])))
+    begin++;
+  while(end > begin && std::isspace(static_cast<unsigned char>(expression[end - 1])))
+    end--;
+  Money value;
+  if(parseMoney(expression.data() + begin, end - begin, value))
+    return value;
+
+  double result = expressions.evaluate(expression, NULL, error);
+  if(*error != 0)
+    return Money();
+  if(!(std::fabs(result) * Money::scale < 9.2e18))
+  {
+    *error = 1;
+    return Money();
+  }
+  return Money(result);
+}
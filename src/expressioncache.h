@@ -0,0 +1,58 @@
+#ifndef EXPRESSIONCACHE_H
+#define EXPRESSIONCACHE_H
+
+#include "money.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+struct te_program;
+
+namespace mg
+{
+  /// Compiles tinyexpr expressions once, lowers them to flat programs and keeps them by text.
+  /// Variables are bound by name to internal slots, every evaluation writes values into the slots.
+  /// Not thread-safe, use one cache per thread.
+  class ExpressionCache
+  {
+  public:
+    explicit ExpressionCache(size_t capacity = 1024);
+    ~ExpressionCache();
+
+    ExpressionCache(const ExpressionCache&) = delete;
+    ExpressionCache& operator= (const ExpressionCache&) = delete;
+
+    /// Expressions may use these variable names, compiled expressions are dropped
+    void setVariables(const std::vector<std::string>& names);
+    const std::vector<std::string>& getVariables() const {return names;}
+
+    /// Evaluates @param expression with @param values of the variables in order of setVariables().
+    /// On parse error returns NaN and sets @param error to the error position (as te_interp does).
+    double evaluate(const std::string& expression, const double* values = NULL, int* error = NULL);
+
+    /// Evaluates @param expression for every row: variable i takes columns[i][row],
+    /// result goes to results[row]. Rows are evaluated in blocks (te_run_batch). Returns false on parse error.
+    bool evaluateBatch(const std::string& expression, const std::vector<const double*>& columns,
+                       size_t rows, double* results, int* error = NULL);
+
+    size_t size() const {return compiled.size();}
+    void clear();
+
+  private:
+    const te_program* compile(const std::string& expression, int* error);
+
+    size_t capacity;
+    std::vector<std::string> names;
+    std::vector<double> slots;
+    std::unordered_map<std::string, te_program*> compiled;
+  };
+
+  /// Amount typed by a user: a decimal number is taken exactly, any other text is evaluated
+  /// as an expression with @param expressions and rounded to cents.
+  /// On parse error returns Money() and sets @param error to the error position (as te_interp does),
+  /// a result out of the range of Money sets it to 1.
+  Money evaluateMoney(const std::string& expression, ExpressionCache& expressions, int* error = NULL);
+} // end of mg namespace
+
+#endif // EXPRESSIONCACHE_H
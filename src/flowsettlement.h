@@ -0,0 +1,453 @@
+#ifndef FLOWSETTLEMENT_H
+#define FLOWSETTLEMENT_H
+
+#include "multigraph.h"
+#include "balance.h"
+#include "settlement.h"
+
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+namespace mg
+{
+  /// Settlement along existing debt relationships only: a person pays only someone they share
+  /// an edge or a group expense with, in either direction. Among such settlements the one with
+  /// the least total amount transferred is found, as a min-cost flow from creditors to debtors
+  /// where every unit moved over a relationship costs 1.
+  ///
+  /// Primal-dual algorithm on array-based residual graphs: shortest paths by reduced costs
+  /// (bucket queue, costs are small integers), then a blocking flow over the arcs of zero
+  /// reduced cost, until every balance is within epsilon of zero or no debtor can be reached.
+  /// Flows and potentials of the last solution are kept, the next solve() starts from them
+  /// while they stay optimal for the new ledger, e.g. after changed amounts or removed debts.
+  template<typename V, typename E>
+  class FlowSettlement
+  {
+  public:
+    explicit FlowSettlement(const E& epsilon = E()): epsilon(epsilon), phases(0), warmStarted(false) {}
+
+    std::vector<Transfer<V, E> > solve(const Multigraph<V, E>& graph);
+
+    /// Forgets the last solution, the next solve() starts from scratch
+    void reset();
+
+    /// Shortest path computations of the last solve()
+    size_t getPhases() const {return phases;}
+    /// The last solve() started from the previous solution
+    bool isWarmStarted() const {return warmStarted;}
+
+  private:
+    /// Residual arc r belongs to relationship r / 4 and flow r / 2: even arcs carry flow
+    /// at cost 1 without limit, odd arcs return it at cost -1 up to the flow on r ^ 1
+    bool hasCapacity(size_t arc) const {return !(arc & 1) || flows[arc / 2] > epsilon;}
+    long long reducedCost(size_t arc, size_t from, size_t to) const
+    {
+      return ((arc & 1) ? -1 : 1) + potentials[from] - potentials[to];
+    }
+
+    void build(const Multigraph<V, E>& graph);
+    bool warmStart();
+    bool shortestPaths();
+    bool levels();
+    void blockingFlow();
+    void store();
+
+    E epsilon;
+    size_t phases;
+    bool warmStarted;
+
+    // solution of the last solve(), matched to the new graph by vertex data
+    std::vector<V> lastData;
+    std::vector<std::pair<size_t, size_t> > lastPairs;
+    std::vector<E> lastFlows;
+    std::vector<long long> lastPotentials;
+
+    // residual graph of the current solve(), vertexes in order of getVertexes(),
+    // relationships as (smaller, larger) position pairs
+    std::vector<Vertex<V, E>*> vertexes;
+    std::vector<std::pair<size_t, size_t> > pairs;
+    std::vector<size_t> offsets;
+    std::vector<size_t> arcs;
+    std::vector<size_t> targets;
+    std::vector<E> flows;
+    std::vector<E> excess;
+    std::vector<long long> potentials;
+    std::vector<size_t> distances;
+    std::vector<size_t> level;
+    std::vector<size_t> cursors;
+    std::vector<std::vector<size_t> > buckets;
+  };
+
+  /// Constrained settlement of @param graph from scratch, see FlowSettlement
+  template<typename V, typename E>
+  std::vector<Transfer<V, E> > flowSettlement(const Multigraph<V, E>& graph, const E& epsilon = E());
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename V, typename E>
+  std::vector<Transfer<V, E> > FlowSettlement<V, E>::solve(const Multigraph<V, E>& graph)
+  {
+    build(graph);
+    warmStarted = warmStart();
+    if(!warmStarted)
+    {
+      std::fill(flows.begin(), flows.end(), E());
+      std::fill(potentials.begin(), potentials.end(), 0);
+    }
+
+    // what the flow leaves unsettled
+    excess = balances(graph);
+    for(size_t v = 0; v < vertexes.size(); v++)
+      for(size_t i = offsets[v]; i < offsets[v + 1]; i++)
+        if(!(arcs[i] & 1))
+          excess[v] = excess[v] - flows[arcs[i] / 2];
+    for(size_t v = 0; v < vertexes.size(); v++)
+      for(size_t i = offsets[v]; i < offsets[v + 1]; i++)
+        if(!(arcs[i] & 1))
+          excess[targets[i]] = excess[targets[i]] + flows[arcs[i] / 2];
+
+    phases = 0;
+    while(shortestPaths())
+    {
+      phases++;
+      if(!levels())
+        break;
+      blockingFlow();
+    }
+
+    store();
+
+    std::vector<Transfer<V, E> > transfers;
+    for(size_t v = 0; v < vertexes.size(); v++)
+      for(size_t i = offsets[v]; i < offsets[v + 1]; i++)
+        if(!(arcs[i] & 1) && flows[arcs[i] / 2] > epsilon)
+        {
+          Transfer<V, E> transfer = {vertexes[v], vertexes[targets[i]], flows[arcs[i] / 2]};
+          transfers.push_back(transfer);
+        }
+    return transfers;
+  }
+
+  template<typename V, typename E>
+  void FlowSettlement<V, E>::reset()
+  {
+    lastData.clear();
+    lastPairs.clear();
+    lastFlows.clear();
+    lastPotentials.clear();
+  }
+
+  template<typename V, typename E>
+  void FlowSettlement<V, E>::build(const Multigraph<V, E>& graph)
+  {
+    const auto& graphVertexes = graph.getVertexes();
+    vertexes.assign(graphVertexes.begin(), graphVertexes.end());
+    const size_t n = vertexes.size();
+
+    std::unordered_map<const Vertex<V, E>*, size_t> positions;
+    positions.reserve(n);
+    for(size_t i = 0; i < n; i++)
+      positions[vertexes[i]] = i;
+
+    // every relationship once
+    pairs.clear();
+    for(size_t v = 0; v < n; v++)
+    {
+      const auto& outgoingEdges = vertexes[v]->getOutgoingEdges();
+      for(auto i = outgoingEdges.begin(); i != outgoingEdges.end(); ++i)
+      {
+        size_t w = positions[(*i)->getDestination()];
+        if(w != v)
+          pairs.push_back(std::make_pair(std::min(v, w), std::max(v, w)));
+      }
+    }
+    const auto& groupExpenses = graph.getGroupExpenses();
+    for(auto i = groupExpenses.begin(); i != groupExpenses.end(); ++i)
+    {
+      i->forEachDebt([&](const Vertex<V, E>* payer, const Vertex<V, E>* participant, const E&)
+      {
+        size_t v = positions[payer], w = positions[participant];
+        if(w != v)
+          pairs.push_back(std::make_pair(std::min(v, w), std::max(v, w)));
+      });
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    // arcs 4k and 4k + 3 go from the smaller vertex, 4k + 1 and 4k + 2 from the larger one
+    offsets.assign(n + 1, 0);
+    for(auto i = pairs.begin(); i != pairs.end(); ++i)
+    {
+      offsets[i->first + 1] += 2;
+      offsets[i->second + 1] += 2;
+    }
+    for(size_t v = 0; v < n; v++)
+      offsets[v + 1] += offsets[v];
+
+    arcs.resize(offsets[n]);
+    targets.resize(offsets[n]);
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    for(size_t k = 0; k < pairs.size(); k++)
+    {
+      size_t a = pairs[k].first, b = pairs[k].second;
+      const size_t fromA[] = {4 * k, 4 * k + 3}, fromB[] = {4 * k + 1, 4 * k + 2};
+      for(size_t j = 0; j < 2; j++)
+      {
+        arcs[next[a]] = fromA[j];
+        targets[next[a]++] = b;
+        arcs[next[b]] = fromB[j];
+        targets[next[b]++] = a;
+      }
+    }
+
+    flows.assign(2 * pairs.size(), E());
+    potentials.assign(n, 0);
+  }
+
+  template<typename V, typename E>
+  bool FlowSettlement<V, E>::warmStart()
+  {
+    if(lastData.empty())
+      return false;
+
+    bool same = lastData.size() == vertexes.size() && lastPairs == pairs;
+    for(size_t v = 0; same && v < vertexes.size(); v++)
+      same = lastData[v] == vertexes[v]->getData();
+
+    if(same)
+    {
+      flows = lastFlows;
+      potentials = lastPotentials;
+    }
+    else
+    {
+      // persons and relationships by vertex data, the order of the vertexes may have changed
+      std::unordered_map<V, size_t> lastPositions;
+      lastPositions.reserve(lastData.size());
+      for(size_t v = 0; v < lastData.size(); v++)
+        lastPositions[lastData[v]] = v;
+
+      const size_t missing = std::numeric_limits<size_t>::max();
+      std::vector<size_t> moved(vertexes.size(), missing);
+      for(size_t v = 0; v < vertexes.size(); v++)
+      {
+        auto position = lastPositions.find(vertexes[v]->getData());
+        if(position == lastPositions.end())
+          continue;
+        moved[v] = position->second;
+        potentials[v] = lastPotentials[position->second];
+      }
+
+      std::unordered_map<uint64_t, size_t> lastRelationships;
+      lastRelationships.reserve(lastPairs.size());
+      for(size_t k = 0; k < lastPairs.size(); k++)
+        lastRelationships[static_cast<uint64_t>(lastPairs[k].first) * lastData.size() + lastPairs[k].second] = k;
+
+      for(size_t k = 0; k < pairs.size(); k++)
+      {
+        size_t a = moved[pairs[k].first], b = moved[pairs[k].second];
+        if(a == missing || b == missing)
+          continue;
+        auto relationship = lastRelationships.find(static_cast<uint64_t>(std::min(a, b)) * lastData.size() + std::max(a, b));
+        if(relationship == lastRelationships.end())
+          continue;
+        size_t flow = 2 * relationship->second;
+        flows[2 * k] = lastFlows[a < b ? flow : flow + 1];
+        flows[2 * k + 1] = lastFlows[a < b ? flow + 1 : flow];
+      }
+    }
+
+    // the old flow is optimal for its own balances only if no residual arc got cheaper than free,
+    // new relationships or persons may break that
+    for(size_t v = 0; v < vertexes.size(); v++)
+      for(size_t i = offsets[v]; i < offsets[v + 1]; i++)
+        if(hasCapacity(arcs[i]) && reducedCost(arcs[i], v, targets[i]) < 0)
+          return false;
+    return true;
+  }
+
+  /// Dijkstra from all creditors by reduced costs, stopped at the nearest debtor; potentials
+  /// grow by the distances capped at that debtor's one, which keeps reduced costs non-negative
+  /// and makes the shortest paths to it free
+  template<typename V, typename E>
+  bool FlowSettlement<V, E>::shortestPaths()
+  {
+    const size_t unreached = std::numeric_limits<size_t>::max();
+    const size_t n = vertexes.size();
+    distances.assign(n, unreached);
+    for(auto i = buckets.begin(); i != buckets.end(); ++i)
+      i->clear();
+    if(buckets.empty())
+      buckets.resize(1);
+
+    for(size_t v = 0; v < n; v++)
+      if(excess[v] > epsilon)
+      {
+        distances[v] = 0;
+        buckets[0].push_back(v);
+      }
+
+    size_t nearest = unreached;
+    for(size_t d = 0; d < buckets.size() && nearest == unreached; d++)
+    {
+      // the bucket may grow while it is scanned
+      for(size_t j = 0; j < buckets[d].size(); j++)
+      {
+        size_t v = buckets[d][j];
+        if(distances[v] != d)
+          continue;
+        if(E() - excess[v] > epsilon)
+        {
+          nearest = d;
+          break;
+        }
+
+        for(size_t i = offsets[v]; i < offsets[v + 1]; i++)
+        {
+          size_t w = targets[i];
+          if(!hasCapacity(arcs[i]))
+            continue;
+          size_t candidate = d + static_cast<size_t>(reducedCost(arcs[i], v, w));
+          if(candidate < distances[w])
+          {
+            distances[w] = candidate;
+            if(candidate >= buckets.size())
+              buckets.resize(candidate + 1);
+            buckets[candidate].push_back(w);
+          }
+        }
+      }
+    }
+    if(nearest == unreached)
+      return false;
+
+    for(size_t v = 0; v < n; v++)
+      potentials[v] += static_cast<long long>(std::min(distances[v], nearest));
+    return true;
+  }
+
+  /// Breadth first levels from all creditors over free arcs with capacity
+  template<typename V, typename E>
+  bool FlowSettlement<V, E>::levels()
+  {
+    const size_t unreached = std::numeric_limits<size_t>::max();
+    const size_t n = vertexes.size();
+    level.assign(n, unreached);
+    std::vector<size_t>& queue = buckets[0];
+    queue.clear();
+    for(size_t v = 0; v < n; v++)
+      if(excess[v] > epsilon)
+      {
+        level[v] = 0;
+        queue.push_back(v);
+      }
+
+    bool debtorReached = false;
+    for(size_t j = 0; j < queue.size(); j++)
+    {
+      size_t v = queue[j];
+      if(E() - excess[v] > epsilon)
+        debtorReached = true;
+      for(size_t i = offsets[v]; i < offsets[v + 1]; i++)
+      {
+        size_t w = targets[i];
+        if(level[w] == unreached && hasCapacity(arcs[i]) && reducedCost(arcs[i], v, w) == 0)
+        {
+          level[w] = level[v] + 1;
+          queue.push_back(w);
+        }
+      }
+    }
+    cursors.assign(offsets.begin(), offsets.end() - 1);
+    return debtorReached;
+  }
+
+  /// Augments along level-increasing free paths from every creditor until none is left;
+  /// dead ends are cut off by advancing the per-vertex cursors, as in Dinic's algorithm
+  template<typename V, typename E>
+  void FlowSettlement<V, E>::blockingFlow()
+  {
+    const size_t dead = std::numeric_limits<size_t>::max();
+    std::vector<size_t> path, pathVertexes;
+
+    for(size_t source = 0; source < vertexes.size(); source++)
+    {
+      if(level[source] != 0)
+        continue;
+
+      while(excess[source] > epsilon)
+      {
+        path.clear();
+        pathVertexes.assign(1, source);
+        size_t v = source;
+        while(!(v != source && E() - excess[v] > epsilon))
+        {
+          size_t& cursor = cursors[v];
+          while(cursor < offsets[v + 1]
+                && (level[targets[cursor]] != level[v] + 1 || !hasCapacity(arcs[cursor]) || reducedCost(arcs[cursor], v, targets[cursor]) != 0))
+            cursor++;
+
+          if(cursor == offsets[v + 1])
+          {
+            level[v] = dead;
+            if(path.empty())
+              break;
+            path.pop_back();
+            pathVertexes.pop_back();
+            v = pathVertexes.back();
+            cursors[v]++;
+            continue;
+          }
+
+          path.push_back(cursor);
+          v = targets[cursor];
+          pathVertexes.push_back(v);
+        }
+        if(level[source] == dead)
+          break;
+
+        E amount = std::min(excess[source], E() - excess[v]);
+        for(auto i = path.begin(); i != path.end(); ++i)
+          if(arcs[*i] & 1)
+            amount = std::min(amount, flows[arcs[*i] / 2]);
+
+        for(auto i = path.begin(); i != path.end(); ++i)
+        {
+          E& flow = flows[arcs[*i] / 2];
+          flow = (arcs[*i] & 1) ? flow - amount : flow + amount;
+        }
+        excess[source] = excess[source] - amount;
+        excess[v] = excess[v] + amount;
+      }
+    }
+  }
+
+  template<typename V, typename E>
+  void FlowSettlement<V, E>::store()
+  {
+    lastData.resize(vertexes.size());
+    for(size_t v = 0; v < vertexes.size(); v++)
+      lastData[v] = vertexes[v]->getData();
+    lastPairs = pairs;
+    lastFlows = flows;
+    lastPotentials = potentials;
+  }
+
+  template<typename V, typename E>
+  std::vector<Transfer<V, E> > flowSettlement(const Multigraph<V, E>& graph, const E& epsilon)
+  {
+    FlowSettlement<V, E> settlement(epsilon);
+    return settlement.solve(graph);
+  }
+
+} // end of namespace
+
+#endif // FLOWSETTLEMENT_H
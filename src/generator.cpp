@@ -0,0 +1,229 @@
+#include "generator.h"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace mg;
+
+namespace
+{
+  // output is flushed in pieces of this size
+  const size_t bufferSize = 1 << 20;
+
+  void appendNumber(std::string& text, uint64_t value)
+  {
+    char digits[20];
+    size_t size = 0;
+    do
+    {
+      digits[size++] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while(value);
+
+    while(size)
+      text.push_back(digits[--size]);
+  }
+
+  void appendName(std::string& text, size_t vertex)
+  {
+    text.append("person", 6);
+    appendNumber(text, vertex);
+  }
+
+  // shortest exact form of an amount in cents: 12, 12.5 or 12.05
+  void appendCents(std::string& text, int64_t cents)
+  {
+    if(cents < 0)
+    {
+      text.push_back('-');
+      cents = -cents;
+    }
+    appendNumber(text, static_cast<uint64_t>(cents / 100));
+    int64_t fraction = cents % 100;
+    if(!fraction)
+      return;
+
+    text.push_back('.');
+    text.push_back(static_cast<char>('0' + fraction / 10));
+    if(fraction % 10)
+      text.push_back(static_cast<char>('0' + fraction % 10));
+  }
+}
+
+AliasTable::AliasTable(const std::vector<double> &weights):
+  probability(weights.size()),
+  alias(weights.size())
+{
+  const size_t size = weights.size();
+  double sum = 0;
+  for(auto i = weights.begin(); i != weights.end(); ++i)
+    sum += *i;
+
+  // Vose's method: every cell holds its own probability and one alias for the rest
+  std::vector<double> scaled(size);
+  std::vector<size_t> small, large;
+  for(size_t i = 0; i < size; i++)
+  {
+    scaled[i] = weights[i] * size / sum;
+    (scaled[i] < 1 ? small : large).push_back(i);
+  }
+
+  while(!small.empty() && !large.empty())
+  {
+    size_t less = small.back();
+    size_t more = large.back();
+    small.pop_back();
+    probability[less] = scaled[less];
+    alias[less] = more;
+
+    scaled[more] = (scaled[more] + scaled[less]) - 1;
+    if(scaled[more] < 1)
+    {
+      large.pop_back();
+      small.push_back(more);
+    }
+  }
+
+  // leftovers are 1 up to rounding errors
+  for(auto i = small.begin(); i != small.end(); ++i)
+    probability[*i] = 1;
+  for(auto i = large.begin(); i != large.end(); ++i)
+    probability[*i] = 1;
+}
+
+size_t AliasTable::sample(SplitMix64 &random) const
+{
+  size_t cell = random.below(probability.size());
+  return random.uniform() < probability[cell] ? cell : alias[cell];
+}
+
+DebtGenerator::DebtGenerator(const GeneratorOptions &options):
+  options(options),
+  random(options.seed),
+  generated(0)
+{
+  if(options.vertexes < 2)
+    THROW_MG_EXCEPTION("Generator needs at least two vertexes!");
+
+  this->options.communities = std::max<size_t>(1, std::min(options.communities, options.vertexes / 2));
+  const size_t communities = this->options.communities;
+
+  // Chung-Lu weights, degree of the r-th person of a community falls as r^(-1/(exponent-1))
+  std::vector<double> weights(options.vertexes);
+  std::vector<std::vector<double> > communityWeights(communities);
+  for(size_t i = 0; i < options.vertexes; i++)
+  {
+    size_t community = communityOf(i);
+    size_t rank = communityWeights[community].size();
+    weights[i] = options.degreeExponent > 1 ? std::pow(rank + 1., -1. / (options.degreeExponent - 1)) : 1.;
+    communityWeights[community].push_back(weights[i]);
+  }
+
+  everybody = AliasTable(weights);
+  if(communities > 1)
+    for(auto i = communityWeights.begin(); i != communityWeights.end(); ++i)
+      communityTables.push_back(AliasTable(*i));
+
+  minCents = static_cast<int64_t>(std::llround(options.minAmount * 100));
+  centsRange = std::max<int64_t>(1, static_cast<int64_t>(std::llround(options.maxAmount * 100)) - minCents + 1);
+
+  previous.creditor = previous.debtor = 0;
+  previous.cents = 0;
+}
+
+bool DebtGenerator::next(GeneratedDebt &debt)
+{
+  if(generated == options.edges)
+    return false;
+
+  double kind = random.uniform();
+  if(generated && kind < options.parallelEdgeRate)
+  {
+    debt.creditor = previous.creditor;
+    debt.debtor = previous.debtor;
+  }
+  else if(generated && kind < options.parallelEdgeRate + options.reverseDebtRate)
+  {
+    debt.creditor = previous.debtor;
+    debt.debtor = previous.creditor;
+  }
+  else
+  {
+    debt.creditor = everybody.sample(random);
+    debt.debtor = sampleDebtor(debt.creditor);
+  }
+  debt.cents = minCents + static_cast<int64_t>(random.below(static_cast<size_t>(centsRange)));
+
+  previous = debt;
+  generated++;
+  return true;
+}
+
+std::string DebtGenerator::vertexName(size_t vertex)
+{
+  std::string name;
+  appendName(name, vertex);
+  return name;
+}
+
+size_t DebtGenerator::communityOf(size_t vertex) const
+{
+  // community c starts at ceil(c * vertexes / communities)
+  return static_cast<size_t>(static_cast<uint64_t>(vertex) * options.communities / options.vertexes);
+}
+
+size_t DebtGenerator::sampleDebtor(size_t creditor)
+{
+  const size_t communities = options.communities;
+  bool inside = communities > 1 && random.uniform() >= options.communityMixing;
+  size_t community = communityOf(creditor);
+  size_t begin = static_cast<size_t>((static_cast<uint64_t>(community) * options.vertexes + communities - 1) / communities);
+
+  // loops are not allowed, a few retries keep the distribution, the fallback keeps the time bounded
+  for(int attempt = 0; attempt < 8; attempt++)
+  {
+    size_t debtor = inside ? begin + communityTables[community].sample(random) : everybody.sample(random);
+    if(debtor != creditor)
+      return debtor;
+  }
+  return (creditor + 1) % options.vertexes;
+}
+
+void mg::writeGeneratedMg(std::ostream &output, const GeneratorOptions &options)
+{
+  DebtGenerator generator(options);
+
+  std::string text;
+  text.reserve(bufferSize + 64);
+  auto flush = [&]()
+  {
+    output.write(text.data(), text.size());
+    text.clear();
+  };
+
+  appendNumber(text, options.vertexes);
+  text.push_back('\n');
+  for(size_t i = 0; i < options.vertexes; i++)
+  {
+    appendName(text, i);
+    text.push_back('\n');
+    if(text.size() >= bufferSize)
+      flush();
+  }
+
+  appendNumber(text, options.edges);
+  text.push_back('\n');
+  GeneratedDebt debt;
+  while(generator.next(debt))
+  {
+    appendName(text, debt.creditor);
+    text.push_back('\n');
+    appendName(text, debt.debtor);
+    text.push_back('\n');
+    appendCents(text, debt.cents);
+    text.push_back('\n');
+    if(text.size() >= bufferSize)
+      flush();
+  }
+  flush();
+}
@@ -0,0 +1,132 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include "multigraph.h"
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+namespace mg
+{
+  struct GeneratorOptions
+  {
+    GeneratorOptions(): vertexes(1000), edges(10000), seed(1), degreeExponent(2.5),
+      communities(1), communityMixing(0.1), parallelEdgeRate(0.05), reverseDebtRate(0.05),
+      minAmount(1), maxAmount(1000) {}
+
+    size_t vertexes;
+    size_t edges;
+    /// Equal seeds and options give equal graphs on every platform
+    uint64_t seed;
+    /// Exponent of the power-law degree distribution, 0 gives uniform degrees
+    double degreeExponent;
+    /// Vertexes are split into this many equal communities of consecutive persons
+    size_t communities;
+    /// Share of edges leading out of the creditor community
+    double communityMixing;
+    /// Share of edges repeating the pair of the previous edge
+    double parallelEdgeRate;
+    /// Share of edges returning the previous debt in the opposite direction
+    double reverseDebtRate;
+    /// Amounts are uniform in cents between these bounds
+    double minAmount;
+    double maxAmount;
+  };
+
+  struct GeneratedDebt
+  {
+    size_t creditor;
+    size_t debtor;
+    int64_t cents;
+
+    double amount() const {return cents / 100.;}
+  };
+
+  /// Counter hashed with the splitmix64 finalizer, the same numbers on every standard library
+  class SplitMix64
+  {
+  public:
+    explicit SplitMix64(uint64_t seed): state(seed) {}
+
+    uint64_t next() {return mixHash(state++);}
+    /// Uniform in [0, 1)
+    double uniform() {return (next() >> 11) * (1. / 9007199254740992.);}
+    /// Uniform in [0, n)
+    size_t below(size_t n) {return static_cast<size_t>(uniform() * n);}
+
+  private:
+    uint64_t state;
+  };
+
+  /// Walker alias table, samples an index proportionally to its weight in O(1)
+  class AliasTable
+  {
+  public:
+    AliasTable() {}
+    explicit AliasTable(const std::vector<double>& weights);
+
+    size_t sample(SplitMix64& random) const;
+    size_t size() const {return probability.size();}
+
+  private:
+    std::vector<double> probability;
+    std::vector<size_t> alias;
+  };
+
+  /// Produces the debts of a synthetic ledger one by one,
+  /// creditors and debtors are numbers of persons in [0, options.vertexes)
+  class DebtGenerator
+  {
+  public:
+    explicit DebtGenerator(const GeneratorOptions& options);
+
+    /// Returns false after options.edges debts
+    bool next(GeneratedDebt& debt);
+
+    static std::string vertexName(size_t vertex);
+
+  private:
+    size_t communityOf(size_t vertex) const;
+    size_t sampleDebtor(size_t creditor);
+
+    GeneratorOptions options;
+    SplitMix64 random;
+    AliasTable everybody;
+    std::vector<AliasTable> communityTables;
+    int64_t minCents;
+    int64_t centsRange;
+    size_t generated;
+    GeneratedDebt previous;
+  };
+
+  /// Fills @param graph with a generated ledger, persons are named by DebtGenerator::vertexName
+  template<typename V, typename E>
+  void generateGraph(Multigraph<V, E>& graph, const GeneratorOptions& options);
+
+  /// Writes a generated ledger in .mg format without building the graph
+  void writeGeneratedMg(std::ostream& output, const GeneratorOptions& options);
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename V, typename E>
+  void generateGraph(Multigraph<V, E>& graph, const GeneratorOptions& options)
+  {
+    std::vector<Vertex<V, E>*> vertexes(options.vertexes);
+    for(size_t i = 0; i < options.vertexes; i++)
+      graph.tryAddVertex(V(DebtGenerator::vertexName(i)), &vertexes[i]);
+
+    DebtGenerator generator(options);
+    GeneratedDebt debt;
+    while(generator.next(debt))
+      graph.addEdge(vertexes[debt.creditor], vertexes[debt.debtor], E(debt.amount()));
+  }
+
+} // end of namespace
+
+#endif // GENERATOR_H
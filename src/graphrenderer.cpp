@@ -0,0 +1,265 @@
+#include "graphrenderer.h"
+#include "components.h"
+#include "mgstats.h"
+#include "tracer.h"
+
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  typedef std::vector<mg::Vertex<std::string, mg::Money>*> Group;
+
+  // components smaller than this are laid out together, one graphviz call per batch
+  const size_t smallComponentSize = 16;
+  const size_t batchSize = 256;
+
+  // space between packed pictures
+  const qreal spacing = 20;
+
+  // cache limit in kilobytes of svg
+  const int cacheSize = 64 * 1024;
+
+  // svg of a group, or why graphviz failed
+  struct Picture
+  {
+    QByteArray svg;
+    QString error;
+  };
+
+  struct LayoutGroup
+  {
+    typedef Picture result_type;
+
+    LayoutGroup(const mg::DotOptions& options): options(options) {}
+
+    Picture operator()(const Group& group) const
+    {
+      std::string dotText;
+      {
+        MD_TRACE_SCOPE("dot text");
+        dotText.reserve(32 + group.size() * 72);
+        mg::DotWriter<std::string, mg::Money, std::string> writer(dotText, options);
+        writer.write(group);
+      }
+      Picture picture;
+      picture.svg = GraphRenderer::layout(dotText, &picture.error);
+      return picture;
+    }
+
+    mg::DotOptions options;
+  };
+
+  // every big component is a group, small ones are batched
+  QVector<Group> groupComponents(const GraphRenderer::Graph& graph)
+  {
+    MG_STATS_TIMER(TIMER_RENDER_COMPONENTS);
+    MD_TRACE_SCOPE("connected components");
+    mg::ConnectedComponents<std::string, mg::Money> connectedComponents(graph);
+    auto components = connectedComponents.groups();
+
+    QVector<Group> groups;
+    Group batch;
+    for(auto i = components.begin(); i != components.end(); ++i)
+    {
+      if(i->size() >= smallComponentSize)
+      {
+        groups.push_back(std::move(*i));
+        continue;
+      }
+
+      batch.insert(batch.end(), i->begin(), i->end());
+      if(batch.size() >= batchSize)
+      {
+        groups.push_back(std::move(batch));
+        batch.clear();
+      }
+    }
+    if(!batch.empty())
+      groups.push_back(std::move(batch));
+    return groups;
+  }
+
+  QList<Picture> layoutGroups(const QVector<Group>& groups, const mg::DotOptions& options)
+  {
+    MG_STATS_TIMER(TIMER_RENDER_LAYOUT);
+    return QtConcurrent::blockingMapped<QList<Picture> >(groups, LayoutGroup(options));
+  }
+}
+
+GraphRenderer::GraphRenderer(QGraphicsScene *scene):
+  scene(scene),
+  cache(cacheSize),
+  shownKey(0),
+  shownValid(false)
+{
+
+}
+
+GraphRenderer::~GraphRenderer()
+{
+  clear();
+}
+
+bool GraphRenderer::render(const Graph &graph, const mg::DotOptions &options, QString *error)
+{
+  quint64 key = mg::mixHash(graph.getContentHash() + (options.colorByBalance ? 1 : 0));
+  if(shownValid && key == shownKey)
+    return true;
+
+  QList<QByteArray> *cached = cache.object(key);
+  if(cached)
+  {
+    show(*cached);
+    shownKey = key;
+    shownValid = true;
+    return true;
+  }
+
+  QVector<Group> groups = groupComponents(graph);
+  QList<Picture> laidOut = layoutGroups(groups, options);
+
+  // the first failure is reported, the other components are shown
+  QList<QByteArray> pictures;
+  bool succeeded = true;
+  for(auto i = laidOut.begin(); i != laidOut.end(); ++i)
+  {
+    pictures.push_back(i->svg);
+    if(!i->svg.isEmpty())
+      continue;
+    if(succeeded && error)
+      *error = i->error;
+    succeeded = false;
+  }
+
+  show(pictures);
+
+  shownKey = key;
+  shownValid = succeeded;
+  if(succeeded)
+  {
+    int cost = 1;
+    for(auto i = pictures.begin(); i != pictures.end(); ++i)
+      cost += i->size() / 1024;
+    cache.insert(key, new QList<QByteArray>(pictures), cost);
+  }
+
+  return succeeded;
+}
+
+QByteArray GraphRenderer::layout(const std::string &dotText, QString *error)
+{
+  MD_TRACE_SCOPE("graphviz");
+  QProcess dot;
+  dot.start(dotProgram(), QStringList() << "-Tsvg");
+  if(!dot.waitForStarted())
+  {
+    if(error)
+      *error = "Can't start graphviz '" + dotProgram() + "'";
+    return QByteArray();
+  }
+
+  dot.write(dotText.data(), dotText.size());
+  dot.closeWriteChannel();
+  dot.waitForFinished(-1);
+
+  QByteArray svg = dot.readAllStandardOutput();
+  if(dot.exitStatus() == QProcess::NormalExit && dot.exitCode() == 0 && !svg.isEmpty())
+    return svg;
+
+  // graphviz ran but failed, its own messages tell why
+  if(error)
+  {
+    if(dot.exitStatus() != QProcess::NormalExit)
+      *error = "Graphviz '" + dotProgram() + "' crashed";
+    else if(dot.exitCode() != 0)
+      *error = "Graphviz '" + dotProgram() + "' failed with exit code " + QString::number(dot.exitCode());
+    else
+      *error = "Graphviz '" + dotProgram() + "' gave no picture";
+    QString messages = QString::fromLocal8Bit(dot.readAllStandardError()).trimmed();
+    if(!messages.isEmpty())
+      *error += ":\n" + messages;
+  }
+  return QByteArray();
+}
+
+QString GraphRenderer::dotProgram()
+{
+#if defined(_WIN32) || defined(_WIN64)
+  return QProcessEnvironment::systemEnvironment().value("DOT_DIR") + "\\bin\\dot.exe";
+#else
+  return "dot";
+#endif
+}
+
+void GraphRenderer::clear()
+{
+  qDeleteAll(items);
+  qDeleteAll(renderers);
+  items.clear();
+  renderers.clear();
+}
+
+void GraphRenderer::show(const QList<QByteArray> &pictures)
+{
+  MG_STATS_TIMER(TIMER_RENDER_SHOW);
+  MD_TRACE_SCOPE("svg reload");
+  clear();
+
+  for(auto i = pictures.begin(); i != pictures.end(); ++i)
+  {
+    if(i->isEmpty())
+      continue;
+
+    QSvgRenderer *renderer = new QSvgRenderer(*i);
+    QGraphicsSvgItem *item = new QGraphicsSvgItem();
+    item->setSharedRenderer(renderer);
+    scene->addItem(item);
+    renderers.push_back(renderer);
+    items.push_back(item);
+  }
+
+  pack();
+}
+
+void GraphRenderer::pack()
+{
+  // shelf packing: tallest pictures first, rows are filled up to the side of a square
+  std::sort(items.begin(), items.end(), [](QGraphicsSvgItem *a, QGraphicsSvgItem *b)
+  {
+    return a->boundingRect().height() > b->boundingRect().height();
+  });
+
+  qreal area = 0;
+  qreal widest = 0;
+  for(auto i = items.begin(); i != items.end(); ++i)
+  {
+    QRectF rect = (*i)->boundingRect();
+    area += (rect.width() + spacing) * (rect.height() + spacing);
+    widest = std::max(widest, rect.width());
+  }
+  qreal rowWidth = std::max(widest, std::sqrt(area));
+
+  qreal x = 0, y = 0, rowHeight = 0;
+  for(auto i = items.begin(); i != items.end(); ++i)
+  {
+    QRectF rect = (*i)->boundingRect();
+    if(x > 0 && x + rect.width() > rowWidth)
+    {
+      x = 0;
+      y += rowHeight + spacing;
+      rowHeight = 0;
+    }
+    (*i)->setPos(x, y);
+    x += rect.width() + spacing;
+    rowHeight = std::max(rowHeight, rect.height());
+  }
+
+  scene->setSceneRect(scene->itemsBoundingRect());
+}
@@ -0,0 +1,49 @@
+#ifndef GRAPHRENDERER_H
+#define GRAPHRENDERER_H
+
+#include "multigraph.h"
+#include "money.h"
+
+#include <QGraphicsScene>
+#include <QGraphicsSvgItem>
+#include <QSvgRenderer>
+#include <QByteArray>
+#include <QString>
+#include <QList>
+#include <QCache>
+
+/// Lays out every weakly connected component of the graph with its own graphviz call,
+/// calls run concurrently in the global QThreadPool, pictures are packed into one scene.
+/// Pictures are cached by the graph content hash, so unchanged graphs and graphs
+/// returned to an earlier state are shown without running graphviz.
+class GraphRenderer
+{
+public:
+  typedef mg::Multigraph<std::string, mg::Money> Graph;
+
+  explicit GraphRenderer(QGraphicsScene *scene);
+  ~GraphRenderer();
+
+  /// Returns false if graphviz failed for some component, @param error tells why
+  bool render(const Graph& graph, const mg::DotOptions& options, QString* error = NULL);
+
+  /// Pipes @param dotText to graphviz, returns svg or empty array on failure:
+  /// @param error is then set to a start failure or to the exit code and messages of graphviz
+  static QByteArray layout(const std::string& dotText, QString* error = NULL);
+
+  static QString dotProgram();
+
+private:
+  void clear();
+  void show(const QList<QByteArray>& pictures);
+  void pack();
+
+  QGraphicsScene *scene;
+  QCache<quint64, QList<QByteArray> > cache;
+  quint64 shownKey;
+  bool shownValid;
+  QList<QSvgRenderer*> renderers;
+  QList<QGraphicsSvgItem*> items;
+};
+
+#endif // GRAPHRENDERER_H
@@ -0,0 +1,236 @@
+#ifndef GROUPEXPENSE_H
+#define GROUPEXPENSE_H
+
+#include "vertex.h"
+#include "mgexception.h"
+#include "money.h"
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <type_traits>
+
+namespace mg
+{
+  enum SplitRule { SPLIT_EQUAL,     // total is divided equally
+                   SPLIT_WEIGHTED,  // total is divided in proportion to shares
+                   SPLIT_EXACT };   // shares are the amounts, total is their sum
+
+  /// One payer covers an expense shared by participants. Stored once instead of an edge per
+  /// participant, pairwise debts (payer is the creditor) are derived on demand.
+  /// The payer may be a participant too, the payer's own part isn't a debt.
+  template<typename V, typename E>
+  class GroupExpense
+  {
+  public:
+    GroupExpense(Vertex<V, E>* payer, E total, SplitRule rule,
+                 const std::vector<Vertex<V, E>*>& participants, const std::vector<E>& shares);
+
+    Vertex<V, E>* getPayer() const {return payer;}
+    const E& getTotal() const {return total;}
+    SplitRule getRule() const {return rule;}
+    const std::vector<Vertex<V, E>*>& getParticipants() const {return participants;}
+    /// Weights or exact amounts, empty for SPLIT_EQUAL
+    const std::vector<E>& getShares() const {return shares;}
+
+    /// Part of the total paid for participant @param i
+    E partOf(size_t i) const;
+    /// False once no participant is left or the remaining weights add up to zero,
+    /// such a record splits nothing and is dropped by the multigraph
+    bool hasParts() const;
+
+    /// Calls @param f(payer, participant, amount) for every derived debt
+    template<typename F>
+    void forEachDebt(F f) const;
+
+    /// Removes the participant, remaining parts are recomputed by the rule
+    void removeParticipant(const Vertex<V, E>* participant);
+
+  private:
+    void recomputeTotals();
+
+    Vertex<V, E>* payer;
+    E total;
+    SplitRule rule;
+    std::vector<Vertex<V, E>*> participants;
+    std::vector<E> shares;
+    E sharesSum;
+    /// Parts of SPLIT_WEIGHTED, computed with the totals
+    std::vector<E> parts;
+  };
+
+  const char* splitRuleName(SplitRule rule);
+  bool splitRuleFromName(const std::string& name, SplitRule& rule);
+
+  /// Part @param i of @param total split equally among @param count participants. Floating
+  /// point totals are divided; integer ones give the units left by the division to the first
+  /// participants, so the parts add up to the total. Types with minor units overload it.
+  template<typename E>
+  typename std::enable_if<!std::is_integral<E>::value, E>::type equalPart(const E& total, size_t count, size_t i);
+  template<typename E>
+  typename std::enable_if<std::is_integral<E>::value, E>::type equalPart(E total, size_t count, size_t i);
+
+  /// Split of @param total in proportion to @param weights adding up to @param sum into @param parts.
+  /// Floating point parts are divided; integer ones are split by largest remainder like cents,
+  /// see splitMinor(), so they add up to the total. Types with minor units overload it.
+  template<typename E>
+  typename std::enable_if<!std::is_integral<E>::value>::type weightedParts(const E& total, const std::vector<E>& weights,
+                                                                            const E& sum, std::vector<E>& parts);
+  template<typename E>
+  typename std::enable_if<std::is_integral<E>::value>::type weightedParts(E total, const std::vector<E>& weights,
+                                                                           E sum, std::vector<E>& parts);
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename V, typename E>
+  GroupExpense<V, E>::GroupExpense(Vertex<V, E>* payer, E total, SplitRule rule,
+                                   const std::vector<Vertex<V, E>*>& participants, const std::vector<E>& shares):
+    payer(payer), total(total), rule(rule), participants(participants), shares(shares), sharesSum()
+  {
+    if(!payer)
+      THROW_MG_NULL_POINTER_EXCEPTION("Group expense payer is NULL!");
+
+    if(participants.empty())
+      THROW_MG_EXCEPTION("Group expense without participants!");
+
+    if(rule == SPLIT_EQUAL)
+      this->shares.clear();
+    else if(shares.size() != participants.size())
+      THROW_MG_EXCEPTION("Every participant needs a share!");
+
+    if(rule == SPLIT_WEIGHTED)
+      for(auto i = this->shares.begin(); i != this->shares.end(); ++i)
+        if(*i < E())
+          THROW_MG_EXCEPTION("Weights of a group expense can't be negative!");
+
+    recomputeTotals();
+
+    if(rule == SPLIT_WEIGHTED && !(sharesSum > E()))
+      THROW_MG_EXCEPTION("Weights of a group expense have to add up to more than zero!");
+  }
+
+  template<typename V, typename E>
+  E GroupExpense<V, E>::partOf(size_t i) const
+  {
+    switch(rule)
+    {
+      case SPLIT_EQUAL:
+        return equalPart(total, participants.size(), i);
+      case SPLIT_WEIGHTED:
+        return parts[i];
+      case SPLIT_EXACT:
+        return shares[i];
+    }
+    return E();
+  }
+
+  template<typename V, typename E>
+  bool GroupExpense<V, E>::hasParts() const
+  {
+    return !participants.empty() && (rule != SPLIT_WEIGHTED || sharesSum > E());
+  }
+
+  template<typename V, typename E>
+  template<typename F>
+  void GroupExpense<V, E>::forEachDebt(F f) const
+  {
+    for(size_t i = 0; i < participants.size(); i++)
+      if(participants[i] != payer)
+        f(payer, participants[i], partOf(i));
+  }
+
+  template<typename V, typename E>
+  void GroupExpense<V, E>::removeParticipant(const Vertex<V, E> *participant)
+  {
+    for(size_t i = 0; i < participants.size(); )
+    {
+      if(participants[i] != participant)
+      {
+        i++;
+        continue;
+      }
+      participants.erase(participants.begin() + i);
+      if(!shares.empty())
+        shares.erase(shares.begin() + i);
+    }
+    recomputeTotals();
+  }
+
+  template<typename V, typename E>
+  void GroupExpense<V, E>::recomputeTotals()
+  {
+    sharesSum = E();
+    for(auto i = shares.begin(); i != shares.end(); ++i)
+      sharesSum = sharesSum + *i;
+    if(rule == SPLIT_EXACT)
+      total = sharesSum;
+
+    parts.clear();
+    if(rule == SPLIT_WEIGHTED && sharesSum > E())
+      weightedParts(total, shares, sharesSum, parts);
+  }
+
+  template<typename E>
+  typename std::enable_if<!std::is_integral<E>::value, E>::type equalPart(const E& total, size_t count, size_t)
+  {
+    return total / static_cast<E>(count);
+  }
+
+  template<typename E>
+  typename std::enable_if<std::is_integral<E>::value, E>::type equalPart(E total, size_t count, size_t i)
+  {
+    // the remainder has the sign of the total, its units go one each to the first participants
+    E quotient = total / static_cast<E>(count);
+    E remainder = total % static_cast<E>(count);
+    if(remainder > E() && static_cast<E>(i) < remainder)
+      return quotient + E(1);
+    if(remainder < E() && static_cast<E>(i) < E() - remainder)
+      return quotient - E(1);
+    return quotient;
+  }
+
+  template<typename E>
+  typename std::enable_if<!std::is_integral<E>::value>::type weightedParts(const E& total, const std::vector<E>& weights,
+                                                                            const E& sum, std::vector<E>& parts)
+  {
+    parts.resize(weights.size());
+    for(size_t i = 0; i < weights.size(); i++)
+      parts[i] = total * weights[i] / sum;
+  }
+
+  template<typename E>
+  typename std::enable_if<std::is_integral<E>::value>::type weightedParts(E total, const std::vector<E>& weights,
+                                                                           E sum, std::vector<E>& parts)
+  {
+    std::vector<int64_t> wideWeights(weights.begin(), weights.end()), wideParts;
+    splitMinor(static_cast<int64_t>(total), wideWeights, static_cast<int64_t>(sum), wideParts);
+    parts.assign(wideParts.begin(), wideParts.end());
+  }
+
+  inline const char* splitRuleName(SplitRule rule)
+  {
+    switch(rule)
+    {
+      case SPLIT_EQUAL: return "equal";
+      case SPLIT_WEIGHTED: return "weighted";
+      case SPLIT_EXACT: return "exact";
+    }
+    return "";
+  }
+
+  inline bool splitRuleFromName(const std::string& name, SplitRule& rule)
+  {
+    if(name == "equal") rule = SPLIT_EQUAL;
+    else if(name == "weighted") rule = SPLIT_WEIGHTED;
+    else if(name == "exact") rule = SPLIT_EXACT;
+    else return false;
+    return true;
+  }
+
+} // end of namespace
+
+#endif // GROUPEXPENSE_H
@@ -1,7 +1,9 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "csvimporter.h"
+#include "reduction.h"
+#include "tracer.h"
 
-#include "../ThirdParty/tinyexpr-master/tinyexpr.h"
 #include <algorithm>
 
 #include <QDebug>
@@ -18,7 +20,8 @@
 
 MainWindow::MainWindow(QString graphPath, QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::MainWindow)
+    ui(new Ui::MainWindow),
+    history(graph, 100, 1 << 18)
 {
   ui->setupUi(this);
 
@@ -36,9 +39,11 @@ MainWindow::MainWindow(QString graphPath, QWidget *parent) :
 
   if(inputFile.is_open())
   {
+    history.setRecording(false);
     MD_TRY
     inputFile >> graph;
     MD_CATCH
+    history.setRecording(true);
 
     inputFile.close();
   }
@@ -48,8 +53,12 @@ MainWindow::MainWindow(QString graphPath, QWidget *parent) :
   ui->horizontalLayout_central->addWidget(view);
   scene = new QGraphicsScene(view);
   view->setScene(scene);
-  svg = new QGraphicsSvgItem("file.svg");
-  scene->addItem(svg);
+  graphRenderer = new GraphRenderer(scene);
+
+  statsPanel = new StatsPanel(this);
+  addDockWidget(Qt::RightDockWidgetArea, statsPanel);
+  statsPanel->hide();
+  ui->menuMenu->addAction(statsPanel->toggleViewAction());
 
   // pushbuttons
   connect(ui->pushButton_addPerson, SIGNAL(pressed()), this, SLOT(addPerson()));
@@ -60,7 +69,15 @@ MainWindow::MainWindow(QString graphPath, QWidget *parent) :
   connect(ui->actionShow_controll_panel, SIGNAL(triggered(bool)), this, SLOT(actionShowControllPanel()));
   connect(ui->actionSave, SIGNAL(triggered(bool)), this, SLOT(actionSaveGraph()));
   connect(ui->actionLoad_graph, SIGNAL(triggered(bool)), this, SLOT(actionLoadGraph()));
+  connect(ui->actionImport_csv, SIGNAL(triggered(bool)), this, SLOT(actionImportCsv()));
   connect(ui->actionReduce_edges, SIGNAL(triggered(bool)), this, SLOT(actionReduseEdges()));
+  connect(ui->actionUndo, SIGNAL(triggered(bool)), this, SLOT(actionUndo()));
+  connect(ui->actionRedo, SIGNAL(triggered(bool)), this, SLOT(actionRedo()));
+  connect(ui->actionColor_by_balance, SIGNAL(toggled(bool)), this, SLOT(updateGraph()));
+
+  // MD_TRACE_FILE environment variable starts the trace before the first interaction
+  ui->actionRecord_trace->setChecked(mg::Tracer::global().isRecording());
+  connect(ui->actionRecord_trace, SIGNAL(toggled(bool)), this, SLOT(actionRecordTrace(bool)));
 
   readSettings("settings.ini");
 
@@ -71,11 +88,13 @@ MainWindow::MainWindow(QString graphPath, QWidget *parent) :
 MainWindow::~MainWindow()
 {
   writeSettings("settings.ini");
+  delete graphRenderer;
   delete ui;
 }
 
 void MainWindow::addPerson()
 {
+  MD_TRACE_SCOPE("addPerson");
   QString text = ui->lineEdit_person->text();
   text.replace(" ", "_");
   if(text.isEmpty())
@@ -85,6 +104,8 @@ void MainWindow::addPerson()
   }
 
   MD_TRY
+  MD_TRACE_SCOPE("graph mutation");
+  UndoStep step(history, "add person");
   graph.addVertex(text.toLocal8Bit().constData());
   MD_CATCH
 
@@ -94,14 +115,17 @@ void MainWindow::addPerson()
 
 void MainWindow::addDebt()
 {
+  MD_TRACE_SCOPE("addDebt");
   MD_TRY
   int error = 0;
-  double value = te_interp(ui->lineEdit_debt->text().toLocal8Bit().constData(), &error);
+  mg::Money value = mg::evaluateMoney(ui->lineEdit_debt->text().toLocal8Bit().constData(), expressions, &error);
   if (error != 0 )
   {
     QMessageBox::critical(this,"Error!", "'"+ui->lineEdit_debt->text()+"' parse error!", QMessageBox::Ok);
     return;
   }
+  MD_TRACE_SCOPE("graph mutation");
+  UndoStep step(history, "add debt");
   graph.addEdge(
         ui->comboBox_creditor->currentText().toLocal8Bit().constData(),
         ui->comboBox_debtor->currentText().toLocal8Bit().constData(),
@@ -112,7 +136,9 @@ void MainWindow::addDebt()
 
 void MainWindow::deletePerson()
 {
+  MD_TRACE_SCOPE("deletePerson");
   MD_TRY
+  UndoStep step(history, "delete person");
   std::string delVertex = ui->comboBox_personsList->currentText().toLocal8Bit().constData();
   if(!graph.vertexIsIsolated(delVertex))
   {
@@ -133,14 +159,15 @@ void MainWindow::deletePerson()
 
 void MainWindow::updatePersonsList()
 {
+  MD_TRACE_SCOPE("updatePersonsList");
   ui->comboBox_creditor->clear();
   ui->comboBox_debtor->clear();
   ui->comboBox_personsList->clear();
 
   MD_TRY
-  auto vertexes = graph.getVertexes();
+  const auto& vertexes = graph.getVertexes();
 
-  std::for_each (vertexes.begin(), vertexes.end(), [this](mg::Vertex<std::string, double>* i)
+  std::for_each (vertexes.begin(), vertexes.end(), [this](mg::Vertex<std::string, mg::Money>* i)
   {
     QString name = QString::fromStdString(i->getData());
     ui->comboBox_creditor->addItem(name);
@@ -152,20 +179,15 @@ void MainWindow::updatePersonsList()
 
 void MainWindow::updateGraph()
 {
+  MD_TRACE_SCOPE("updateGraph");
+  updateUndoActions();
   MD_TRY
-  graph.generateDotText("file.dot");
+  mg::DotOptions options;
+  options.colorByBalance = ui->actionColor_by_balance->isChecked();
+  QString error;
+  if(!graphRenderer->render(graph, options, &error))
+    QMessageBox::critical(this,"Error!", error, QMessageBox::Ok);
   MD_CATCH
-
-#if defined(_WIN32) || defined(_WIN64)
-  system("%DOT_DIR%\\bin\\dot.exe file.dot -Tsvg -ofile.svg");
-#else
-  system("dot file.dot -Tsvg -ofile.svg");
-#endif
-
-  scene->removeItem(svg);
-  delete svg;
-  svg = new QGraphicsSvgItem("file.svg");
-  scene->addItem(svg);
 }
 
 void MainWindow::actionShowControllPanel()
@@ -191,6 +213,7 @@ void MainWindow::actionSaveGraph()
 
 void MainWindow::actionLoadGraph()
 {
+  MD_TRACE_SCOPE("actionLoadGraph");
   QString fileName = QFileDialog::getOpenFileName(this, tr("Open File"), "",
              tr("*.mg"));
 
@@ -198,11 +221,17 @@ void MainWindow::actionLoadGraph()
   {
     std::ifstream inputFile;
     inputFile.open(fileName.toLocal8Bit().constData());
+
+    // a new document, changes of the old one can't be undone
+    history.setRecording(false);
     graph.clear();
 
     MD_TRY
+    MD_TRACE_SCOPE("graph mutation");
     inputFile >> graph;
     MD_CATCH
+    history.setRecording(true);
+    history.clear();
 
     inputFile.close();
 
@@ -213,81 +242,109 @@ void MainWindow::actionLoadGraph()
   }
 }
 
-void MainWindow::actionReduseEdges()
+void MainWindow::actionImportCsv()
 {
-  MD_TRY
+  QString fileName = QFileDialog::getOpenFileName(this, tr("Import transactions"), "",
+             tr("*.csv"));
 
-  // step 1
-  std::for_each(graph.beginV(), graph.endV(), [this](mg::Vertex<std::string, double>* i)
+  if (fileName.isEmpty())
+    return;
+
+  std::ifstream inputFile;
+  inputFile.open(fileName.toLocal8Bit().constData(), std::ios::binary);
+  if(!inputFile.is_open())
   {
-    auto outgoingEdges = i->getOutgoingEdges();
-    for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
-    {
-      auto k = j;
-      ++k;
-      while(k!= outgoingEdges.end())
-      {
-        if((*j)->getDestination()->getData() ==
-           (*k)->getDestination()->getData())
-        {
-          double current = (*j)->getValue();
-          (*j)->setValue(current + (*k)->getValue());
-          mg::Edge<std::string, double>* delEdgeP = *k;
-          auto oldKpos = k;
-          ++k;
-          graph.deleteEdge(delEdgeP);
-          outgoingEdges.erase(oldKpos);
-        }
-        else ++k;
-      }
-    }
-  });
+    QMessageBox::critical(this, "Error!", "Can't open the file '" + fileName + "'", QMessageBox::Ok);
+    return;
+  }
 
-  // step 2
-  std::for_each(graph.beginV(), graph.endV(), [this](mg::Vertex<std::string, double>* i)
+  MD_TRACE_SCOPE("actionImportCsv");
+  MD_TRY
+  UndoStep step(history, "import CSV");
+  mg::CsvImportResult result = mg::importCsv(inputFile, graph);
+  if(!result.failedRows.empty())
   {
-    auto outgoingEdges = i->getOutgoingEdges();
-    std::for_each(outgoingEdges.begin(), outgoingEdges.end(), [this](mg::Edge<std::string, double>* j)
-    {
-      auto dst = j->getDestination();
-      auto dstOutgoingEdges = dst->getOutgoingEdges();
-      auto reverseEdgePos =
-          std::find_if(dstOutgoingEdges.begin(), dstOutgoingEdges.end(),
-                       [j](mg::Edge<std::string, double>* k)
-      {
-        return j->getSource() == k->getDestination();
-      });
-
-      if (reverseEdgePos != dstOutgoingEdges.end())
-      {
-        auto reverseEdge = *reverseEdgePos;
-        double outgoingVal = j->getValue();
-        double incomingVal = reverseEdge->getValue();
-        if(outgoingVal > incomingVal)
-        {
-          j->setValue(outgoingVal - incomingVal);
-          graph.deleteEdge(reverseEdge);
-        }
-        else
-          if(outgoingVal < incomingVal)
-          {
-            reverseEdge->setValue(incomingVal - outgoingVal);
-            graph.deleteEdge(j);
-          }
-          else
-          {
-            graph.deleteEdge(reverseEdge);
-            graph.deleteEdge(j);
-          }
-      }
-    });
-  });
+    QStringList rows;
+    for(size_t i = 0; i < result.failedRows.size() && i < 20; i++)
+      rows << QString::number(result.failedRows[i]);
+    if(result.failedRows.size() > 20)
+      rows << "...";
+    QMessageBox::warning(this, "Import", QString("Imported %1 of %2 rows.\nFailed rows: %3")
+                         .arg(result.imported).arg(result.rows).arg(rows.join(", ")), QMessageBox::Ok);
+  }
+  MD_CATCH
+
+  inputFile.close();
+
+  updatePersonsList();
+  updateGraph();
+}
+
+void MainWindow::actionReduseEdges()
+{
+  MD_TRACE_SCOPE("actionReduseEdges");
+  MD_TRY
+
+  MD_TRACE_SCOPE("graph mutation");
+  UndoStep step(history, "reduce edges");
+  mg::reduceEdges(graph);
 
   MD_CATCH
 
       updateGraph();
 }
 
+void MainWindow::actionUndo()
+{
+  MD_TRACE_SCOPE("actionUndo");
+  MD_TRY
+  history.undo();
+  MD_CATCH
+
+  updatePersonsList();
+  updateGraph();
+}
+
+void MainWindow::actionRedo()
+{
+  MD_TRACE_SCOPE("actionRedo");
+  MD_TRY
+  history.redo();
+  MD_CATCH
+
+  updatePersonsList();
+  updateGraph();
+}
+
+void MainWindow::updateUndoActions()
+{
+  ui->actionUndo->setEnabled(history.canUndo());
+  ui->actionUndo->setText(QString("Undo %1").arg(QString::fromStdString(history.getUndoName())).trimmed());
+  ui->actionRedo->setEnabled(history.canRedo());
+  ui->actionRedo->setText(QString("Redo %1").arg(QString::fromStdString(history.getRedoName())).trimmed());
+}
+
+void MainWindow::actionRecordTrace(bool checked)
+{
+  if(!checked)
+  {
+    mg::Tracer::global().stop();
+    return;
+  }
+
+  QString fileName = QFileDialog::getSaveFileName(this, tr("Save trace"), "trace.json",
+          tr("(*.json)"));
+
+  if(fileName.isEmpty() || !mg::Tracer::global().start(fileName.toLocal8Bit().constData()))
+  {
+    if(!fileName.isEmpty())
+      QMessageBox::critical(this,"Error!", "Can't open '" + fileName + "'", QMessageBox::Ok);
+    ui->actionRecord_trace->blockSignals(true);
+    ui->actionRecord_trace->setChecked(false);
+    ui->actionRecord_trace->blockSignals(false);
+  }
+}
+
 void MainWindow::readSettings(QString file, QString group)
 {
   QSettings settings(file, QSettings::IniFormat);
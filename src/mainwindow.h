@@ -2,11 +2,14 @@
 #define MAINWINDOW_H
 
 #include "wheelevent_forqsceneview.h"
+#include "graphrenderer.h"
 #include "multigraph.h"
+#include "undohistory.h"
+#include "expressioncache.h"
+#include "statspanel.h"
 
 #include <QMainWindow>
 #include <QGraphicsScene>
-#include <QGraphicsSvgItem>
 
 
 namespace Ui {
@@ -38,7 +41,13 @@ private slots:
   void actionShowControllPanel();
   void actionSaveGraph();
   void actionLoadGraph();
+  void actionImportCsv();
   void actionReduseEdges();
+  /// Reverts or repeats the last change of the graph
+  void actionUndo();
+  void actionRedo();
+  /// Starts or stops writing the Chrome trace of GUI interactions
+  void actionRecordTrace(bool checked);
 
 
   //settings
@@ -46,14 +55,24 @@ private slots:
   void writeSettings(QString file, QString group = "MainWindow");
 
 private:
+  typedef mg::UndoStep<std::string, mg::Money> UndoStep;
+
+  /// Enables undo and redo actions and names the steps they revert
+  void updateUndoActions();
+
   Ui::MainWindow *ui;
   // Main container
-  mg::Multigraph<std::string, double> graph;
+  mg::Multigraph<std::string, mg::Money> graph;
+  // Changes of the graph, recorded while attached
+  mg::UndoHistory<std::string, mg::Money> history;
+  // Compiled debt formulas
+  mg::ExpressionCache expressions;
 
   // GUI elements
   WheelEvent_forQSceneView *view;
   QGraphicsScene *scene;
-  QGraphicsSvgItem *svg;
+  GraphRenderer *graphRenderer;
+  StatsPanel *statsPanel;
 };
 
 #endif // MAINWINDOW_H
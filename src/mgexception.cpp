@@ -1,63 +1,103 @@
 #include "mgexception.h"
+#include "mgstats.h"
 
-#include <string>
-#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
 
 using namespace mg;
 
-Exception::Exception():exception()
+namespace
 {
-    text = "";
-    line = 0;
-    function = "";
-    timestamp = "";
+  const char* typeName(ExceptionType type)
+  {
+    switch(type)
+    {
+      case(MG_EXCEPTION):
+        return "mg::Exception";
+
+      case(MG_NULL_POINTER_EXCEPTION):
+        return "mg::NullPointerException";
+
+      case(MG_VERTEX_EXISTING_EXCEPTION):
+        return "mg::VertexExistingException";
+
+      case(MG_EDGE_EXISTING_EXCEPTION):
+        return "mg::EdgeExistingException";
+
+      case(MG_ALLOCATOR_EXCEPTION):
+        return "mg::AllocatorException";
+    }
+    return "";
+  }
+}
+
+Exception::Exception():
+  exception(),
+  type(MG_EXCEPTION),
+  line(0),
+  function(""),
+  timestamp(""),
+  formatState(NOT_FORMATTED)
+{
+  MG_STATS_COUNT(STATS_EXCEPTIONS);
+  text[0] = '\0';
 }
 
-Exception::Exception(std::string text, int line, std::string function, std::string timestamp):
+Exception::Exception(ExceptionText text, int line, const char* function, const char* timestamp):
   exception(),
   type(MG_EXCEPTION),
-  text(text),
   line(line),
   function(function),
-  timestamp(timestamp)
+  timestamp(timestamp),
+  formatState(NOT_FORMATTED)
 {
-
+  MG_STATS_COUNT(STATS_EXCEPTIONS);
+  size_t size = std::min(text.size, static_cast<size_t>(textSize - 1));
+  std::memcpy(this->text, text.data, size);
+  this->text[size] = '\0';
 }
 
-const char *Exception::what() const throw()
+Exception::Exception(const Exception &other):
+  exception(other),
+  formatState(NOT_FORMATTED)
 {
-  std::ostringstream oss;
-  switch(type)
-  {
-    case(MG_EXCEPTION):
-      oss << "mg::Exception\n";
-      break;
+  *this = other;
+}
 
-    case(MG_NULL_POINTER_EXCEPTION):
-      oss << "mg::NullPointerException\n";
-      break;
+Exception &Exception::operator=(const Exception &other)
+{
+  type = other.type;
+  std::memcpy(text, other.text, textSize);
+  line = other.line;
+  function = other.function;
+  timestamp = other.timestamp;
 
-    case(MG_VERTEX_EXISTING_EXCEPTION):
-      oss << "mg::VertexExistingException\n";
-      break;
+  // the copy formats its own message when asked
+  formatState.store(NOT_FORMATTED, std::memory_order_relaxed);
+  return *this;
+}
 
-    case(MG_EDGE_EXISTING_EXCEPTION):
-      oss << "mg::EdgeExistingException\n";
-      break;
+const char *Exception::what() const throw()
+{
+  int state = formatState.load(std::memory_order_acquire);
+  if(state == FORMATTED)
+    return fullString;
 
-    case(MG_ALLOCATOR_EXCEPTION):
-      oss << "mg::AllocatorException\n";
-      break;
+  int expected = NOT_FORMATTED;
+  if(state == NOT_FORMATTED &&
+     formatState.compare_exchange_strong(expected, FORMATTING, std::memory_order_acquire))
+  {
+    std::snprintf(fullString, fullStringSize,
+                  "%s\n\"%s\" in function \"%s\" in line: %d. Build from: %s",
+                  typeName(type), text, function, line, timestamp);
+    formatState.store(FORMATTED, std::memory_order_release);
+    return fullString;
   }
 
-  oss  << "\""
-       << text
-       << "\" in function \""
-       << function
-       << "\" in line: "
-       << line
-       << ". Build from: "
-       << timestamp;
-  fullString = oss.str();
-  return fullString.c_str();
+  // another thread is formatting, it takes microseconds
+  while(formatState.load(std::memory_order_acquire) != FORMATTED)
+    std::this_thread::yield();
+  return fullString;
 }
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <exception>
+#include <atomic>
+#include <cstring>
 
 namespace mg
 {
@@ -18,29 +20,52 @@ namespace mg
                      MG_EDGE_EXISTING_EXCEPTION,
                      MG_ALLOCATOR_EXCEPTION };
 
+  /// Text of an exception, literals and strings are passed without a copy
+  struct ExceptionText
+  {
+    ExceptionText(const char* data): data(data), size(std::strlen(data)) {}
+    ExceptionText(const std::string& value): data(value.data()), size(value.size()) {}
+
+    const char* data;
+    size_t size;
+  };
+
+  /// Throwing doesn't allocate: function and timestamp are the static strings of the
+  /// THROW_MG_* macros, the text is copied into an inline buffer (longer texts are cut).
+  /// what() formats the message once, concurrent callers wait for the first one.
   class Exception : public std::exception
   {
   public:
     Exception();
-    Exception(std::string text, int line, std::string function, std::string timestamp);
+    Exception(ExceptionText text, int line, const char* function, const char* timestamp);
+    Exception(const Exception& other);
+    Exception& operator= (const Exception& other);
 
     virtual const char* what() const throw();
 
     ExceptionType getExceptionType() const { return type; }
+    const char* getText() const { return text; }
+    int getLine() const { return line; }
+    const char* getFunction() const { return function; }
+    const char* getTimestamp() const { return timestamp; }
 
   protected:
+    enum { textSize = 128, fullStringSize = 384 };
+    enum FormatState { NOT_FORMATTED, FORMATTING, FORMATTED };
+
     ExceptionType type;
-    std::string text;
+    char text[textSize];
     int line;
-    std::string function;
-    std::string timestamp;
-    mutable std::string fullString;
+    const char* function;
+    const char* timestamp;
+    mutable std::atomic<int> formatState;
+    mutable char fullString[fullStringSize];
   };
 
   class NullPointerException: public Exception
   {
   public:
-    NullPointerException(std::string text, int line, std::string function, std::string timestamp):
+    NullPointerException(ExceptionText text, int line, const char* function, const char* timestamp):
       Exception(text, line, function, timestamp)
     {
       type = MG_NULL_POINTER_EXCEPTION;
@@ -56,8 +81,8 @@ namespace mg
   class VertexExistingException : public Exception
   {
   public:
-    VertexExistingException(std::string text, int line, std::string function,
-                            std::string timestamp, Vertex<V, E> *vertexP = NULL, V data = V()) :
+    VertexExistingException(ExceptionText text, int line, const char* function,
+                            const char* timestamp, Vertex<V, E> *vertexP = NULL, V data = V()) :
       Exception(text, line, function, timestamp),
       vertexPointer(vertexP), data(data)
     {
@@ -71,8 +96,8 @@ namespace mg
   class EdgeExistingException : public Exception
   {
   public:
-    EdgeExistingException(std::string text, int line, std::string function,
-                          std::string timestamp, Edge<V, E> *edgeP = NULL) :
+    EdgeExistingException(ExceptionText text, int line, const char* function,
+                          const char* timestamp, Edge<V, E> *edgeP = NULL) :
       Exception(text, line, function, timestamp),
       edgePointer(edgeP)
     {
@@ -85,7 +110,7 @@ namespace mg
   class AllocatorException : public Exception
   {
   public:
-    AllocatorException(std::string text, int line, std::string function, std::string timestamp):
+    AllocatorException(ExceptionText text, int line, const char* function, const char* timestamp):
       Exception(text, line, function, timestamp)
     {
       type = MG_ALLOCATOR_EXCEPTION;
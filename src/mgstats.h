@@ -0,0 +1,199 @@
+#ifndef MGSTATS_H
+#define MGSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Instrumentation of the multigraph core. The macros expand to nothing unless
+// MG_ENABLE_STATS is defined (qmake CONFIG+=mg_stats), the API below is always available
+// and reports zeros when statistics are compiled out.
+#ifdef MG_ENABLE_STATS
+#define MG_STATS_ADD(counter, n) mg::statsStorage().counters[mg::counter].fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed)
+#define MG_STATS_COUNT(counter) MG_STATS_ADD(counter, 1)
+#define MG_STATS_CONCAT2(a, b) a##b
+#define MG_STATS_CONCAT(a, b) MG_STATS_CONCAT2(a, b)
+#define MG_STATS_TIMER(timer) mg::StatsScopedTimer MG_STATS_CONCAT(mgStatsTimer, __LINE__)(mg::timer)
+#else
+#define MG_STATS_ADD(counter, n) ((void)0)
+#define MG_STATS_COUNT(counter) ((void)0)
+#define MG_STATS_TIMER(timer) ((void)0)
+#endif
+
+namespace mg
+{
+  enum StatsCounter { STATS_VERTEX_LOOKUPS,        // index lookups by vertex data
+                      STATS_LOOKUP_PROBES,         // entries of the hash buckets visited by lookups
+                      STATS_VERTEX_ALLOCATIONS,
+                      STATS_VERTEX_RETURNS,
+                      STATS_EDGE_ALLOCATIONS,
+                      STATS_EDGE_RETURNS,
+                      STATS_ADJACENCY_SCANS,       // linear searches in adjacency lists
+                      STATS_ADJACENCY_SCAN_STEPS,  // list nodes visited by these searches
+                      STATS_ADJACENCY_COPIES,      // adjacency lists copied
+                      STATS_ADJACENCY_COPIED_EDGES,
+                      STATS_EXCEPTIONS,            // mg::Exception objects constructed
+                      STATS_COUNTERS_COUNT };
+
+  enum StatsTimer { TIMER_ADD_VERTEX,
+                    TIMER_ADD_EDGE,
+                    TIMER_DELETE_VERTEX,
+                    TIMER_DELETE_EDGE,
+                    TIMER_CHECK_INVARIANT,
+                    TIMER_SERIALIZE,
+                    TIMER_DESERIALIZE,
+                    TIMER_DOT_TEXT,
+                    TIMER_RENDER_COMPONENTS,
+                    TIMER_RENDER_LAYOUT,
+                    TIMER_RENDER_SHOW,
+                    STATS_TIMERS_COUNT };
+
+  struct StatsTimerValue
+  {
+    uint64_t calls;
+    uint64_t totalNs;
+    uint64_t maxNs;
+  };
+
+  /// Copy of all counters and timers taken at one moment
+  struct StatsSnapshot
+  {
+    uint64_t counters[STATS_COUNTERS_COUNT];
+    StatsTimerValue timers[STATS_TIMERS_COUNT];
+  };
+
+  struct StatsStorage
+  {
+    std::atomic<uint64_t> counters[STATS_COUNTERS_COUNT];
+    std::atomic<uint64_t> timerCalls[STATS_TIMERS_COUNT];
+    std::atomic<uint64_t> timerTotalNs[STATS_TIMERS_COUNT];
+    std::atomic<uint64_t> timerMaxNs[STATS_TIMERS_COUNT];
+  };
+
+  /// Process wide storage, counters are updated with relaxed atomics
+  StatsStorage& statsStorage();
+
+  bool statsEnabled();
+  StatsSnapshot statsSnapshot();
+  void resetStats();
+  const char* statsCounterName(StatsCounter counter);
+  const char* statsTimerName(StatsTimer timer);
+
+  /// Adds the lifetime of the object to @param timer
+  class StatsScopedTimer
+  {
+  public:
+    explicit StatsScopedTimer(StatsTimer timer): timer(timer), started(std::chrono::steady_clock::now()) {}
+    ~StatsScopedTimer();
+
+  private:
+    StatsTimer timer;
+    std::chrono::steady_clock::time_point started;
+  };
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  inline StatsStorage& statsStorage()
+  {
+    // static storage is zero initialized before any use
+    static StatsStorage storage;
+    return storage;
+  }
+
+  inline bool statsEnabled()
+  {
+#ifdef MG_ENABLE_STATS
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  inline StatsSnapshot statsSnapshot()
+  {
+    StatsStorage& storage = statsStorage();
+    StatsSnapshot snapshot;
+    for(int i = 0; i < STATS_COUNTERS_COUNT; i++)
+      snapshot.counters[i] = storage.counters[i].load(std::memory_order_relaxed);
+    for(int i = 0; i < STATS_TIMERS_COUNT; i++)
+    {
+      snapshot.timers[i].calls = storage.timerCalls[i].load(std::memory_order_relaxed);
+      snapshot.timers[i].totalNs = storage.timerTotalNs[i].load(std::memory_order_relaxed);
+      snapshot.timers[i].maxNs = storage.timerMaxNs[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+  }
+
+  inline void resetStats()
+  {
+    StatsStorage& storage = statsStorage();
+    for(int i = 0; i < STATS_COUNTERS_COUNT; i++)
+      storage.counters[i].store(0, std::memory_order_relaxed);
+    for(int i = 0; i < STATS_TIMERS_COUNT; i++)
+    {
+      storage.timerCalls[i].store(0, std::memory_order_relaxed);
+      storage.timerTotalNs[i].store(0, std::memory_order_relaxed);
+      storage.timerMaxNs[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  inline const char* statsCounterName(StatsCounter counter)
+  {
+    switch(counter)
+    {
+      case STATS_VERTEX_LOOKUPS: return "vertex lookups";
+      case STATS_LOOKUP_PROBES: return "lookup probes";
+      case STATS_VERTEX_ALLOCATIONS: return "vertex allocations";
+      case STATS_VERTEX_RETURNS: return "vertex returns";
+      case STATS_EDGE_ALLOCATIONS: return "edge allocations";
+      case STATS_EDGE_RETURNS: return "edge returns";
+      case STATS_ADJACENCY_SCANS: return "adjacency scans";
+      case STATS_ADJACENCY_SCAN_STEPS: return "adjacency scan steps";
+      case STATS_ADJACENCY_COPIES: return "adjacency copies";
+      case STATS_ADJACENCY_COPIED_EDGES: return "adjacency copied edges";
+      case STATS_EXCEPTIONS: return "exceptions";
+      case STATS_COUNTERS_COUNT: break;
+    }
+    return "";
+  }
+
+  inline const char* statsTimerName(StatsTimer timer)
+  {
+    switch(timer)
+    {
+      case TIMER_ADD_VERTEX: return "addVertex";
+      case TIMER_ADD_EDGE: return "addEdge";
+      case TIMER_DELETE_VERTEX: return "deleteVertex";
+      case TIMER_DELETE_EDGE: return "deleteEdge";
+      case TIMER_CHECK_INVARIANT: return "checkGraphInvariant";
+      case TIMER_SERIALIZE: return "operator<<";
+      case TIMER_DESERIALIZE: return "operator>>";
+      case TIMER_DOT_TEXT: return "dot text";
+      case TIMER_RENDER_COMPONENTS: return "render: components";
+      case TIMER_RENDER_LAYOUT: return "render: graphviz layout";
+      case TIMER_RENDER_SHOW: return "render: scene update";
+      case STATS_TIMERS_COUNT: break;
+    }
+    return "";
+  }
+
+  inline StatsScopedTimer::~StatsScopedTimer()
+  {
+    uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                               std::chrono::steady_clock::now() - started).count());
+    StatsStorage& storage = statsStorage();
+    storage.timerCalls[timer].fetch_add(1, std::memory_order_relaxed);
+    storage.timerTotalNs[timer].fetch_add(elapsed, std::memory_order_relaxed);
+
+    uint64_t maxNs = storage.timerMaxNs[timer].load(std::memory_order_relaxed);
+    while(elapsed > maxNs &&
+          !storage.timerMaxNs[timer].compare_exchange_weak(maxNs, elapsed, std::memory_order_relaxed));
+  }
+
+} // end of namespace
+
+#endif // MGSTATS_H
@@ -0,0 +1,121 @@
+#include "money.h"
+
+#include <limits>
+#include <cctype>
+
+using namespace mg;
+
+namespace
+{
+  const int64_t maxMinor = std::numeric_limits<int64_t>::max();
+
+  // appends a decimal digit, false on overflow
+  bool pushDigit(int64_t& value, int digit)
+  {
+    if(value > (maxMinor - digit) / 10)
+      return false;
+    value = value * 10 + digit;
+    return true;
+  }
+}
+
+bool mg::parseMoney(const char *text, size_t size, Money &value)
+{
+  const char* end = text + size;
+  bool negative = false;
+  if(text != end && (*text == '-' || *text == '+'))
+    negative = *text++ == '-';
+
+  // significant digits and the position of the decimal point among them
+  const char* digits = text;
+  size_t integerDigits = 0, fractionDigits = 0;
+  while(text != end && std::isdigit(static_cast<unsigned char>(*text)))
+  {
+    integerDigits++;
+    text++;
+  }
+  const char* fraction = text;
+  if(text != end && *text == '.')
+  {
+    fraction = ++text;
+    while(text != end && std::isdigit(static_cast<unsigned char>(*text)))
+    {
+      fractionDigits++;
+      text++;
+    }
+  }
+  if(integerDigits + fractionDigits == 0)
+    return false;
+
+  long exponent = 0;
+  if(text != end && (*text == 'e' || *text == 'E'))
+  {
+    text++;
+    bool negativeExponent = false;
+    if(text != end && (*text == '-' || *text == '+'))
+      negativeExponent = *text++ == '-';
+    if(text == end || !std::isdigit(static_cast<unsigned char>(*text)))
+      return false;
+    while(text != end && std::isdigit(static_cast<unsigned char>(*text)))
+    {
+      if(exponent < 100000)
+        exponent = exponent * 10 + (*text - '0');
+      text++;
+    }
+    if(negativeExponent)
+      exponent = -exponent;
+  }
+  if(text != end)
+    return false;
+
+  // digits before the cents boundary make the minor units, the next one rounds
+  long keep = static_cast<long>(integerDigits) + exponent + 2;
+  long total = static_cast<long>(integerDigits + fractionDigits);
+  int64_t minor = 0;
+  int roundingDigit = 0;
+  for(long i = 0; i < total; i++)
+  {
+    int digit = (i < static_cast<long>(integerDigits) ? digits[i] : fraction[i - integerDigits]) - '0';
+    if(i < keep)
+    {
+      if(!pushDigit(minor, digit))
+        return false;
+    }
+    else
+    {
+      if(i == keep)
+        roundingDigit = digit;
+      break;
+    }
+  }
+  for(long i = total; i < keep; i++)
+    if(minor != 0 && !pushDigit(minor, 0))
+      return false;
+  if(roundingDigit >= 5)
+  {
+    if(minor == maxMinor)
+      return false;
+    minor++;
+  }
+
+  value = Money::fromMinor(negative ? -minor : minor);
+  return true;
+}
+
+std::ostream& mg::operator<< (std::ostream &os, const Money &value)
+{
+  char buffer[24];
+  size_t size = formatMoney(value, buffer);
+  os.write(buffer, static_cast<std::streamsize>(size));
+  return os;
+}
+
+std::istream& mg::operator>> (std::istream &is, Money &value)
+{
+  std::string token;
+  if(!(is >> token))
+    return is;
+  if(!parseMoney(token.data(), token.size(), value))
+    is.setstate(std::ios::failbit);
+  return is;
+}
@@ -0,0 +1,210 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include "mgexception.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <functional>
+#include <type_traits>
+
+namespace mg
+{
+  /// Amount of money as a whole number of minor units (cents). Addition, subtraction and
+  /// comparison are exact, so sums don't depend on their order and == means equal amounts.
+  /// Multiplication and division take both operands as decimal numbers with two fraction
+  /// digits and round half away from zero, e.g. total / Money(3) is a third of the total in cents.
+  /// Written and read as decimal text, "12.50", files with double amounts load unchanged.
+  class Money
+  {
+  public:
+    enum { scale = 100 };
+
+    Money(): minor(0) {}
+
+    /// Whole units, Money(3) is 3.00
+    template<typename T>
+    explicit Money(T units, typename std::enable_if<std::is_integral<T>::value>::type* = 0):
+      minor(static_cast<int64_t>(units) * scale) {}
+
+    /// Rounded to the nearest minor unit
+    template<typename T>
+    explicit Money(T amount, typename std::enable_if<std::is_floating_point<T>::value>::type* = 0):
+      minor(static_cast<int64_t>(std::llround(static_cast<double>(amount) * scale))) {}
+
+    static Money fromMinor(int64_t minor) {Money result; result.minor = minor; return result;}
+
+    int64_t getMinor() const {return minor;}
+    double toDouble() const {return static_cast<double>(minor) / scale;}
+
+    Money operator- () const {return fromMinor(-minor);}
+    Money& operator+= (const Money& other) {minor += other.minor; return *this;}
+    Money& operator-= (const Money& other) {minor -= other.minor; return *this;}
+
+    friend Money operator+ (const Money& a, const Money& b) {return fromMinor(a.minor + b.minor);}
+    friend Money operator- (const Money& a, const Money& b) {return fromMinor(a.minor - b.minor);}
+    friend Money operator* (const Money& a, const Money& b) {return fromMinor(mulDiv(a.minor, b.minor, scale));}
+    friend Money operator/ (const Money& a, const Money& b)
+    {
+      if(b.minor == 0)
+        THROW_MG_EXCEPTION("Division of money by zero!");
+      return fromMinor(mulDiv(a.minor, scale, b.minor));
+    }
+
+    friend bool operator== (const Money& a, const Money& b) {return a.minor == b.minor;}
+    friend bool operator!= (const Money& a, const Money& b) {return a.minor != b.minor;}
+    friend bool operator< (const Money& a, const Money& b) {return a.minor < b.minor;}
+    friend bool operator> (const Money& a, const Money& b) {return a.minor > b.minor;}
+    friend bool operator<= (const Money& a, const Money& b) {return a.minor <= b.minor;}
+    friend bool operator>= (const Money& a, const Money& b) {return a.minor >= b.minor;}
+
+    /// a * b / c rounded half away from zero, without overflow of the product
+    static int64_t mulDiv(int64_t a, int64_t b, int64_t c);
+
+  private:
+    int64_t minor;
+  };
+
+  /// Writes @param value as "[-]units.cc" into @param buffer of at least 24 chars, returns the length
+  size_t formatMoney(const Money& value, char* buffer);
+
+  /// Parses a decimal number, e.g. "-12.5", "3", "1.2345e+06"; digits past the cents are rounded.
+  /// Returns false if @param text isn't a number or doesn't fit.
+  bool parseMoney(const char* text, size_t size, Money& value);
+
+  /// Equal split of @param total among @param count participants, part @param i: cents left by
+  /// the division go to the first participants, so the parts add up to the total
+  Money equalPart(const Money& total, size_t count, size_t i);
+
+  /// Split of @param total minor units in proportion to @param weights, non-negative and adding up
+  /// to @param sum > 0, into @param parts: parts are rounded toward zero, the units left go one each
+  /// to the parts with the largest remainders, the first ones on ties, so the parts add up to the total
+  void splitMinor(int64_t total, const std::vector<int64_t>& weights, int64_t sum, std::vector<int64_t>& parts);
+  /// Weighted split of @param total in cents, see splitMinor()
+  void weightedParts(const Money& total, const std::vector<Money>& weights, const Money& sum, std::vector<Money>& parts);
+
+  std::ostream& operator<< (std::ostream& os, const Money& value);
+  /// Reads one whitespace separated token, sets failbit if it isn't a number
+  std::istream& operator>> (std::istream& is, Money& value);
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  inline int64_t Money::mulDiv(int64_t a, int64_t b, int64_t c)
+  {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef __int128 Wide;
+    Wide product = static_cast<Wide>(a) * b;
+    Wide quotient = product / c;
+    Wide remainder = product % c;
+    if(remainder < 0)
+      remainder = -remainder;
+    if(2 * remainder >= (c < 0 ? -static_cast<Wide>(c) : static_cast<Wide>(c)))
+      quotient += ((product < 0) != (c < 0)) ? -1 : 1;
+    return static_cast<int64_t>(quotient);
+#else
+    return static_cast<int64_t>(std::llround(static_cast<long double>(a) * b / c));
+#endif
+  }
+
+  inline Money equalPart(const Money& total, size_t count, size_t i)
+  {
+    int64_t minor = total.getMinor(), n = static_cast<int64_t>(count);
+    int64_t quotient = minor / n, remainder = minor % n;
+    int64_t extra = static_cast<int64_t>(i) < (remainder < 0 ? -remainder : remainder) ? (remainder < 0 ? -1 : 1) : 0;
+    return Money::fromMinor(quotient + extra);
+  }
+
+  inline void splitMinor(int64_t total, const std::vector<int64_t>& weights, int64_t sum, std::vector<int64_t>& parts)
+  {
+    // parts and remainders of the magnitude, the sign is put back at the end
+    int64_t magnitude = total < 0 ? -total : total, left = magnitude;
+    std::vector<int64_t> remainders(weights.size());
+    parts.resize(weights.size());
+    for(size_t i = 0; i < weights.size(); i++)
+    {
+#if defined(__SIZEOF_INT128__)
+      __extension__ typedef __int128 Wide;
+      Wide product = static_cast<Wide>(magnitude) * weights[i];
+      parts[i] = static_cast<int64_t>(product / sum);
+      remainders[i] = static_cast<int64_t>(product % sum);
+#else
+      long double product = static_cast<long double>(magnitude) * weights[i];
+      parts[i] = static_cast<int64_t>(std::floor(product / sum));
+      remainders[i] = static_cast<int64_t>(product - static_cast<long double>(parts[i]) * sum);
+#endif
+      left -= parts[i];
+    }
+
+    std::vector<size_t> order(weights.size());
+    for(size_t i = 0; i < order.size(); i++)
+      order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {return remainders[a] > remainders[b];});
+    for(size_t i = 0; i < order.size() && left > 0; i++, left--)
+      parts[order[i]]++;
+
+    if(total < 0)
+      for(auto i = parts.begin(); i != parts.end(); ++i)
+        *i = -*i;
+  }
+
+  inline void weightedParts(const Money& total, const std::vector<Money>& weights, const Money& sum, std::vector<Money>& parts)
+  {
+    std::vector<int64_t> minorWeights(weights.size()), minorParts;
+    for(size_t i = 0; i < weights.size(); i++)
+      minorWeights[i] = weights[i].getMinor();
+    splitMinor(total.getMinor(), minorWeights, sum.getMinor(), minorParts);
+    parts.resize(minorParts.size());
+    for(size_t i = 0; i < minorParts.size(); i++)
+      parts[i] = Money::fromMinor(minorParts[i]);
+  }
+
+  inline size_t formatMoney(const Money& value, char* buffer)
+  {
+    int64_t minor = value.getMinor();
+    // magnitude as unsigned, -INT64_MIN doesn't fit into int64_t
+    uint64_t magnitude = minor < 0 ? 0 - static_cast<uint64_t>(minor) : static_cast<uint64_t>(minor);
+    uint64_t units = magnitude / Money::scale;
+    unsigned cents = static_cast<unsigned>(magnitude % Money::scale);
+
+    char digits[20];
+    size_t digitsSize = 0;
+    do
+    {
+      digits[digitsSize++] = static_cast<char>('0' + units % 10);
+      units /= 10;
+    } while(units);
+
+    size_t size = 0;
+    if(minor < 0)
+      buffer[size++] = '-';
+    while(digitsSize)
+      buffer[size++] = digits[--digitsSize];
+    buffer[size++] = '.';
+    buffer[size++] = static_cast<char>('0' + cents / 10);
+    buffer[size++] = static_cast<char>('0' + cents % 10);
+    buffer[size] = '\0';
+    return size;
+  }
+
+} // end of namespace
+
+namespace std
+{
+  template<>
+  struct hash<mg::Money>
+  {
+    size_t operator() (const mg::Money& value) const {return std::hash<int64_t>()(value.getMinor());}
+  };
+}
+
+#endif // MONEY_H
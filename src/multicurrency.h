@@ -0,0 +1,214 @@
+#ifndef MULTICURRENCY_H
+#define MULTICURRENCY_H
+
+#include "multigraph.h"
+#include "currency.h"
+#include "reduction.h"
+#include "settlement.h"
+
+#include <vector>
+#include <unordered_map>
+
+namespace mg
+{
+  /// Amounts of the edges of @param graph as arrays, ready for RateTable::convertMinor: minor units
+  /// and currency codes side by side. Every edge is listed twice, with its amount among the outgoing
+  /// edges of its source and negated among the incoming edges of its destination. Entries of vertex v,
+  /// in order of getVertexes(), are offsets[v] .. offsets[v + 1] - 1, the outgoing ones end at splits[v].
+  template<typename V>
+  struct CurrencyEdges
+  {
+    explicit CurrencyEdges(const Multigraph<V, CurrencyAmount>& graph);
+
+    std::vector<size_t> offsets;
+    std::vector<size_t> splits;
+    std::vector<Edge<V, CurrencyAmount>*> edges;
+    std::vector<int64_t> minor;
+    std::vector<uint16_t> codes;
+  };
+
+  /// Net balance of every vertex of a ledger in several currencies, in the base currency of
+  /// @param rates and in order of getVertexes(). Edge amounts are converted in one pass over
+  /// the edge arrays and added up in minor units per vertex; conversion rounds symmetrically,
+  /// so the balances still add up to zero. Throws for a currency without a rate.
+  template<typename V>
+  std::vector<Money> balances(const Multigraph<V, CurrencyAmount>& graph, const RateTable& rates);
+
+  /// Converts every edge and group expense of @param graph into @param currency, no currency
+  /// means the base currency of @param rates. Weights of weighted group expenses are kept.
+  /// Returns the number of converted edges.
+  template<typename V>
+  size_t convertCurrency(Multigraph<V, CurrencyAmount>& graph, const RateTable& rates, Currency currency = Currency());
+
+  /// Converts @param graph into the base currency, then merges parallel edges and cancels mutual debts
+  template<typename V>
+  void reduceEdges(Multigraph<V, CurrencyAmount>& graph, const RateTable& rates);
+
+  /// Greedy settlement of a ledger in several currencies, transfers are in the base currency
+  /// of @param rates; balances not above @param epsilon count as settled
+  template<typename V>
+  std::vector<Transfer<V, CurrencyAmount> > greedySettlement(const Multigraph<V, CurrencyAmount>& graph,
+                                                             const RateTable& rates, const Money& epsilon = Money());
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename V>
+  CurrencyEdges<V>::CurrencyEdges(const Multigraph<V, CurrencyAmount> &graph)
+  {
+    const auto& vertexes = graph.getVertexes();
+    offsets.reserve(vertexes.size() + 1);
+    splits.reserve(vertexes.size());
+    offsets.push_back(0);
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+    {
+      const auto& outgoingEdges = (*i)->getOutgoingEdges();
+      for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+      {
+        edges.push_back(*j);
+        minor.push_back((*j)->getValue().getAmount().getMinor());
+        codes.push_back((*j)->getValue().getCurrency().getCode());
+      }
+      splits.push_back(edges.size());
+
+      const auto& incomingEdges = (*i)->getIncomingEdges();
+      for(auto j = incomingEdges.begin(); j != incomingEdges.end(); ++j)
+      {
+        edges.push_back(*j);
+        minor.push_back(-(*j)->getValue().getAmount().getMinor());
+        codes.push_back((*j)->getValue().getCurrency().getCode());
+      }
+      offsets.push_back(edges.size());
+    }
+  }
+
+  template<typename V>
+  std::vector<Money> balances(const Multigraph<V, CurrencyAmount>& graph, const RateTable& rates)
+  {
+    CurrencyEdges<V> edges(graph);
+    std::vector<int64_t> converted(edges.minor.size());
+    if(!rates.convertMinor(edges.minor.data(), edges.codes.data(), converted.size(), converted.data(), rates.getBase()))
+      THROW_MG_EXCEPTION("The ledger has a currency without a rate!");
+
+    const size_t n = edges.splits.size();
+    std::vector<Money> result(n);
+    for(size_t v = 0; v < n; v++)
+    {
+      int64_t balance = 0;
+      for(size_t k = edges.offsets[v]; k < edges.offsets[v + 1]; k++)
+        balance += converted[k];
+      result[v] = Money::fromMinor(balance);
+    }
+
+    const auto& groupExpenses = graph.getGroupExpenses();
+    if(groupExpenses.empty())
+      return result;
+
+    std::unordered_map<const Vertex<V, CurrencyAmount>*, size_t> positions;
+    positions.reserve(n);
+    size_t position = 0;
+    const auto& vertexes = graph.getVertexes();
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i, ++position)
+      positions[*i] = position;
+    for(auto i = groupExpenses.begin(); i != groupExpenses.end(); ++i)
+    {
+      i->forEachDebt([&](const Vertex<V, CurrencyAmount>* payer, const Vertex<V, CurrencyAmount>* participant,
+                         const CurrencyAmount& amount)
+      {
+        Money part = rates.convert(amount);
+        result[positions[payer]] += part;
+        result[positions[participant]] -= part;
+      });
+    }
+    return result;
+  }
+
+  template<typename V>
+  size_t convertCurrency(Multigraph<V, CurrencyAmount>& graph, const RateTable& rates, Currency currency)
+  {
+    if(currency.isNone())
+      currency = rates.getBase();
+
+    CurrencyEdges<V> edges(graph);
+    std::vector<int64_t> converted(edges.minor.size());
+    if(!rates.convertMinor(edges.minor.data(), edges.codes.data(), converted.size(), converted.data(), currency))
+      THROW_MG_EXCEPTION("The ledger has a currency without a rate!");
+
+    // outgoing entries list every edge once
+    size_t count = 0;
+    for(size_t v = 0; v < edges.splits.size(); v++)
+    {
+      for(size_t k = edges.offsets[v]; k < edges.splits[v]; k++)
+      {
+        if(edges.codes[k] == currency.getCode())
+          continue;
+        graph.setEdgeValue(edges.edges[k], CurrencyAmount(Money::fromMinor(converted[k]), currency));
+        count++;
+      }
+    }
+
+    // group expenses are replaced, the list keeps the others in place
+    std::vector<const GroupExpense<V, CurrencyAmount>*> expenses;
+    const auto& groupExpenses = graph.getGroupExpenses();
+    for(auto i = groupExpenses.begin(); i != groupExpenses.end(); ++i)
+    {
+      bool foreign = i->getTotal().getCurrency() != currency;
+      if(i->getRule() == SPLIT_EXACT)
+        for(auto j = i->getShares().begin(); j != i->getShares().end(); ++j)
+          foreign = foreign || j->getCurrency() != currency;
+      if(foreign)
+        expenses.push_back(&*i);
+    }
+    for(auto i = expenses.begin(); i != expenses.end(); ++i)
+    {
+      const GroupExpense<V, CurrencyAmount>& expense = **i;
+      std::vector<V> participants;
+      participants.reserve(expense.getParticipants().size());
+      for(auto j = expense.getParticipants().begin(); j != expense.getParticipants().end(); ++j)
+        participants.push_back((*j)->getData());
+
+      std::vector<CurrencyAmount> shares(expense.getShares());
+      if(expense.getRule() == SPLIT_EXACT)
+        for(auto j = shares.begin(); j != shares.end(); ++j)
+          *j = rates.convert(*j, currency);
+
+      graph.addGroupExpense(expense.getPayer()->getData(), rates.convert(expense.getTotal(), currency),
+                            participants, expense.getRule(), shares);
+      graph.deleteGroupExpense(*i);
+    }
+    return count;
+  }
+
+  template<typename V>
+  void reduceEdges(Multigraph<V, CurrencyAmount>& graph, const RateTable& rates)
+  {
+    convertCurrency(graph, rates);
+    reduceEdges(graph);
+  }
+
+  template<typename V>
+  std::vector<Transfer<V, CurrencyAmount> > greedySettlement(const Multigraph<V, CurrencyAmount>& graph,
+                                                             const RateTable& rates, const Money& epsilon)
+  {
+    std::vector<Money> sums = balances(graph, rates);
+    std::vector<CurrencyAmount> vertexBalances(sums.size());
+    for(size_t i = 0; i < sums.size(); i++)
+      vertexBalances[i] = CurrencyAmount(sums[i], rates.getBase());
+
+    const auto& graphVertexes = graph.getVertexes();
+    std::vector<Vertex<V, CurrencyAmount>*> vertexes(graphVertexes.begin(), graphVertexes.end());
+    std::vector<size_t> persons(vertexes.size());
+    for(size_t i = 0; i < persons.size(); i++)
+      persons[i] = i;
+
+    std::vector<Transfer<V, CurrencyAmount> > transfers;
+    greedyTransfers(vertexes, vertexBalances, persons, CurrencyAmount(epsilon, rates.getBase()), transfers);
+    return transfers;
+  }
+
+} // end of namespace
+
+#endif // MULTICURRENCY_H
@@ -4,12 +4,23 @@
 #include "vertex.h"
 #include "edge.h"
 #include "mgexception.h"
+#include "status.h"
+#include "mgstats.h"
+#include "dotwriter.h"
+#include "groupexpense.h"
+#include "mutation.h"
 
 #include <list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <functional>
+#include <cstdint>
 
 namespace mg
 {
@@ -17,21 +28,61 @@ namespace mg
   class Multigraph
   {
   public:
-    Multigraph() {}
+    Multigraph(): contentHash(0), listener(NULL) {}
 
     // addition
     void addVertex(V value);
     void addEdge(V src, V dst, E value);
+    /// Bulk insertion path: endpoints are already looked up, returns the new edge
+    Edge<V, E>* addEdge(Vertex<V, E>* src, Vertex<V, E>* dst, E value);
+    /// One record for an expense of @param payer shared by @param participants,
+    /// @param shares are weights or exact amounts depending on @param rule
+    GroupExpense<V, E>* addGroupExpense(V payer, E total, const std::vector<V>& participants,
+                                        SplitRule rule = SPLIT_EQUAL, const std::vector<E>& shares = std::vector<E>());
+
+    // addition and removal without exceptions, expected failures are returned as status,
+    /// @param added receives the new vertex, or the existing one on MG_VERTEX_ALREADY_EXISTS
+    Status tryAddVertex(const V& value, Vertex<V, E>** added = NULL);
+    Status tryAddEdge(const V& src, const V& dst, const E& value, Edge<V, E>** added = NULL);
+    Status tryAddEdge(Vertex<V, E>* src, Vertex<V, E>* dst, const E& value, Edge<V, E>** added = NULL);
+    Status tryDeleteEdge(const V& src, const V& dst, const E& value);
 
     // removal
     bool vertexIsIsolated(V value);
     void deleteVertex(V value);
     void deleteEdge(V src, V dst, E value);
     void deleteEdge(Edge<V, E>* edge);
+    void deleteGroupExpense(const GroupExpense<V, E>* expense);
     void clear();
 
+    // modification
+    /// Use instead of Edge::setValue to keep the content hash up to date
+    void setEdgeValue(Edge<V, E>* edge, const E& value);
+
+    /// Order independent hash of vertexes and edges, maintained on every mutation,
+    /// equal graphs have equal hashes regardless of the order of insertion
+    uint64_t getContentHash() const {return contentHash;}
+
+    /// Every following mutation is reported to @param listener, NULL detaches it
+    void setMutationListener(MutationListener<V, E>* listener) {this->listener = listener;}
+    MutationListener<V, E>* getMutationListener() const {return listener;}
+
     /// Generates .dot file, and writes them them to @param name, to visualise graph with graphviz, at the given
-    void generateDotText(std::string name);
+    void generateDotText(std::string name, const DotOptions& options = DotOptions()) const;
+
+    /// Writes graph in DOT language to @param sink, any object with append(const char*, size_t)
+    template <typename Sink>
+    void writeDot(Sink& sink, const DotOptions& options = DotOptions()) const;
+
+    /// Returns graph in DOT language, ready to be piped to graphviz
+    std::string dotText(const DotOptions& options = DotOptions()) const;
+
+    /// Same output as writeDot()/dotText(), chunks of vertexes are formatted on @param pool
+    template <typename Sink>
+    void writeDotParallel(Sink& sink, ThreadPool& pool, const DotOptions& options = DotOptions()) const;
+    std::string dotTextParallel(ThreadPool& pool, const DotOptions& options = DotOptions()) const;
+
+    size_t getEdgesCount() const;
 
     // invariant
     bool checkGraphInvariant();
@@ -62,7 +113,10 @@ namespace mg
     // access
     VertexIterator beginV() {return VertexIterator(0, &vertexes);}
     VertexIterator endV() {return VertexIterator(vertexes.size(), &vertexes);}
-    std::list<Vertex<V, E> *> getVertexes() const;
+    const std::list<Vertex<V, E> *>& getVertexes() const;
+    /// Hash lookup, returns NULL if there is no such vertex
+    Vertex<V, E>* findVertex(const V& value) const;
+    const std::list<GroupExpense<V, E> >& getGroupExpenses() const {return groupExpenses;}
 
   private:
     class Allocator
@@ -71,7 +125,7 @@ namespace mg
       Allocator(){}
       virtual ~Allocator();
 
-      Vertex<V, E>* getVertex(V& dt);
+      Vertex<V, E>* getVertex(const V& dt);
       Edge<V, E>* getEdge(Vertex<V, E>* src, Vertex<V, E>* dst, E value);
 
       void returnVertex(Vertex<V, E>* vertex);
@@ -80,12 +134,29 @@ namespace mg
       void returnAll();
 
     private:
-      std::list<Vertex<V, E>*> vertexes_pool;
-      std::list<Edge<V, E>*> edges_pool;
+      // hash sets, returning an element doesn't search the whole pool
+      std::unordered_set<Vertex<V, E>*> vertexes_pool;
+      std::unordered_set<Edge<V, E>*> edges_pool;
     };
 
     Allocator alloc;
 
+    void checkEdgeAdded(Edge<V, E>* edge);
+
+    static uint64_t vertexHash(const V& data);
+    static uint64_t edgeHash(const Edge<V, E>* edge);
+    static uint64_t groupExpenseHash(const GroupExpense<V, E>& expense);
+
+    uint64_t contentHash;
+
+    MutationListener<V, E>* listener;
+
+    // vertex by data, every lookup goes through it
+    std::unordered_map<V, Vertex<V, E>*> index;
+
+    // group expenses referring to the vertexes, kept out of the adjacency lists
+    std::list<GroupExpense<V, E> > groupExpenses;
+
   protected:
     std::list<Vertex<V, E>*> vertexes;
   };
@@ -110,6 +181,47 @@ namespace mg
   // ********************************************************************************************
 
 
+  /// splitmix64 finalizer, spreads std::hash values over all 64 bits
+  inline uint64_t mixHash(uint64_t x)
+  {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  template<typename V, typename E>
+  uint64_t Multigraph<V, E>::vertexHash(const V& data)
+  {
+    return mixHash(std::hash<V>()(data));
+  }
+
+  template<typename V, typename E>
+  uint64_t Multigraph<V, E>::edgeHash(const Edge<V, E>* edge)
+  {
+    uint64_t hash = mixHash(std::hash<V>()(edge->getSource()->getData()));
+    hash = mixHash(hash ^ std::hash<V>()(edge->getDestination()->getData()));
+    return mixHash(hash ^ std::hash<E>()(edge->getValue()));
+  }
+
+  template<typename V, typename E>
+  uint64_t Multigraph<V, E>::groupExpenseHash(const GroupExpense<V, E>& expense)
+  {
+    uint64_t hash = mixHash(std::hash<V>()(expense.getPayer()->getData()) ^ 0x67726f7570ULL);
+    hash = mixHash(hash ^ std::hash<E>()(expense.getTotal()) ^ static_cast<uint64_t>(expense.getRule()));
+
+    // participants are hashed in order, shares are attached to them
+    const auto& participants = expense.getParticipants();
+    const auto& shares = expense.getShares();
+    for(size_t i = 0; i < participants.size(); i++)
+    {
+      hash = mixHash(hash ^ std::hash<V>()(participants[i]->getData()));
+      if(!shares.empty())
+        hash = mixHash(hash ^ std::hash<E>()(shares[i]));
+    }
+    return hash;
+  }
+
   template<typename V, typename E>
   std::ostream& operator<< (std::ostream& os, const EdgeManipulator<V, E>& dt)
   {
@@ -124,6 +236,7 @@ namespace mg
   template <typename V, typename E>
   std::ostream& operator<< (std::ostream& os, const Multigraph<V, E>& dt)
   {
+    MG_STATS_TIMER(TIMER_SERIALIZE);
     os << dt.vertexes.size() << "\n";
     size_t edgesCounter = 0;
     std::for_each (dt.vertexes.begin(), dt.vertexes.end(), [&os, &edgesCounter](Vertex<V, E>* i)
@@ -136,7 +249,7 @@ namespace mg
 
     std::for_each (dt.vertexes.begin(), dt.vertexes.end(), [&os](Vertex<V, E>* i)
     {
-      auto outgoingEdges = i->getOutgoingEdges();
+      const auto& outgoingEdges = i->getOutgoingEdges();
 
       std::for_each(outgoingEdges.begin(), outgoingEdges.end(), [&os](Edge<V, E>* j)
       {
@@ -144,136 +257,360 @@ namespace mg
       });
     });
 
+    // optional section, files without group expenses keep the old format
+    if(!dt.groupExpenses.empty())
+    {
+      os << dt.groupExpenses.size() << "\n";
+      for(auto i = dt.groupExpenses.begin(); i != dt.groupExpenses.end(); ++i)
+      {
+        os << i->getPayer()->getData() << "\n"
+           << splitRuleName(i->getRule()) << "\n"
+           << i->getTotal() << "\n"
+           << i->getParticipants().size() << "\n";
+        for(size_t j = 0; j < i->getParticipants().size(); j++)
+        {
+          os << i->getParticipants()[j]->getData() << "\n";
+          if(i->getRule() != SPLIT_EQUAL)
+            os << i->getShares()[j] << "\n";
+        }
+      }
+    }
+
     return os;
   }
 
   template <typename V, typename E>
   std::istream& operator>> ( std::istream& is, Multigraph<V, E>& dt )
   {
+     MG_STATS_TIMER(TIMER_DESERIALIZE);
      size_t vertexesSize, edgesSize;
 
-     is >> vertexesSize;
+     // every record is checked before it's added, input ending before the declared
+     // number of vertexes, edges or group expenses leaves the failbit set
+     if(!(is >> vertexesSize))
+       return is;
 
      V obj;
-     for(size_t i = 0; i != vertexesSize && !is.eof(); i++)
+     for(size_t i = 0; i != vertexesSize; i++)
      {
-       is >> obj;
+       if(!(is >> obj))
+         return is;
        dt.addVertex(obj);
      }
 
-     is >> edgesSize;
+     if(!(is >> edgesSize))
+       return is;
      V obj2;
      E valueObj;
-     for(size_t i = 0; i != edgesSize && !is.eof(); i++)
+     for(size_t i = 0; i != edgesSize; i++)
      {
-       is >> obj
-          >> obj2
-          >> valueObj;
+       if(!(is >> obj >> obj2 >> valueObj))
+         return is;
        dt.addEdge(obj, obj2, valueObj);
      }
 
+     size_t groupExpensesSize = 0;
+     if(!(is >> std::ws).eof() && !(is >> groupExpensesSize))
+       return is;
+     for(size_t i = 0; i != groupExpensesSize; i++)
+     {
+       std::string ruleName;
+       SplitRule rule;
+       size_t participantsSize;
+       if(!(is >> obj >> ruleName >> valueObj >> participantsSize))
+         return is;
+       if(!splitRuleFromName(ruleName, rule))
+       {
+         THROW_MG_EXCEPTION("Unknown split rule \"" + ruleName + "\"!");
+         return is;
+       }
+
+       std::vector<V> participants;
+       std::vector<E> shares;
+       for(size_t j = 0; j != participantsSize; j++)
+       {
+         if(!(is >> obj2))
+           return is;
+         participants.push_back(obj2);
+         if(rule != SPLIT_EQUAL)
+         {
+           E share;
+           if(!(is >> share))
+             return is;
+           shares.push_back(share);
+         }
+       }
+       dt.addGroupExpense(obj, valueObj, participants, rule, shares);
+     }
+
      return is;
   }
 
   template<typename V, typename E>
-  void Multigraph<V, E>::addVertex(V value)
+  Status Multigraph<V, E>::tryAddVertex(const V& value, Vertex<V, E>** added)
   {
-    auto vertexPos = std::find_if(vertexes.begin(), vertexes.end(), [value](Vertex<V, E>* i)
+    MG_STATS_TIMER(TIMER_ADD_VERTEX);
+    MG_STATS_COUNT(STATS_VERTEX_LOOKUPS);
+    MG_STATS_ADD(STATS_LOOKUP_PROBES, index.bucket_count() ? index.bucket_size(index.bucket(value)) : 0);
+    auto vertexPos = index.find(value);
+    if(vertexPos != index.end())
     {
-      return i->getData() == value;
-    });
-
-    if(vertexPos != vertexes.end())
-    {
-      THROW_MG_VERTEX_EXISTING_EXCEPTION("Vertex already exist!", *vertexPos, (*vertexPos)->getData(), V, E);
-      return;
+      if(added)
+        *added = vertexPos->second;
+      return MG_VERTEX_ALREADY_EXISTS;
     }
 
     auto newVertex = alloc.getVertex(value);
     vertexes.push_back(newVertex);
+    index.insert(std::make_pair(value, newVertex));
+    contentHash += vertexHash(value);
+    if(listener)
+      listener->mutated(Mutation<V, E>::vertex(MUTATION_ADD_VERTEX, value));
+
+    if(added)
+      *added = newVertex;
+    return MG_OK;
+  }
+
+  template<typename V, typename E>
+  Status Multigraph<V, E>::tryAddEdge(const V& src, const V& dst, const E& value, Edge<V, E>** added)
+  {
+    if(src == dst)
+      return MG_LOOP_EDGE;
+
+    Vertex<V, E>* srcPointer = findVertex(src);
+    if(!srcPointer)
+      return MG_SRC_VERTEX_NOT_FOUND;
 
-    if(std::find(vertexes.begin(), vertexes.end(), newVertex) == vertexes.end())
-      THROW_MG_VERTEX_EXISTING_EXCEPTION("Vertex wasn't added!", newVertex, value, V, E);
+    Vertex<V, E>* dstPointer = findVertex(dst);
+    if(!dstPointer)
+      return MG_DST_VERTEX_NOT_FOUND;
 
+    return tryAddEdge(srcPointer, dstPointer, value, added);
   }
 
   template<typename V, typename E>
-  void Multigraph<V, E>::addEdge(V src, V dst, E value)
+  Status Multigraph<V, E>::tryAddEdge(Vertex<V, E>* srcPointer, Vertex<V, E>* dstPointer,
+                                      const E& value, Edge<V, E>** added)
   {
-    if(src == dst)
+    MG_STATS_TIMER(TIMER_ADD_EDGE);
+    if(!srcPointer || !dstPointer)
+      return MG_NULL_ENDPOINT;
+
+    if(srcPointer == dstPointer)
+      return MG_LOOP_EDGE;
+
+    auto newEdge = alloc.getEdge(srcPointer, dstPointer, value);
+    srcPointer->addOutgoingEdge(newEdge);
+    dstPointer->addIncomingEdge(newEdge);
+    contentHash += edgeHash(newEdge);
+    if(listener)
+      listener->mutated(Mutation<V, E>::edge(MUTATION_ADD_EDGE, srcPointer->getData(), dstPointer->getData(), value));
+
+    if(added)
+      *added = newEdge;
+    return MG_OK;
+  }
+
+  template<typename V, typename E>
+  Status Multigraph<V, E>::tryDeleteEdge(const V& src, const V& dst, const E& value)
+  {
+    Vertex<V, E>* srcPointer = findVertex(src);
+    if(!srcPointer)
+      return MG_SRC_VERTEX_NOT_FOUND;
+
+    const auto& outgoingEdges = srcPointer->getOutgoingEdges();
+    auto edgePos = std::find_if(outgoingEdges.begin(), outgoingEdges.end(),
+                               [&dst, &value](Edge<V, E>* i)
+    {
+      return (i->getDestination()->getData() == dst)
+          && (i->getValue() == value);
+    });
+
+    if(edgePos == outgoingEdges.end())
+      return MG_EDGE_NOT_FOUND;
+
+    deleteEdge(*edgePos);
+    return MG_OK;
+  }
+
+  template<typename V, typename E>
+  void Multigraph<V, E>::addVertex(V value)
+  {
+    Vertex<V, E>* vertexPointer = NULL;
+    Status status = tryAddVertex(value, &vertexPointer);
+
+    if(status == MG_VERTEX_ALREADY_EXISTS)
     {
-      THROW_MG_EDGE_EXISTING_EXCEPTION("The multigraph prevents the creation of loops!", NULL, V, E);
+      THROW_MG_VERTEX_EXISTING_EXCEPTION(statusText(status), vertexPointer, vertexPointer->getData(), V, E);
       return;
     }
 
-    Vertex<V, E>* srcPointer = NULL;
-    Vertex<V, E>* dstPointer = NULL;
-    std::for_each(vertexes.begin(), vertexes.end(), [src, dst, &srcPointer, &dstPointer](Vertex<V, E>* i)
+    if(vertexes.back() != vertexPointer)
+      THROW_MG_VERTEX_EXISTING_EXCEPTION("Vertex wasn't added!", vertexPointer, value, V, E);
+
+  }
+
+  template<typename V, typename E>
+  void Multigraph<V, E>::addEdge(V src, V dst, E value)
+  {
+    Edge<V, E>* newEdge = NULL;
+    Status status = tryAddEdge(src, dst, value, &newEdge);
+
+    switch(status)
     {
-      auto cur = i->getData();
-      if(cur == src)
-        srcPointer = i;
-      if(cur == dst)
-        dstPointer = i;
-    });
+      case MG_OK:
+        checkEdgeAdded(newEdge);
+        break;
 
-    if(!srcPointer)
+      case MG_SRC_VERTEX_NOT_FOUND:
+        THROW_MG_VERTEX_EXISTING_EXCEPTION(statusText(status), NULL, src, V, E);
+        break;
+
+      case MG_DST_VERTEX_NOT_FOUND:
+        THROW_MG_VERTEX_EXISTING_EXCEPTION(statusText(status), NULL, dst, V, E);
+        break;
+
+      default:
+        THROW_MG_EDGE_EXISTING_EXCEPTION(statusText(status), NULL, V, E);
+        break;
+    }
+  }
+
+  template<typename V, typename E>
+  Edge<V, E>* Multigraph<V, E>::addEdge(Vertex<V, E>* srcPointer, Vertex<V, E>* dstPointer, E value)
+  {
+    Edge<V, E>* newEdge = NULL;
+    Status status = tryAddEdge(srcPointer, dstPointer, value, &newEdge);
+
+    if(status == MG_NULL_ENDPOINT)
     {
-      THROW_MG_VERTEX_EXISTING_EXCEPTION("Src vertex doesn't exist!", NULL, src, V, E);
-      return;
+      THROW_MG_NULL_POINTER_EXCEPTION(statusText(status));
+      return NULL;
     }
 
-    if(!dstPointer)
+    if(status != MG_OK)
     {
-      THROW_MG_VERTEX_EXISTING_EXCEPTION("Dst vertex doesn't exist!", NULL, dst, V, E);
-      return;
+      THROW_MG_EDGE_EXISTING_EXCEPTION(statusText(status), NULL, V, E);
+      return NULL;
     }
 
-    auto newEdge = alloc.getEdge(srcPointer, dstPointer, value);
-    srcPointer->addOutgoingEdge(newEdge);
-    dstPointer->addIncomingEdge(newEdge);
+    checkEdgeAdded(newEdge);
+    return newEdge;
+  }
 
+  template<typename V, typename E>
+  void Multigraph<V, E>::checkEdgeAdded(Edge<V, E>* edge)
+  {
     // check postcondition
-    auto srcOutgoingEdges = srcPointer->getOutgoingEdges();
-    auto dstIncomingEdges = dstPointer->getIncomingEdges();
+    if(edge->getSource()->getOutgoingEdges().back() != edge)
+      THROW_MG_EDGE_EXISTING_EXCEPTION("Edge wasn't added in src outgoing edges!", edge, V, E);
+
+    if(edge->getDestination()->getIncomingEdges().back() != edge)
+      THROW_MG_EDGE_EXISTING_EXCEPTION("Edge wasn't added in dst incoming edges!", edge, V, E);
+  }
+
+  template<typename V, typename E>
+  GroupExpense<V, E>* Multigraph<V, E>::addGroupExpense(V payer, E total, const std::vector<V>& participants,
+                                                        SplitRule rule, const std::vector<E>& shares)
+  {
+    Vertex<V, E>* payerPointer = findVertex(payer);
+    if(!payerPointer)
+    {
+      THROW_MG_VERTEX_EXISTING_EXCEPTION("Payer vertex doesn't exist!", NULL, payer, V, E);
+      return NULL;
+    }
 
-    if(std::find(srcOutgoingEdges.begin(), srcOutgoingEdges.end(), newEdge) == srcOutgoingEdges.end())
-      THROW_MG_EDGE_EXISTING_EXCEPTION("Edge wasn't added in src outgoing edges!", newEdge, V, E);
+    std::vector<Vertex<V, E>*> participantPointers;
+    participantPointers.reserve(participants.size());
+    for(auto i = participants.begin(); i != participants.end(); ++i)
+    {
+      Vertex<V, E>* participant = findVertex(*i);
+      if(!participant)
+      {
+        THROW_MG_VERTEX_EXISTING_EXCEPTION("Participant vertex doesn't exist!", NULL, *i, V, E);
+        return NULL;
+      }
+      participantPointers.push_back(participant);
+    }
 
-    if(std::find(dstIncomingEdges.begin(), dstIncomingEdges.end(), newEdge) == dstIncomingEdges.end())
-      THROW_MG_EDGE_EXISTING_EXCEPTION("Edge wasn't added in dst incoming edges!", newEdge, V, E);
+    groupExpenses.push_back(GroupExpense<V, E>(payerPointer, total, rule, participantPointers, shares));
+    contentHash += groupExpenseHash(groupExpenses.back());
+    if(listener)
+      listener->mutated(Mutation<V, E>::groupExpense(MUTATION_ADD_GROUP_EXPENSE, groupExpenses.back()));
+    return &groupExpenses.back();
+  }
+
+  template<typename V, typename E>
+  void Multigraph<V, E>::deleteGroupExpense(const GroupExpense<V, E>* expense)
+  {
+    for(auto i = groupExpenses.begin(); i != groupExpenses.end(); ++i)
+    {
+      if(&*i != expense)
+        continue;
+      contentHash -= groupExpenseHash(*i);
+      if(listener)
+        listener->mutated(Mutation<V, E>::groupExpense(MUTATION_DELETE_GROUP_EXPENSE, *i));
+      groupExpenses.erase(i);
+      return;
+    }
+    THROW_MG_EXCEPTION("Group expense doesn't exist!");
   }
 
   template<typename V, typename E>
   void Multigraph<V, E>::clear()
   {
+    // reported as deletions of everything, the listener may restore it
+    if(listener)
+    {
+      listener->beginCompound();
+      for(auto i = groupExpenses.begin(); i != groupExpenses.end(); ++i)
+        listener->mutated(Mutation<V, E>::groupExpense(MUTATION_DELETE_GROUP_EXPENSE, *i));
+      for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+      {
+        const auto& outgoingEdges = (*i)->getOutgoingEdges();
+        for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+          listener->mutated(Mutation<V, E>::edge(MUTATION_DELETE_EDGE, (*i)->getData(),
+                                                 (*j)->getDestination()->getData(), (*j)->getValue()));
+      }
+      for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+        listener->mutated(Mutation<V, E>::vertex(MUTATION_DELETE_VERTEX, (*i)->getData()));
+      listener->endCompound();
+    }
+
+    groupExpenses.clear();
     vertexes.clear();
+    index.clear();
     alloc.returnAll();
+    contentHash = 0;
   }
 
   template<typename V, typename E>
   void Multigraph<V, E>::deleteVertex(V value)
   {
-    auto vertexPos = std::find_if(
-          vertexes.begin(), vertexes.end(), [value](Vertex<V, E>* i)
-    {
-      return i->getData() == value;
-    });
+    MG_STATS_TIMER(TIMER_DELETE_VERTEX);
+    Vertex<V, E>* vertexPointer = findVertex(value);
 
-    if(vertexPos == vertexes.end())
+    if(!vertexPointer)
     {
       THROW_MG_VERTEX_EXISTING_EXCEPTION("Vertex doesn't exist!", NULL, value, V, E);
       return;
     }
 
-    Vertex<V, E>* vertexPointer = *vertexPos;
-
     auto vertexIncomingEdges = vertexPointer->getIncomingEdges();
     auto vertexOutgoingEdges = vertexPointer->getOutgoingEdges();
+    MG_STATS_ADD(STATS_ADJACENCY_COPIES, 2);
+    MG_STATS_ADD(STATS_ADJACENCY_COPIED_EDGES, vertexIncomingEdges.size() + vertexOutgoingEdges.size());
+    if(listener)
+      listener->beginCompound();
 
     std::for_each(vertexIncomingEdges.begin(), vertexIncomingEdges.end(),
                   [this](Edge<V, E>* i)
     {
+      contentHash -= edgeHash(i);
+      if(listener)
+        listener->mutated(Mutation<V, E>::edge(MUTATION_DELETE_EDGE, i->getSource()->getData(),
+                                               i->getDestination()->getData(), i->getValue()));
       i->getSource()->delOutgoingEdge(i);
       i->getDestination()->delIncomingEdge(i);
       alloc.returnEdge(i);
@@ -282,12 +619,53 @@ namespace mg
     std::for_each(vertexOutgoingEdges.begin(), vertexOutgoingEdges.end(),
                   [this](Edge<V, E>* i)
     {
+      contentHash -= edgeHash(i);
+      if(listener)
+        listener->mutated(Mutation<V, E>::edge(MUTATION_DELETE_EDGE, i->getSource()->getData(),
+                                               i->getDestination()->getData(), i->getValue()));
       i->getDestination()->delIncomingEdge(i);
       i->getSource()->delOutgoingEdge(i);
       alloc.returnEdge(i);
     });
 
-    vertexes.erase(vertexPos);
+    // group expenses lose the participant, or the whole record if the vertex paid
+    for(auto i = groupExpenses.begin(); i != groupExpenses.end(); )
+    {
+      const auto& participants = i->getParticipants();
+      bool paid = i->getPayer() == vertexPointer;
+      bool participates = std::find(participants.begin(), participants.end(), vertexPointer) != participants.end();
+      if(!paid && !participates)
+      {
+        ++i;
+        continue;
+      }
+
+      // a changed record is reported as deleted and added again,
+      // one left without participants or weights is dropped
+      contentHash -= groupExpenseHash(*i);
+      if(listener)
+        listener->mutated(Mutation<V, E>::groupExpense(MUTATION_DELETE_GROUP_EXPENSE, *i));
+      if(!paid)
+        i->removeParticipant(vertexPointer);
+      if(paid || !i->hasParts())
+      {
+        i = groupExpenses.erase(i);
+        continue;
+      }
+      contentHash += groupExpenseHash(*i);
+      if(listener)
+        listener->mutated(Mutation<V, E>::groupExpense(MUTATION_ADD_GROUP_EXPENSE, *i));
+      ++i;
+    }
+
+    vertexes.erase(std::find(vertexes.begin(), vertexes.end(), vertexPointer));
+    index.erase(value);
+    contentHash -= vertexHash(vertexPointer->getData());
+    if(listener)
+    {
+      listener->mutated(Mutation<V, E>::vertex(MUTATION_DELETE_VERTEX, value));
+      listener->endCompound();
+    }
 
     alloc.returnVertex(vertexPointer);
   }
@@ -295,119 +673,132 @@ namespace mg
   template<typename V, typename E>
   bool Multigraph<V, E>::vertexIsIsolated(V value)
   {
-    auto vertexPos = std::find_if(
-              vertexes.begin(), vertexes.end(), [value](Vertex<V, E>* i)
-        {
-          return i->getData() == value;
-        });
+    Vertex<V, E>* vertexPointer = findVertex(value);
 
-    if(vertexPos == vertexes.end())
+    if(!vertexPointer)
     {
       THROW_MG_VERTEX_EXISTING_EXCEPTION("Vertex doesn't exist!", NULL, value, V, E);
       return false;
     }
 
-    Vertex<V, E>* vertexPointer = *vertexPos;
-
-    auto vertexIncomingEdges = vertexPointer->getIncomingEdges();
-    auto vertexOutgoingEdges = vertexPointer->getOutgoingEdges();
-
-    return (vertexIncomingEdges.empty() &&
-            vertexOutgoingEdges.empty());
+    return (vertexPointer->getIncomingEdges().empty() &&
+            vertexPointer->getOutgoingEdges().empty());
   }
 
   template<typename V, typename E>
   void Multigraph<V, E>::deleteEdge(V src, V dst, E value)
   {
-    auto srcPos = std::find_if(vertexes.begin(), vertexes.end(),
-                               [src](Vertex<V, E>* i)
-    {
-      return i->getData() == src;
-    });
+    Status status = tryDeleteEdge(src, dst, value);
 
-    if(srcPos == vertexes.end())
-    {
-      THROW_MG_VERTEX_EXISTING_EXCEPTION("src vertex doesn't exist!", NULL, src, V, E);
-      return;
-    }
-
-    Vertex<V, E>* srcPointer = *srcPos;
-
-    auto outgoingEdges = srcPointer->getOutgoingEdges();
-
-    auto edgePos = std::find_if(outgoingEdges.begin(), outgoingEdges.end(),
-                               [dst, value](Edge<V, E>* i)
-    {
-      return (i->getDestination()->getData() == dst)
-          && (i->getValue() == value);
-    });
-
-    if(edgePos == outgoingEdges.end())
-    {
-      THROW_MG_EDGE_EXISTING_EXCEPTION("edge doesn't exist", NULL, V, E);
-      return;
-    }
-
-    Edge<V, E>* edgePointer = *edgePos;
+    if(status == MG_SRC_VERTEX_NOT_FOUND)
+      THROW_MG_VERTEX_EXISTING_EXCEPTION(statusText(status), NULL, src, V, E);
 
-    // удаление дуги
-    srcPointer->delOutgoingEdge(edgePointer);
-    edgePointer->getDestination()->delIncomingEdge(edgePointer);
-    alloc.returnEdge(edgePointer);
+    else if(status != MG_OK)
+      THROW_MG_EDGE_EXISTING_EXCEPTION(statusText(status), NULL, V, E);
   }
 
   template<typename V, typename E>
   void Multigraph<V, E>::deleteEdge(Edge<V, E> *edge)
   {
+    MG_STATS_TIMER(TIMER_DELETE_EDGE);
+    contentHash -= edgeHash(edge);
+    if(listener)
+      listener->mutated(Mutation<V, E>::edge(MUTATION_DELETE_EDGE, edge->getSource()->getData(),
+                                             edge->getDestination()->getData(), edge->getValue()));
     edge->getSource()->delOutgoingEdge(edge);
     edge->getDestination()->delIncomingEdge(edge);
     alloc.returnEdge(edge);
   }
 
   template<typename V, typename E>
-  void Multigraph<V, E>::generateDotText(std::string name)
+  void Multigraph<V, E>::setEdgeValue(Edge<V, E> *edge, const E& value)
+  {
+    if(listener)
+      listener->mutated(Mutation<V, E>::edgeValue(edge->getSource()->getData(), edge->getDestination()->getData(),
+                                                  edge->getValue(), value));
+    contentHash -= edgeHash(edge);
+    edge->setValue(value);
+    contentHash += edgeHash(edge);
+  }
+
+  template<typename V, typename E>
+  void Multigraph<V, E>::generateDotText(std::string name, const DotOptions& options) const
   {
     std::ofstream outputFile;
-    outputFile.open(name);
+    outputFile.open(name, std::ios::binary);
     if(!outputFile.is_open())
     {
       THROW_MG_EXCEPTION("Cant open file \"" + name + "\"!");
       return;
     }
-    outputFile << "digraph {\n";
-    std::for_each (vertexes.begin(), vertexes.end(), [&outputFile](Vertex<V, E>* i)
-    {
-             outputFile <<"\"" << i->getData() <<"\"" << ";\n";
-    });
+    std::string text = dotText(options);
+    outputFile.write(text.data(), text.size());
+    outputFile.close();
+  }
 
-    std::for_each (vertexes.begin(), vertexes.end(), [&outputFile](Vertex<V, E>* i)
-    {
-      auto outgoingEdges = i->getOutgoingEdges();
+  template<typename V, typename E>
+  template<typename Sink>
+  void Multigraph<V, E>::writeDot(Sink& sink, const DotOptions& options) const
+  {
+    MG_STATS_TIMER(TIMER_DOT_TEXT);
+    DotWriter<V, E, Sink> writer(sink, options);
+    writer.write(vertexes);
+  }
 
-      std::for_each(outgoingEdges.begin(), outgoingEdges.end(), [&outputFile](Edge<V, E>* j)
-      {
-        outputFile <<"\"" << j->getSource()->getData() <<"\""
-                   << "->"
-                   <<"\"" << j->getDestination()->getData() <<"\""
-                   << "[label=\""
-                   << j->getValue()
-                   << "\"];\n";
-      });
+  template<typename V, typename E>
+  std::string Multigraph<V, E>::dotText(const DotOptions& options) const
+  {
+    // rough size of "name";\n and "src"->"dst"[label="value"];\n statements
+    std::string text;
+    text.reserve(32 + vertexes.size() * 24 + getEdgesCount() * 48);
+    writeDot(text, options);
+    return text;
+  }
 
-    });
-    outputFile << "}";
-    outputFile.close();
+  template<typename V, typename E>
+  template<typename Sink>
+  void Multigraph<V, E>::writeDotParallel(Sink& sink, ThreadPool& pool, const DotOptions& options) const
+  {
+    mg::writeDotParallel(vertexes, sink, pool, options);
   }
 
   template<typename V, typename E>
-  std::list<Vertex<V, E> *> Multigraph<V, E>::getVertexes() const
+  std::string Multigraph<V, E>::dotTextParallel(ThreadPool& pool, const DotOptions& options) const
+  {
+    std::string text;
+    text.reserve(32 + vertexes.size() * 24 + getEdgesCount() * 48);
+    writeDotParallel(text, pool, options);
+    return text;
+  }
+
+  template<typename V, typename E>
+  size_t Multigraph<V, E>::getEdgesCount() const
+  {
+    size_t edgesCounter = 0;
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+      edgesCounter += (*i)->getOutgoingEdges().size();
+    return edgesCounter;
+  }
+
+  template<typename V, typename E>
+  const std::list<Vertex<V, E> *>& Multigraph<V, E>::getVertexes() const
   {
     return vertexes;
   }
 
+  template<typename V, typename E>
+  Vertex<V, E>* Multigraph<V, E>::findVertex(const V& value) const
+  {
+    MG_STATS_COUNT(STATS_VERTEX_LOOKUPS);
+    MG_STATS_ADD(STATS_LOOKUP_PROBES, index.bucket_count() ? index.bucket_size(index.bucket(value)) : 0);
+    auto pos = index.find(value);
+    return pos == index.end() ? NULL : pos->second;
+  }
+
   template<typename V, typename E>
   bool Multigraph<V, E>::checkGraphInvariant()
   {
+    MG_STATS_TIMER(TIMER_CHECK_INVARIANT);
     // step 1
 
     size_t incomingEdgesCounter = 0;
@@ -426,27 +817,28 @@ namespace mg
 
     // step 2
 
+    // endpoints are looked up in a hash set, the check is linear in the graph size
+    std::unordered_set<const Vertex<V, E>*> vertexesSet(vertexes.begin(), vertexes.end());
+
     for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
     {
-      auto outgoingEdges = (*i)->getOutgoingEdges();
+      const auto& outgoingEdges = (*i)->getOutgoingEdges();
 
       for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
       {
         if((*j) == NULL)
           return false;
-        auto dstVertex = (*j)->getDestination();
-        if(std::find(vertexes.begin(), vertexes.end(), dstVertex) == vertexes.end())
+        if(!vertexesSet.count((*j)->getDestination()))
           return false;
       }
 
-      auto incomingEdges = (*i)->getIncomingEdges();
+      const auto& incomingEdges = (*i)->getIncomingEdges();
 
       for(auto j = incomingEdges.begin(); j != incomingEdges.end(); ++j)
       {
         if((*j) == NULL)
           return false;
-        auto srcVertex = (*j)->getSource();
-        if(std::find(vertexes.begin(), vertexes.end(), srcVertex) == vertexes.end())
+        if(!vertexesSet.count((*j)->getSource()))
           return false;
       }
     }
@@ -528,25 +920,28 @@ namespace mg
   }
 
   template<typename V, typename E>
-  Vertex<V, E> *Multigraph<V, E>::Allocator::getVertex(V& dt)
+  Vertex<V, E> *Multigraph<V, E>::Allocator::getVertex(const V& dt)
   {
+    MG_STATS_COUNT(STATS_VERTEX_ALLOCATIONS);
     Vertex<V, E>* newVertex = new Vertex<V, E>(dt);
-    vertexes_pool.push_back(newVertex);
+    vertexes_pool.insert(newVertex);
     return newVertex;
   }
 
   template<typename V, typename E>
   Edge<V, E> *Multigraph<V, E>::Allocator::getEdge(Vertex<V, E>* src, Vertex<V, E>* dst, E value)
   {
+    MG_STATS_COUNT(STATS_EDGE_ALLOCATIONS);
     Edge<V, E>* newEdge = new Edge<V, E>(src, dst, value);
-    edges_pool.push_back(newEdge);
+    edges_pool.insert(newEdge);
     return newEdge;
   }
 
   template<typename V, typename E>
   void Multigraph<V, E>::Allocator::returnVertex(Vertex<V, E> *vertex)
   {
-    auto pos = std::find(vertexes_pool.begin(), vertexes_pool.end(), vertex);
+    MG_STATS_COUNT(STATS_VERTEX_RETURNS);
+    auto pos = vertexes_pool.find(vertex);
 
     if(pos == vertexes_pool.end())
     {
@@ -561,7 +956,8 @@ namespace mg
   template<typename V, typename E>
   void Multigraph<V, E>::Allocator::returnEdge(Edge<V, E> *edge)
   {
-    auto pos = std::find(edges_pool.begin(), edges_pool.end(), edge);
+    MG_STATS_COUNT(STATS_EDGE_RETURNS);
+    auto pos = edges_pool.find(edge);
 
     if(pos == edges_pool.end())
     {
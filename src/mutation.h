@@ -0,0 +1,125 @@
+#ifndef MUTATION_H
+#define MUTATION_H
+
+#include "groupexpense.h"
+
+#include <vector>
+
+namespace mg
+{
+  enum MutationType { MUTATION_ADD_VERTEX,
+                      MUTATION_DELETE_VERTEX,         // the vertex is isolated, its edges are deleted before
+                      MUTATION_ADD_EDGE,
+                      MUTATION_DELETE_EDGE,
+                      MUTATION_SET_EDGE_VALUE,
+                      MUTATION_ADD_GROUP_EXPENSE,
+                      MUTATION_DELETE_GROUP_EXPENSE };
+
+  /// One primitive change of a Multigraph, described by values, so it stays meaningful
+  /// after the vertexes and edges it touched are gone
+  template<typename V, typename E>
+  struct Mutation
+  {
+    static Mutation vertex(MutationType type, const V& data);
+    static Mutation edge(MutationType type, const V& source, const V& destination, const E& value);
+    static Mutation edgeValue(const V& source, const V& destination, const E& oldValue, const E& value);
+    static Mutation groupExpense(MutationType type, const GroupExpense<V, E>& expense);
+
+    /// The mutation which reverts this one
+    Mutation inverse() const;
+
+    MutationType type;
+    /// Vertex, edge source or expense payer
+    V source;
+    V destination;
+    /// Edge value or expense total
+    E value;
+    /// Edge value before MUTATION_SET_EDGE_VALUE
+    E oldValue;
+    SplitRule rule;
+    std::vector<V> participants;
+    std::vector<E> shares;
+  };
+
+  /// Receives every mutation of the multigraph it is attached to, see Multigraph::setMutationListener()
+  template<typename V, typename E>
+  class MutationListener
+  {
+  public:
+    virtual ~MutationListener() {}
+    virtual void mutated(const Mutation<V, E>& mutation) = 0;
+    /// Mutations reported between the calls make up one change, such as deletion of a vertex with its edges
+    virtual void beginCompound() {}
+    virtual void endCompound() {}
+  };
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename V, typename E>
+  Mutation<V, E> Mutation<V, E>::vertex(MutationType type, const V &data)
+  {
+    Mutation mutation;
+    mutation.type = type;
+    mutation.source = data;
+    mutation.value = E();
+    mutation.oldValue = E();
+    mutation.rule = SPLIT_EQUAL;
+    return mutation;
+  }
+
+  template<typename V, typename E>
+  Mutation<V, E> Mutation<V, E>::edge(MutationType type, const V &source, const V &destination, const E &value)
+  {
+    Mutation mutation = vertex(type, source);
+    mutation.destination = destination;
+    mutation.value = value;
+    return mutation;
+  }
+
+  template<typename V, typename E>
+  Mutation<V, E> Mutation<V, E>::edgeValue(const V &source, const V &destination, const E &oldValue, const E &value)
+  {
+    Mutation mutation = edge(MUTATION_SET_EDGE_VALUE, source, destination, value);
+    mutation.oldValue = oldValue;
+    return mutation;
+  }
+
+  template<typename V, typename E>
+  Mutation<V, E> Mutation<V, E>::groupExpense(MutationType type, const GroupExpense<V, E> &expense)
+  {
+    Mutation mutation = vertex(type, expense.getPayer()->getData());
+    mutation.value = expense.getTotal();
+    mutation.rule = expense.getRule();
+    mutation.shares = expense.getShares();
+
+    const auto& participants = expense.getParticipants();
+    mutation.participants.reserve(participants.size());
+    for(auto i = participants.begin(); i != participants.end(); ++i)
+      mutation.participants.push_back((*i)->getData());
+    return mutation;
+  }
+
+  template<typename V, typename E>
+  Mutation<V, E> Mutation<V, E>::inverse() const
+  {
+    Mutation result = *this;
+    switch(type)
+    {
+      case MUTATION_ADD_VERTEX: result.type = MUTATION_DELETE_VERTEX; break;
+      case MUTATION_DELETE_VERTEX: result.type = MUTATION_ADD_VERTEX; break;
+      case MUTATION_ADD_EDGE: result.type = MUTATION_DELETE_EDGE; break;
+      case MUTATION_DELETE_EDGE: result.type = MUTATION_ADD_EDGE; break;
+      case MUTATION_SET_EDGE_VALUE: std::swap(result.value, result.oldValue); break;
+      case MUTATION_ADD_GROUP_EXPENSE: result.type = MUTATION_DELETE_GROUP_EXPENSE; break;
+      case MUTATION_DELETE_GROUP_EXPENSE: result.type = MUTATION_ADD_GROUP_EXPENSE; break;
+    }
+    return result;
+  }
+
+} // end of namespace
+
+#endif // MUTATION_H
@@ -0,0 +1,147 @@
+#ifndef PERSISTENTVECTOR_H
+#define PERSISTENTVECTOR_H
+
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+namespace mg
+{
+  /// Vector stored as a 32-way tree of shared nodes. Copying is O(1), copies share every node;
+  /// set() and pushBack() copy only the nodes on the path to the element, and only
+  /// if some other copy still uses them. Nodes are freed with their last user.
+  /// Copies may be read from any thread, each copy is modified by one thread at a time.
+  template<typename T>
+  class PersistentVector
+  {
+  public:
+    PersistentVector(): count(0), shift(0) {}
+
+    size_t size() const {return count;}
+    bool empty() const {return count == 0;}
+
+    /// O(log32 n)
+    const T& operator[] (size_t position) const;
+
+    void set(size_t position, const T& value);
+    void pushBack(const T& value);
+    void clear();
+
+    /// Calls @param f(value) for every element in order, visits each node once
+    template<typename F>
+    void forEach(F f) const;
+
+  private:
+    enum { bits = 5, width = 1 << bits, mask = width - 1 };
+
+    struct Node
+    {
+      std::vector<std::shared_ptr<Node> > children;
+      std::vector<T> values;
+    };
+
+    static Node* writable(std::shared_ptr<Node>& node);
+
+    template<typename F>
+    static void forEach(const Node* node, size_t level, F& f);
+
+    std::shared_ptr<Node> root;
+    size_t count;
+    size_t shift;
+  };
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename T>
+  const T& PersistentVector<T>::operator[](size_t position) const
+  {
+    const Node* node = root.get();
+    for(size_t level = shift; level > 0; level -= bits)
+      node = node->children[(position >> level) & mask].get();
+    return node->values[position & mask];
+  }
+
+  template<typename T>
+  void PersistentVector<T>::set(size_t position, const T &value)
+  {
+    std::shared_ptr<Node>* node = &root;
+    for(size_t level = shift; level > 0; level -= bits)
+      node = &writable(*node)->children[(position >> level) & mask];
+    writable(*node)->values[position & mask] = value;
+  }
+
+  template<typename T>
+  void PersistentVector<T>::pushBack(const T &value)
+  {
+    // the tree is full, it becomes the first child of a new root
+    if(count == (static_cast<size_t>(1) << (shift + bits)))
+    {
+      std::shared_ptr<Node> newRoot = std::make_shared<Node>();
+      newRoot->children.push_back(root);
+      root = newRoot;
+      shift += bits;
+    }
+
+    std::shared_ptr<Node>* node = &root;
+    for(size_t level = shift; level > 0; level -= bits)
+    {
+      Node* parent = writable(*node);
+      size_t child = (count >> level) & mask;
+      if(child >= parent->children.size())
+        parent->children.resize(child + 1);
+      node = &parent->children[child];
+    }
+    writable(*node)->values.push_back(value);
+    count++;
+  }
+
+  template<typename T>
+  void PersistentVector<T>::clear()
+  {
+    root.reset();
+    count = 0;
+    shift = 0;
+  }
+
+  template<typename T>
+  template<typename F>
+  void PersistentVector<T>::forEach(F f) const
+  {
+    if(root)
+      forEach(root.get(), shift, f);
+  }
+
+  template<typename T>
+  template<typename F>
+  void PersistentVector<T>::forEach(const Node* node, size_t level, F& f)
+  {
+    if(level == 0)
+    {
+      for(auto i = node->values.begin(); i != node->values.end(); ++i)
+        f(*i);
+      return;
+    }
+    for(auto i = node->children.begin(); i != node->children.end(); ++i)
+      forEach(i->get(), level - bits, f);
+  }
+
+  template<typename T>
+  typename PersistentVector<T>::Node* PersistentVector<T>::writable(std::shared_ptr<Node> &node)
+  {
+    if(!node)
+      node = std::make_shared<Node>();
+    else if(node.use_count() > 1)
+      node = std::make_shared<Node>(*node);   // shared with another copy, copy on write
+    else
+      std::atomic_thread_fence(std::memory_order_acquire);   // former sharers are done reading
+    return node.get();
+  }
+
+} // end of namespace
+
+#endif // PERSISTENTVECTOR_H
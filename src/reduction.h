@@ -0,0 +1,150 @@
+#ifndef REDUCTION_H
+#define REDUCTION_H
+
+#include "multigraph.h"
+#include "money.h"
+
+#include <algorithm>
+#include <vector>
+#include <functional>
+
+namespace mg
+{
+  /// Merges parallel edges into one and cancels mutual debts of every pair of vertexes,
+  /// balances of the vertexes are preserved
+  template<typename V, typename E>
+  void reduceEdges(Multigraph<V, E>& graph);
+
+  /// Integer kernel for Money: parallel edges of a vertex are grouped by destination and every
+  /// group is added up at once in minor units, exact sums don't depend on the order
+  template<typename V>
+  void reduceEdges(Multigraph<V, Money>& graph);
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  /// Sums parallel edges into the first of them
+  template<typename V, typename E>
+  void mergeParallelEdges(Multigraph<V, E>& graph)
+  {
+    std::for_each(graph.beginV(), graph.endV(), [&graph](Vertex<V, E>* i)
+    {
+      auto outgoingEdges = i->getOutgoingEdges();
+      for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+      {
+        auto k = j;
+        ++k;
+        while(k!= outgoingEdges.end())
+        {
+          if((*j)->getDestination()->getData() ==
+             (*k)->getDestination()->getData())
+          {
+            E current = (*j)->getValue();
+            graph.setEdgeValue(*j, current + (*k)->getValue());
+            Edge<V, E>* delEdgeP = *k;
+            auto oldKpos = k;
+            ++k;
+            graph.deleteEdge(delEdgeP);
+            outgoingEdges.erase(oldKpos);
+          }
+          else ++k;
+        }
+      }
+    });
+  }
+
+  /// Replaces debts in both directions between two vertexes with their difference
+  template<typename V, typename E>
+  void cancelMutualDebts(Multigraph<V, E>& graph)
+  {
+    std::for_each(graph.beginV(), graph.endV(), [&graph](Vertex<V, E>* i)
+    {
+      auto outgoingEdges = i->getOutgoingEdges();
+      std::for_each(outgoingEdges.begin(), outgoingEdges.end(), [&graph](Edge<V, E>* j)
+      {
+        auto dst = j->getDestination();
+        const auto& dstOutgoingEdges = dst->getOutgoingEdges();
+        auto reverseEdgePos =
+            std::find_if(dstOutgoingEdges.begin(), dstOutgoingEdges.end(),
+                         [j](Edge<V, E>* k)
+        {
+          return j->getSource() == k->getDestination();
+        });
+
+        if (reverseEdgePos != dstOutgoingEdges.end())
+        {
+          auto reverseEdge = *reverseEdgePos;
+          E outgoingVal = j->getValue();
+          E incomingVal = reverseEdge->getValue();
+          if(outgoingVal > incomingVal)
+          {
+            graph.setEdgeValue(j, outgoingVal - incomingVal);
+            graph.deleteEdge(reverseEdge);
+          }
+          else
+            if(outgoingVal < incomingVal)
+            {
+              graph.setEdgeValue(reverseEdge, incomingVal - outgoingVal);
+              graph.deleteEdge(j);
+            }
+            else
+            {
+              graph.deleteEdge(reverseEdge);
+              graph.deleteEdge(j);
+            }
+        }
+      });
+    });
+  }
+
+  template<typename V, typename E>
+  void reduceEdges(Multigraph<V, E>& graph)
+  {
+    mergeParallelEdges(graph);
+    cancelMutualDebts(graph);
+  }
+
+  template<typename V>
+  void reduceEdges(Multigraph<V, Money>& graph)
+  {
+    std::vector<Edge<V, Money>*> edges;
+    std::less<const Vertex<V, Money>*> before;
+    std::for_each(graph.beginV(), graph.endV(), [&](Vertex<V, Money>* i)
+    {
+      const auto& outgoingEdges = i->getOutgoingEdges();
+      if(outgoingEdges.size() < 2)
+        return;
+
+      // stable, the first edge of every group keeps the sum as in mergeParallelEdges()
+      edges.assign(outgoingEdges.begin(), outgoingEdges.end());
+      std::stable_sort(edges.begin(), edges.end(), [&before](Edge<V, Money>* a, Edge<V, Money>* b)
+      {
+        return before(a->getDestination(), b->getDestination());
+      });
+
+      for(size_t begin = 0, end; begin < edges.size(); begin = end)
+      {
+        end = begin + 1;
+        while(end < edges.size() && edges[end]->getDestination() == edges[begin]->getDestination())
+          end++;
+        if(end - begin < 2)
+          continue;
+
+        int64_t sum = 0;
+        for(size_t j = begin; j < end; j++)
+          sum += edges[j]->getValue().getMinor();
+        graph.setEdgeValue(edges[begin], Money::fromMinor(sum));
+        for(size_t j = begin + 1; j < end; j++)
+          graph.deleteEdge(edges[j]);
+      }
+    });
+
+    cancelMutualDebts(graph);
+  }
+
+} // end of namespace
+
+#endif // REDUCTION_H
@@ -0,0 +1,136 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace mg
+{
+  /// Bounded lock-free multi-producer single-consumer queue. Every cell carries a sequence
+  /// number telling whose turn it is: producers claim a position with one compare-and-swap
+  /// and never wait for each other, the consumer only reads and releases cells.
+  /// T must be default constructible and movable.
+  template<typename T>
+  class MpscRingBuffer
+  {
+  public:
+    /// @param capacity is rounded up to a power of two
+    explicit MpscRingBuffer(size_t capacity);
+
+    MpscRingBuffer(const MpscRingBuffer&) = delete;
+    MpscRingBuffer& operator= (const MpscRingBuffer&) = delete;
+
+    /// Any thread. Returns false if the queue is full, @param value is left untouched then
+    bool tryPush(T& value);
+
+    /// Consumer thread only. Returns false if the queue is empty
+    bool tryPop(T& value);
+
+    /// Consumer thread only. Moves up to @param max values to the end of @param batch,
+    /// returns their number
+    size_t popBatch(std::vector<T>& batch, size_t max);
+
+    size_t capacity() const {return cells.size();}
+
+  private:
+    enum { cacheLine = 64 };
+
+    struct Cell
+    {
+      Cell(): sequence(0), value() {}
+      Cell(const Cell& cell): sequence(cell.sequence.load()), value(cell.value) {}
+
+      std::atomic<size_t> sequence;
+      T value;
+    };
+
+    std::vector<Cell> cells;
+    size_t mask;
+
+    // producers and the consumer write their positions from different cores
+    char padding0[cacheLine];
+    std::atomic<size_t> enqueuePosition;
+    char padding1[cacheLine];
+    size_t dequeuePosition;
+    char padding2[cacheLine];
+  };
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename T>
+  MpscRingBuffer<T>::MpscRingBuffer(size_t capacity):
+    enqueuePosition(0), dequeuePosition(0)
+  {
+    size_t size = 2;
+    while(size < capacity)
+      size *= 2;
+
+    cells.resize(size);
+    mask = size - 1;
+    for(size_t i = 0; i < size; i++)
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  template<typename T>
+  bool MpscRingBuffer<T>::tryPush(T &value)
+  {
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+    Cell* cell;
+    for(;;)
+    {
+      cell = &cells[position & mask];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      ptrdiff_t difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position);
+
+      if(difference == 0)
+      {
+        // the cell is free, claim the position
+        if(enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if(difference < 0)
+        return false;   // the consumer hasn't released the cell yet, the queue is full
+      else
+        position = enqueuePosition.load(std::memory_order_relaxed);
+    }
+
+    cell->value = std::move(value);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  template<typename T>
+  bool MpscRingBuffer<T>::tryPop(T &value)
+  {
+    Cell& cell = cells[dequeuePosition & mask];
+    if(cell.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+      return false;
+
+    value = std::move(cell.value);
+    // the cell becomes free for the producer one lap ahead
+    cell.sequence.store(dequeuePosition + mask + 1, std::memory_order_release);
+    dequeuePosition++;
+    return true;
+  }
+
+  template<typename T>
+  size_t MpscRingBuffer<T>::popBatch(std::vector<T> &batch, size_t max)
+  {
+    size_t popped = 0;
+    T value;
+    while(popped < max && tryPop(value))
+    {
+      batch.push_back(std::move(value));
+      popped++;
+    }
+    return popped;
+  }
+
+} // end of namespace
+
+#endif // RINGBUFFER_H
@@ -0,0 +1,245 @@
+#ifndef SETTLEMENT_H
+#define SETTLEMENT_H
+
+#include "multigraph.h"
+#include "balance.h"
+#include "threadpool.h"
+
+#include <vector>
+#include <queue>
+#include <future>
+#include <utility>
+#include <cstdint>
+
+namespace mg
+{
+  /// One payment of a settlement: @param debtor pays @param amount to @param creditor
+  template<typename V, typename E>
+  struct Transfer
+  {
+    Vertex<V, E>* creditor;
+    Vertex<V, E>* debtor;
+    E amount;
+  };
+
+  /// Settles all debts of @param graph: the largest debtor pays the largest creditor until
+  /// every balance is within @param epsilon of zero. At most n - 1 transfers for n persons.
+  template<typename V, typename E>
+  std::vector<Transfer<V, E> > greedySettlement(const Multigraph<V, E>& graph, const E& epsilon = E());
+
+  /// Settlement with the fewest transfers: persons with nonzero balances are split into the
+  /// largest number of zero-sum groups, a group of k persons settles with k - 1 transfers.
+  /// Bitmask dynamic programming over all subsets, O(2^n * n) time and O(2^n) memory, subsets
+  /// of equal size are evaluated in parallel on @param pool. Sums within @param epsilon of zero
+  /// are zero, so it should exceed the rounding error of E. Above @param maxPersons persons
+  /// with nonzero balances greedySettlement() is used instead.
+  template<typename V, typename E>
+  std::vector<Transfer<V, E> > exactSettlement(const Multigraph<V, E>& graph, const E& epsilon = E(),
+                                               size_t maxPersons = 20, ThreadPool& pool = ThreadPool::global());
+
+  /// Replaces edges and group expenses of @param graph with one edge per transfer,
+  /// balances of the vertexes are preserved
+  template<typename V, typename E>
+  void applySettlement(Multigraph<V, E>& graph, const std::vector<Transfer<V, E> >& transfers);
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  /// Greedy settlement of @param persons, positions in @param vertexes and @param vertexBalances
+  template<typename V, typename E>
+  void greedyTransfers(const std::vector<Vertex<V, E>*>& vertexes, const std::vector<E>& vertexBalances,
+                       const std::vector<size_t>& persons, const E& epsilon, std::vector<Transfer<V, E> >& transfers)
+  {
+    // ties are broken by position, so equal graphs give equal settlements
+    typedef std::pair<E, size_t> Amount;
+
+    std::priority_queue<Amount> creditors, debtors;
+    for(auto i = persons.begin(); i != persons.end(); ++i)
+    {
+      const E& balance = vertexBalances[*i];
+      if(balance > epsilon)
+        creditors.push(Amount(balance, *i));
+      else if(E() - balance > epsilon)
+        debtors.push(Amount(E() - balance, *i));
+    }
+
+    while(!creditors.empty() && !debtors.empty())
+    {
+      Amount creditor = creditors.top();
+      Amount debtor = debtors.top();
+      creditors.pop();
+      debtors.pop();
+
+      E amount = creditor.first < debtor.first ? creditor.first : debtor.first;
+      Transfer<V, E> transfer = {vertexes[creditor.second], vertexes[debtor.second], amount};
+      transfers.push_back(transfer);
+
+      // the smaller side is settled, the rest of the other one goes back
+      if(creditor.first - amount > epsilon)
+        creditors.push(Amount(creditor.first - amount, creditor.second));
+      if(debtor.first - amount > epsilon)
+        debtors.push(Amount(debtor.first - amount, debtor.second));
+    }
+  }
+
+  template<typename V, typename E>
+  std::vector<Transfer<V, E> > greedySettlement(const Multigraph<V, E>& graph, const E& epsilon)
+  {
+    std::vector<E> vertexBalances = balances(graph);
+    const auto& graphVertexes = graph.getVertexes();
+    std::vector<Vertex<V, E>*> vertexes(graphVertexes.begin(), graphVertexes.end());
+    std::vector<size_t> persons(vertexes.size());
+    for(size_t i = 0; i < persons.size(); i++)
+      persons[i] = i;
+
+    std::vector<Transfer<V, E> > transfers;
+    greedyTransfers(vertexes, vertexBalances, persons, epsilon, transfers);
+    return transfers;
+  }
+
+  template<typename V, typename E>
+  std::vector<Transfer<V, E> > exactSettlement(const Multigraph<V, E>& graph, const E& epsilon,
+                                               size_t maxPersons, ThreadPool& pool)
+  {
+    std::vector<E> vertexBalances = balances(graph);
+    const auto& graphVertexes = graph.getVertexes();
+    std::vector<Vertex<V, E>*> vertexes(graphVertexes.begin(), graphVertexes.end());
+
+    std::vector<size_t> persons;
+    for(size_t i = 0; i < vertexes.size(); i++)
+      if(vertexBalances[i] > epsilon || E() - vertexBalances[i] > epsilon)
+        persons.push_back(i);
+
+    if(persons.size() > maxPersons || persons.size() >= 32)
+      return greedySettlement(graph, epsilon);
+
+    // masks in order of the number of set bits, a layer depends only on the previous one
+    const size_t n = persons.size();
+    const uint32_t full = static_cast<uint32_t>((static_cast<uint64_t>(1) << n) - 1);
+    std::vector<uint32_t> order(static_cast<size_t>(full) + 1);
+    std::vector<size_t> layers(n + 2, 0);
+    for(uint32_t mask = 0; ; mask++)
+    {
+      size_t bits = 0;
+      for(uint32_t m = mask; m; m &= m - 1)
+        bits++;
+      layers[bits + 1]++;
+      if(mask == full)
+        break;
+    }
+    for(size_t i = 1; i < layers.size(); i++)
+      layers[i] += layers[i - 1];
+    {
+      std::vector<size_t> next(layers.begin(), layers.end() - 1);
+      for(uint32_t mask = 0; ; mask++)
+      {
+        size_t bits = 0;
+        for(uint32_t m = mask; m; m &= m - 1)
+          bits++;
+        order[next[bits]++] = mask;
+        if(mask == full)
+          break;
+      }
+    }
+
+    // sums[mask] is the balance of the subset, groups[mask] the most zero-sum groups
+    // a sequence of its persons can be cut into (memoized for every subset)
+    std::vector<E> sums(order.size(), E());
+    std::vector<unsigned char> groups(order.size(), 0);
+    auto evaluate = [&](size_t begin, size_t end)
+    {
+      for(size_t k = begin; k < end; k++)
+      {
+        uint32_t mask = order[k];
+        unsigned char best = 0;
+        bool first = true;
+        for(size_t i = 0; i < n; i++)
+        {
+          uint32_t bit = static_cast<uint32_t>(1) << i;
+          if(!(mask & bit))
+            continue;
+          if(first)
+          {
+            sums[mask] = sums[mask ^ bit] + vertexBalances[persons[i]];
+            first = false;
+          }
+          best = std::max(best, groups[mask ^ bit]);
+        }
+        E sum = sums[mask];
+        bool zero = !(sum > epsilon) && !(E() - sum > epsilon);
+        groups[mask] = best + (zero ? 1 : 0);
+      }
+    };
+
+    const size_t chunk = 4096;
+    for(size_t bits = 1; bits <= n; bits++)
+    {
+      size_t begin = layers[bits], end = layers[bits + 1];
+      if(end - begin <= chunk || pool.size() < 2)
+      {
+        evaluate(begin, end);
+        continue;
+      }
+
+      std::vector<std::future<void> > tasks;
+      size_t step = std::max(chunk, (end - begin) / (pool.size() * 4) + 1);
+      for(size_t i = begin; i < end; i += step)
+      {
+        size_t last = std::min(end, i + step);
+        tasks.push_back(pool.submit([&evaluate, i, last]() {evaluate(i, last);}));
+      }
+      for(auto i = tasks.begin(); i != tasks.end(); ++i)
+        i->get();
+    }
+
+    // walk back from the full set, a subset with zero sum closes a group
+    std::vector<Transfer<V, E> > transfers;
+    std::vector<size_t> group;
+    uint32_t mask = full;
+    while(mask)
+    {
+      E sum = sums[mask];
+      bool zero = !(sum > epsilon) && !(E() - sum > epsilon);
+      unsigned char rest = groups[mask] - (zero ? 1 : 0);
+      for(size_t i = 0; i < n; i++)
+      {
+        uint32_t bit = static_cast<uint32_t>(1) << i;
+        if((mask & bit) && groups[mask ^ bit] == rest)
+        {
+          group.push_back(persons[i]);
+          mask ^= bit;
+          break;
+        }
+      }
+
+      E rebalance = sums[mask];
+      if(!mask || (!(rebalance > epsilon) && !(E() - rebalance > epsilon)))
+      {
+        greedyTransfers(vertexes, vertexBalances, group, epsilon, transfers);
+        group.clear();
+      }
+    }
+    return transfers;
+  }
+
+  template<typename V, typename E>
+  void applySettlement(Multigraph<V, E>& graph, const std::vector<Transfer<V, E> >& transfers)
+  {
+    while(!graph.getGroupExpenses().empty())
+      graph.deleteGroupExpense(&graph.getGroupExpenses().front());
+
+    const auto& vertexes = graph.getVertexes();
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+      while(!(*i)->getOutgoingEdges().empty())
+        graph.deleteEdge((*i)->getOutgoingEdges().back());
+
+    for(auto i = transfers.begin(); i != transfers.end(); ++i)
+      graph.addEdge(i->creditor, i->debtor, i->amount);
+  }
+
+} // end of namespace
+
+#endif // SETTLEMENT_H
@@ -0,0 +1,123 @@
+#ifndef SHAREDMUTEX_H
+#define SHAREDMUTEX_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstddef>
+
+namespace mg
+{
+  /// Reader-writer lock with a reader counter per stripe of threads: readers touch only their
+  /// own cache line, so read throughput grows with the number of threads. Writers are
+  /// serialized, announce themselves and wait for readers to drain; new readers wait for the writer.
+  /// Meets the Lockable and SharedLockable requirements. Stripes are aligned to cache lines,
+  /// before C++17 operator new doesn't keep that alignment, so don't allocate it with new.
+  class SharedMutex
+  {
+  public:
+    SharedMutex();
+
+    SharedMutex(const SharedMutex&) = delete;
+    SharedMutex& operator= (const SharedMutex&) = delete;
+
+    void lock();
+    void unlock();
+    void lock_shared();
+    void unlock_shared();
+
+  private:
+    enum { stripesCount = 32, cacheLine = 64 };
+
+    // every stripe starts its own cache line, neighbours don't share one
+    struct alignas(cacheLine) Stripe
+    {
+      std::atomic<int> readers;
+    };
+    static_assert(sizeof(Stripe) == cacheLine, "A stripe fills exactly one cache line");
+
+    static size_t currentStripe();
+
+    Stripe stripes[stripesCount];
+    std::atomic<bool> writer;
+    std::mutex writers;
+  };
+
+  /// Holds a shared lock for its lifetime, std::shared_lock for C++11
+  template<typename Mutex>
+  class SharedLock
+  {
+  public:
+    explicit SharedLock(Mutex& mutex): mutex(mutex) {mutex.lock_shared();}
+    ~SharedLock() {mutex.unlock_shared();}
+
+    SharedLock(const SharedLock&) = delete;
+    SharedLock& operator= (const SharedLock&) = delete;
+
+  private:
+    Mutex& mutex;
+  };
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  inline SharedMutex::SharedMutex():
+    writer(false)
+  {
+    for(size_t i = 0; i < stripesCount; i++)
+      stripes[i].readers.store(0, std::memory_order_relaxed);
+  }
+
+  inline void SharedMutex::lock()
+  {
+    writers.lock();
+    writer.store(true);
+
+    // the stores above and the loads below are sequentially consistent, as in lock_shared(),
+    // so either the reader sees the writer or the writer sees the reader
+    for(size_t i = 0; i < stripesCount; i++)
+      while(stripes[i].readers.load())
+        std::this_thread::yield();
+  }
+
+  inline void SharedMutex::unlock()
+  {
+    writer.store(false);
+    writers.unlock();
+  }
+
+  inline void SharedMutex::lock_shared()
+  {
+    std::atomic<int>& readers = stripes[currentStripe()].readers;
+    for(;;)
+    {
+      readers.fetch_add(1);
+      if(!writer.load())
+        return;
+
+      // step back and let the writer finish
+      readers.fetch_sub(1);
+      while(writer.load(std::memory_order_relaxed))
+        std::this_thread::yield();
+    }
+  }
+
+  inline void SharedMutex::unlock_shared()
+  {
+    stripes[currentStripe()].readers.fetch_sub(1, std::memory_order_release);
+  }
+
+  inline size_t SharedMutex::currentStripe()
+  {
+    // threads get stripes round robin, a thread keeps its stripe for life
+    static std::atomic<size_t> threadsCount(0);
+    thread_local size_t stripe = threadsCount.fetch_add(1, std::memory_order_relaxed) % stripesCount;
+    return stripe;
+  }
+
+} // end of namespace
+
+#endif // SHAREDMUTEX_H
@@ -0,0 +1,99 @@
+#include "statspanel.h"
+#include "mgstats.h"
+
+#include <QVBoxLayout>
+#include <QPushButton>
+#include <QLabel>
+#include <QHeaderView>
+
+namespace
+{
+  // refresh period of the visible panel, milliseconds
+  const int refreshPeriod = 500;
+
+  QString milliseconds(uint64_t ns)
+  {
+    return QString::number(ns / 1e6, 'f', 3) + " ms";
+  }
+}
+
+StatsPanel::StatsPanel(QWidget *parent):
+  QDockWidget(tr("Statistics"), parent),
+  table(new QTableWidget(this)),
+  timer(new QTimer(this))
+{
+  setObjectName("dockWidget_statistics");
+
+  QWidget *contents = new QWidget(this);
+  QVBoxLayout *layout = new QVBoxLayout(contents);
+  layout->setContentsMargins(2, 2, 2, 2);
+
+  if(!mg::statsEnabled())
+    layout->addWidget(new QLabel(tr("Statistics are compiled out,\nrebuild with qmake CONFIG+=mg_stats"), contents));
+
+  table->setColumnCount(2);
+  table->setHorizontalHeaderLabels(QStringList() << tr("Counter") << tr("Value"));
+  table->setRowCount(mg::STATS_COUNTERS_COUNT + mg::STATS_TIMERS_COUNT);
+  table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  table->verticalHeader()->hide();
+  table->horizontalHeader()->setStretchLastSection(true);
+  layout->addWidget(table);
+
+  QPushButton *resetButton = new QPushButton(tr("Reset"), contents);
+  layout->addWidget(resetButton);
+  setWidget(contents);
+
+  connect(resetButton, SIGNAL(pressed()), this, SLOT(reset()));
+  connect(timer, SIGNAL(timeout()), this, SLOT(refresh()));
+  refresh();
+}
+
+void StatsPanel::refresh()
+{
+  mg::StatsSnapshot snapshot = mg::statsSnapshot();
+
+  int row = 0;
+  for(int i = 0; i < mg::STATS_COUNTERS_COUNT; i++, row++)
+    setRow(row, mg::statsCounterName(static_cast<mg::StatsCounter>(i)),
+           QString::number(snapshot.counters[i]));
+
+  for(int i = 0; i < mg::STATS_TIMERS_COUNT; i++, row++)
+  {
+    const mg::StatsTimerValue& value = snapshot.timers[i];
+    QString text = QString::number(value.calls) + " calls";
+    if(value.calls)
+      text += ", total " + milliseconds(value.totalNs) +
+              ", mean " + milliseconds(value.totalNs / value.calls) +
+              ", max " + milliseconds(value.maxNs);
+    setRow(row, mg::statsTimerName(static_cast<mg::StatsTimer>(i)), text);
+  }
+}
+
+void StatsPanel::reset()
+{
+  mg::resetStats();
+  refresh();
+}
+
+void StatsPanel::showEvent(QShowEvent *event)
+{
+  QDockWidget::showEvent(event);
+  refresh();
+  timer->start(refreshPeriod);
+}
+
+void StatsPanel::hideEvent(QHideEvent *event)
+{
+  timer->stop();
+  QDockWidget::hideEvent(event);
+}
+
+void StatsPanel::setRow(int row, const QString &name, const QString &value)
+{
+  if(!table->item(row, 0))
+  {
+    table->setItem(row, 0, new QTableWidgetItem(name));
+    table->setItem(row, 1, new QTableWidgetItem());
+  }
+  table->item(row, 1)->setText(value);
+}
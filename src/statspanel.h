@@ -0,0 +1,31 @@
+#ifndef STATSPANEL_H
+#define STATSPANEL_H
+
+#include <QDockWidget>
+#include <QTableWidget>
+#include <QTimer>
+
+/// Dockable table of the mgstats counters and timers, refreshed while visible
+class StatsPanel : public QDockWidget
+{
+  Q_OBJECT
+
+public:
+  explicit StatsPanel(QWidget *parent = 0);
+
+public slots:
+  void refresh();
+  void reset();
+
+protected:
+  void showEvent(QShowEvent *event);
+  void hideEvent(QHideEvent *event);
+
+private:
+  void setRow(int row, const QString& name, const QString& value);
+
+  QTableWidget *table;
+  QTimer *timer;
+};
+
+#endif // STATSPANEL_H
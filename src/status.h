@@ -0,0 +1,36 @@
+#ifndef STATUS_H
+#define STATUS_H
+
+namespace mg
+{
+  /// Result of the non-throwing mutations of the multigraph, expected failures
+  /// are reported without building an exception
+  enum Status { MG_OK,
+                MG_VERTEX_ALREADY_EXISTS,
+                MG_VERTEX_NOT_FOUND,
+                MG_SRC_VERTEX_NOT_FOUND,
+                MG_DST_VERTEX_NOT_FOUND,
+                MG_NULL_ENDPOINT,
+                MG_LOOP_EDGE,
+                MG_EDGE_NOT_FOUND };
+
+  /// Static description of @param status, the same text the throwing API uses
+  inline const char* statusText(Status status)
+  {
+    switch(status)
+    {
+      case MG_OK: return "Ok";
+      case MG_VERTEX_ALREADY_EXISTS: return "Vertex already exist!";
+      case MG_VERTEX_NOT_FOUND: return "Vertex doesn't exist!";
+      case MG_SRC_VERTEX_NOT_FOUND: return "Src vertex doesn't exist!";
+      case MG_DST_VERTEX_NOT_FOUND: return "Dst vertex doesn't exist!";
+      case MG_NULL_ENDPOINT: return "Edge endpoint is NULL!";
+      case MG_LOOP_EDGE: return "The multigraph prevents the creation of loops!";
+      case MG_EDGE_NOT_FOUND: return "Edge doesn't exist!";
+    }
+    return "";
+  }
+
+} // end of namespace
+
+#endif // STATUS_H
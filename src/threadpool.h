@@ -0,0 +1,114 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace mg
+{
+  /// Fixed set of worker threads executing submitted tasks in FIFO order
+  class ThreadPool
+  {
+  public:
+    explicit ThreadPool(size_t threadsCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator= (const ThreadPool&) = delete;
+
+    /// Queues @param task, the result (or exception) is delivered through the returned future
+    template<typename F>
+    std::future<typename std::result_of<F()>::type> submit(F task);
+
+    size_t size() const {return workers.size();}
+
+    /// Pool shared by the whole application, sized by the number of cores
+    static ThreadPool& global();
+
+  private:
+    void work();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()> > tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping;
+  };
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  inline ThreadPool::ThreadPool(size_t threadsCount):
+    stopping(false)
+  {
+    if(threadsCount == 0)
+      threadsCount = std::max(1u, std::thread::hardware_concurrency());
+
+    workers.reserve(threadsCount);
+    for(size_t i = 0; i < threadsCount; i++)
+      workers.emplace_back(&ThreadPool::work, this);
+  }
+
+  inline ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    condition.notify_all();
+    for(auto i = workers.begin(); i != workers.end(); ++i)
+      i->join();
+  }
+
+  template<typename F>
+  std::future<typename std::result_of<F()>::type> ThreadPool::submit(F task)
+  {
+    typedef typename std::result_of<F()>::type R;
+
+    // std::function must be copyable, packaged_task is not
+    auto packagedTask = std::make_shared<std::packaged_task<R()> >(std::move(task));
+    std::future<R> result = packagedTask->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.push([packagedTask]() {(*packagedTask)();});
+    }
+    condition.notify_one();
+    return result;
+  }
+
+  inline ThreadPool& ThreadPool::global()
+  {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  inline void ThreadPool::work()
+  {
+    for(;;)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this]() {return stopping || !tasks.empty();});
+        if(stopping && tasks.empty())
+          return;
+        task = std::move(tasks.front());
+        tasks.pop();
+      }
+      task();
+    }
+  }
+
+} // end of namespace
+
+#endif // THREADPOOL_H
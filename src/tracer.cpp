@@ -0,0 +1,124 @@
+#include "tracer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace mg;
+
+namespace
+{
+  // events kept in memory before they are written out
+  const size_t flushSize = 1 << 16;
+
+  // small sequential thread ids read better in trace viewers than native ones
+  unsigned currentThread()
+  {
+    static std::atomic<unsigned> threadsCount(0);
+    thread_local unsigned thread = ++threadsCount;
+    return thread;
+  }
+
+  bool startFromEnvironment(Tracer& tracer)
+  {
+    const char* path = std::getenv("MD_TRACE_FILE");
+    return path && *path && tracer.start(path);
+  }
+
+  void writeEscaped(FILE* file, const char* text)
+  {
+    for(; *text; ++text)
+    {
+      if(*text == '"' || *text == '\\')
+        std::fputc('\\', file);
+      std::fputc(*text, file);
+    }
+  }
+}
+
+Tracer::Tracer():
+  recording(false),
+  file(NULL),
+  firstEvent(true)
+{
+
+}
+
+Tracer::~Tracer()
+{
+  stop();
+}
+
+bool Tracer::start(const std::string &path)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if(file)
+    return true;
+
+  file = std::fopen(path.c_str(), "wb");
+  if(!file)
+    return false;
+
+  this->path = path;
+  firstEvent = true;
+  std::fputs("[\n", file);
+  recording.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+void Tracer::stop()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  recording.store(false, std::memory_order_relaxed);
+  if(!file)
+    return;
+
+  flush();
+  std::fputs("\n]\n", file);
+  std::fclose(file);
+  file = NULL;
+}
+
+void Tracer::addEvent(const char *name, uint64_t beginUs, uint64_t durationUs)
+{
+  Event event = {name, beginUs, durationUs, currentThread()};
+
+  std::lock_guard<std::mutex> lock(mutex);
+  // a scope may end after the recording stopped
+  if(!file)
+    return;
+
+  events.push_back(event);
+  if(events.size() >= flushSize)
+    flush();
+}
+
+uint64_t Tracer::now()
+{
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                 std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+Tracer &Tracer::global()
+{
+  static Tracer tracer;
+  // initialization of local statics is thread safe, the variable is checked once
+  static const bool started = startFromEnvironment(tracer);
+  (void)started;
+  return tracer;
+}
+
+void Tracer::flush()
+{
+  for(auto i = events.begin(); i != events.end(); ++i)
+  {
+    std::fputs(firstEvent ? "" : ",\n", file);
+    firstEvent = false;
+    std::fputs("{\"name\":\"", file);
+    writeEscaped(file, i->name);
+    std::fprintf(file, "\",\"cat\":\"md\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":%u}",
+                 static_cast<unsigned long long>(i->begin),
+                 static_cast<unsigned long long>(i->duration), i->thread);
+  }
+  events.clear();
+}
@@ -0,0 +1,83 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+#define MD_TRACE_CONCAT2(a, b) a##b
+#define MD_TRACE_CONCAT(a, b) MD_TRACE_CONCAT2(a, b)
+/// Records the rest of the enclosing scope as one event, @param name has to be a string literal
+#define MD_TRACE_SCOPE(name) mg::TraceScope MD_TRACE_CONCAT(mdTraceScope, __LINE__)(name)
+
+namespace mg
+{
+  /// Collects complete ("ph":"X") events of the Chrome trace-event format and writes them
+  /// as a JSON array, the file opens in chrome://tracing and Perfetto.
+  /// While stopped a trace scope costs one relaxed atomic load.
+  class Tracer
+  {
+  public:
+    Tracer();
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator= (const Tracer&) = delete;
+
+    /// Starts recording, events go to @param path when stopped. Returns false if the file can't be opened
+    bool start(const std::string& path);
+    /// Writes the recorded events and closes the file
+    void stop();
+    bool isRecording() const {return recording.load(std::memory_order_relaxed);}
+
+    void addEvent(const char* name, uint64_t beginUs, uint64_t durationUs);
+
+    /// Microseconds of a monotonic clock
+    static uint64_t now();
+
+    /// Tracer of the application, started by the MD_TRACE_FILE environment variable
+    static Tracer& global();
+
+  private:
+    struct Event
+    {
+      const char* name;
+      uint64_t begin;
+      uint64_t duration;
+      unsigned thread;
+    };
+
+    void flush();
+
+    std::atomic<bool> recording;
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::string path;
+    FILE* file;
+    bool firstEvent;
+  };
+
+  class TraceScope
+  {
+  public:
+    explicit TraceScope(const char* name):
+      name(Tracer::global().isRecording() ? name : NULL),
+      begin(this->name ? Tracer::now() : 0) {}
+
+    ~TraceScope()
+    {
+      if(name)
+        Tracer::global().addEvent(name, begin, Tracer::now() - begin);
+    }
+
+  private:
+    const char* name;
+    uint64_t begin;
+  };
+
+} // end of namespace
+
+#endif // TRACER_H
@@ -0,0 +1,365 @@
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include "multigraph.h"
+#include "mutation.h"
+
+#include <deque>
+#include <vector>
+#include <string>
+
+namespace mg
+{
+  /// Undo and redo for a Multigraph. Attached as its mutation listener, it records every
+  /// primitive mutation; undo applies their inverses in reverse order, redo applies them again,
+  /// both cost O(size of the change). Mutations between beginStep() and endStep() form one step,
+  /// others are a step each. Memory is bounded: the oldest steps are forgotten once there are
+  /// more than maxSteps steps or maxMutations mutations, a step bigger than that can't be undone.
+  template<typename V, typename E>
+  class UndoHistory : public MutationListener<V, E>
+  {
+  public:
+    explicit UndoHistory(Multigraph<V, E>& graph, size_t maxSteps = 100, size_t maxMutations = 1 << 20);
+    /// Detaches from the graph
+    ~UndoHistory();
+
+    UndoHistory(const UndoHistory&) = delete;
+    UndoHistory& operator= (const UndoHistory&) = delete;
+
+    /// Steps may be nested, the outermost one is recorded
+    void beginStep(const std::string& name);
+    void endStep();
+
+    bool canUndo() const {return !undoSteps.empty();}
+    bool canRedo() const {return !redoSteps.empty();}
+    /// Name of the step undo() or redo() would revert or repeat
+    const std::string& getUndoName() const;
+    const std::string& getRedoName() const;
+
+    void undo();
+    void redo();
+    void clear();
+
+    /// Mutations kept for undo and redo
+    size_t getMutationsCount() const {return mutationsCount;}
+
+    /// Mutations made while not recording aren't kept, e.g. loading of a new document
+    void setRecording(bool recording) {this->recording = recording;}
+    bool isRecording() const {return recording;}
+
+    void mutated(const Mutation<V, E>& mutation) override;
+    void beginCompound() override {if(!replaying && recording) beginStep(std::string());}
+    void endCompound() override {if(!replaying && recording) endStep();}
+
+  private:
+    struct Step
+    {
+      Step(const std::string& name): name(name), overflowed(false) {}
+
+      std::string name;
+      std::vector<Mutation<V, E> > mutations;
+      /// Outgrew the history, dropped when finished
+      bool overflowed;
+    };
+
+    void apply(const Mutation<V, E>& mutation);
+    void dropRedo();
+    void finishStep();
+    void trim();
+
+    Multigraph<V, E>& graph;
+    size_t maxSteps;
+    size_t maxMutations;
+
+    std::deque<Step> undoSteps;
+    std::vector<Step> redoSteps;
+    size_t mutationsCount;
+    int depth;
+    bool replaying;
+    bool recording;
+  };
+
+  /// Begins a step for the lifetime of the object
+  template<typename V, typename E>
+  class UndoStep
+  {
+  public:
+    UndoStep(UndoHistory<V, E>& history, const std::string& name): history(history) {history.beginStep(name);}
+    ~UndoStep() {history.endStep();}
+
+    UndoStep(const UndoStep&) = delete;
+    UndoStep& operator= (const UndoStep&) = delete;
+
+  private:
+    UndoHistory<V, E>& history;
+  };
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename V, typename E>
+  UndoHistory<V, E>::UndoHistory(Multigraph<V, E> &graph, size_t maxSteps, size_t maxMutations):
+    graph(graph), maxSteps(maxSteps), maxMutations(maxMutations), mutationsCount(0), depth(0), replaying(false),
+    recording(true)
+  {
+    graph.setMutationListener(this);
+  }
+
+  template<typename V, typename E>
+  UndoHistory<V, E>::~UndoHistory()
+  {
+    if(graph.getMutationListener() == this)
+      graph.setMutationListener(NULL);
+  }
+
+  template<typename V, typename E>
+  void UndoHistory<V, E>::beginStep(const std::string &name)
+  {
+    if(depth++ > 0)
+      return;
+
+    undoSteps.push_back(Step(name));
+  }
+
+  template<typename V, typename E>
+  void UndoHistory<V, E>::endStep()
+  {
+    if(depth == 0)
+    {
+      THROW_MG_EXCEPTION("endStep() without beginStep()!");
+      return;
+    }
+    if(--depth == 0)
+      finishStep();
+  }
+
+  template<typename V, typename E>
+  const std::string& UndoHistory<V, E>::getUndoName() const
+  {
+    static const std::string none;
+    return undoSteps.empty() ? none : undoSteps.back().name;
+  }
+
+  template<typename V, typename E>
+  const std::string& UndoHistory<V, E>::getRedoName() const
+  {
+    static const std::string none;
+    return redoSteps.empty() ? none : redoSteps.back().name;
+  }
+
+  template<typename V, typename E>
+  void UndoHistory<V, E>::undo()
+  {
+    if(depth > 0)
+    {
+      THROW_MG_EXCEPTION("Can't undo inside of a step!");
+      return;
+    }
+    if(undoSteps.empty())
+      return;
+
+    Step& step = undoSteps.back();
+    replaying = true;
+    try
+    {
+      for(auto i = step.mutations.rbegin(); i != step.mutations.rend(); ++i)
+        apply(i->inverse());
+    }
+    catch(...)
+    {
+      replaying = false;
+      throw;
+    }
+    replaying = false;
+
+    redoSteps.push_back(std::move(step));
+    undoSteps.pop_back();
+  }
+
+  template<typename V, typename E>
+  void UndoHistory<V, E>::redo()
+  {
+    if(depth > 0)
+    {
+      THROW_MG_EXCEPTION("Can't redo inside of a step!");
+      return;
+    }
+    if(redoSteps.empty())
+      return;
+
+    Step& step = redoSteps.back();
+    replaying = true;
+    try
+    {
+      for(auto i = step.mutations.begin(); i != step.mutations.end(); ++i)
+        apply(*i);
+    }
+    catch(...)
+    {
+      replaying = false;
+      throw;
+    }
+    replaying = false;
+
+    undoSteps.push_back(std::move(step));
+    redoSteps.pop_back();
+  }
+
+  template<typename V, typename E>
+  void UndoHistory<V, E>::clear()
+  {
+    undoSteps.clear();
+    redoSteps.clear();
+    mutationsCount = 0;
+    if(depth > 0)
+      undoSteps.push_back(Step(std::string()));
+  }
+
+  template<typename V, typename E>
+  void UndoHistory<V, E>::mutated(const Mutation<V, E> &mutation)
+  {
+    if(replaying || !recording)
+      return;
+
+    bool single = depth == 0;
+    if(single)
+      undoSteps.push_back(Step(std::string()));
+
+    // the first change of a step makes the undone steps unreachable, empty steps keep them
+    Step& step = undoSteps.back();
+    if(step.mutations.empty() && !step.overflowed)
+      dropRedo();
+    if(!step.overflowed)
+    {
+      step.mutations.push_back(mutation);
+      mutationsCount++;
+      if(step.mutations.size() > maxMutations)
+      {
+        // keeping it would exceed the limit alone, release the memory right away
+        mutationsCount -= step.mutations.size();
+        std::vector<Mutation<V, E> >().swap(step.mutations);
+        step.overflowed = true;
+      }
+    }
+
+    if(single)
+      finishStep();
+  }
+
+  template<typename V, typename E>
+  void UndoHistory<V, E>::apply(const Mutation<V, E> &mutation)
+  {
+    switch(mutation.type)
+    {
+      case MUTATION_ADD_VERTEX:
+        graph.addVertex(mutation.source);
+        break;
+
+      case MUTATION_DELETE_VERTEX:
+        graph.deleteVertex(mutation.source);
+        break;
+
+      case MUTATION_ADD_EDGE:
+        graph.addEdge(mutation.source, mutation.destination, mutation.value);
+        break;
+
+      case MUTATION_DELETE_EDGE:
+        graph.deleteEdge(mutation.source, mutation.destination, mutation.value);
+        break;
+
+      case MUTATION_SET_EDGE_VALUE:
+      {
+        // any parallel edge with the old value is equivalent
+        Vertex<V, E>* source = graph.findVertex(mutation.source);
+        Edge<V, E>* edge = NULL;
+        if(source)
+        {
+          const auto& outgoingEdges = source->getOutgoingEdges();
+          auto edgePos = std::find_if(outgoingEdges.begin(), outgoingEdges.end(), [&mutation](Edge<V, E>* i)
+          {
+            return i->getDestination()->getData() == mutation.destination && i->getValue() == mutation.oldValue;
+          });
+          if(edgePos != outgoingEdges.end())
+            edge = *edgePos;
+        }
+        if(!edge)
+        {
+          THROW_MG_EDGE_EXISTING_EXCEPTION("Edge to change wasn't found!", NULL, V, E);
+          return;
+        }
+        graph.setEdgeValue(edge, mutation.value);
+        break;
+      }
+
+      case MUTATION_ADD_GROUP_EXPENSE:
+        graph.addGroupExpense(mutation.source, mutation.value, mutation.participants, mutation.rule, mutation.shares);
+        break;
+
+      case MUTATION_DELETE_GROUP_EXPENSE:
+      {
+        const auto& groupExpenses = graph.getGroupExpenses();
+        auto expensePos = std::find_if(groupExpenses.begin(), groupExpenses.end(), [&mutation](const GroupExpense<V, E>& i)
+        {
+          if(i.getPayer()->getData() != mutation.source || i.getTotal() != mutation.value
+             || i.getRule() != mutation.rule || i.getShares() != mutation.shares
+             || i.getParticipants().size() != mutation.participants.size())
+            return false;
+          for(size_t j = 0; j < mutation.participants.size(); j++)
+            if(i.getParticipants()[j]->getData() != mutation.participants[j])
+              return false;
+          return true;
+        });
+        if(expensePos == groupExpenses.end())
+        {
+          THROW_MG_EXCEPTION("Group expense to delete wasn't found!");
+          return;
+        }
+        graph.deleteGroupExpense(&*expensePos);
+        break;
+      }
+    }
+  }
+
+  template<typename V, typename E>
+  void UndoHistory<V, E>::dropRedo()
+  {
+    for(auto i = redoSteps.begin(); i != redoSteps.end(); ++i)
+      mutationsCount -= i->mutations.size();
+    redoSteps.clear();
+  }
+
+  template<typename V, typename E>
+  void UndoHistory<V, E>::finishStep()
+  {
+    Step& step = undoSteps.back();
+    if(step.overflowed)
+    {
+      // earlier steps can't be reached without undoing this one
+      undoSteps.clear();
+      mutationsCount = 0;
+      return;
+    }
+    if(step.mutations.empty())
+    {
+      undoSteps.pop_back();
+      return;
+    }
+    trim();
+  }
+
+  template<typename V, typename E>
+  void UndoHistory<V, E>::trim()
+  {
+    while(undoSteps.size() > 1 && (undoSteps.size() > maxSteps || mutationsCount > maxMutations))
+    {
+      mutationsCount -= undoSteps.front().mutations.size();
+      undoSteps.pop_front();
+    }
+  }
+
+} // end of namespace
+
+#endif // UNDOHISTORY_H
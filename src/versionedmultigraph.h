@@ -0,0 +1,501 @@
+#ifndef VERSIONEDMULTIGRAPH_H
+#define VERSIONEDMULTIGRAPH_H
+
+#include "multigraph.h"
+#include "persistentvector.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+namespace mg
+{
+  template<typename V, typename E>
+  class VersionedMultigraph;
+
+  template<typename V>
+  struct SnapshotVertex
+  {
+    V data;
+    bool alive;
+  };
+
+  template<typename E>
+  struct SnapshotEdge
+  {
+    size_t source;
+    size_t destination;
+    E value;
+    bool alive;
+  };
+
+  /// Group expense with participants referred to by vertex slots
+  template<typename E>
+  struct SnapshotExpense
+  {
+    size_t payer;
+    E total;
+    SplitRule rule;
+    std::vector<size_t> participants;
+    std::vector<E> shares;
+    bool alive;
+  };
+
+  /// Immutable state of a VersionedMultigraph. Copies are O(1) and share storage with the
+  /// graph and with each other; the storage of a version is freed with its last snapshot.
+  /// Safe to read from any thread while the graph keeps changing.
+  template<typename V, typename E>
+  class GraphSnapshot
+  {
+  public:
+    GraphSnapshot(): version(0), contentHash(0), vertexesCount(0), edgesCount(0), expensesCount(0) {}
+
+    /// Number of mutations made before the snapshot was taken
+    uint64_t getVersion() const {return version;}
+    /// Same as Multigraph::getContentHash() at the time of the snapshot
+    uint64_t getContentHash() const {return contentHash;}
+    size_t getVertexesCount() const {return vertexesCount;}
+    size_t getEdgesCount() const {return edgesCount;}
+    size_t getGroupExpensesCount() const {return expensesCount;}
+
+    /// Calls @param f(data) for every vertex in order of addition
+    template<typename F>
+    void forEachVertex(F f) const;
+
+    /// Calls @param f(creditor, debtor, value) for every edge in order of addition
+    template<typename F>
+    void forEachEdge(F f) const;
+
+    /// Calls @param f(expense) for every group expense in order of addition,
+    /// payer and participants are vertex slots, see getVertex()
+    template<typename F>
+    void forEachGroupExpense(F f) const;
+    /// Data of the vertex in @param slot
+    const V& getVertex(size_t slot) const {return vertexes[slot].data;}
+
+    /// Fills empty @param graph with the snapshot contents
+    void restore(Multigraph<V, E>& graph) const;
+
+    /// Same format as Multigraph, edges are written in order of addition
+    template <typename V2, typename E2>
+    friend std::ostream& operator<< (std::ostream& os, const GraphSnapshot<V2, E2>& dt);
+
+  private:
+    friend class VersionedMultigraph<V, E>;
+
+    uint64_t version;
+    uint64_t contentHash;
+    size_t vertexesCount;
+    size_t edgesCount;
+    size_t expensesCount;
+    // slots of removed elements stay as tombstones until compaction
+    PersistentVector<SnapshotVertex<V> > vertexes;
+    PersistentVector<SnapshotEdge<E> > edges;
+    PersistentVector<SnapshotExpense<E> > expenses;
+  };
+
+  /// Multigraph which gives out snapshots: snapshot() costs O(1) whatever the graph size,
+  /// a mutation copies only the storage nodes it touches, and only while an older snapshot
+  /// still shares them. Mutations and snapshot() may be called from any thread,
+  /// getGraph() only from the thread making changes.
+  template<typename V, typename E>
+  class VersionedMultigraph
+  {
+  public:
+    typedef Multigraph<V, E> Graph;
+
+    VersionedMultigraph() {}
+
+    VersionedMultigraph(const VersionedMultigraph&) = delete;
+    VersionedMultigraph& operator= (const VersionedMultigraph&) = delete;
+
+    // mutation, same semantics as Multigraph
+    void addVertex(const V& value);
+    void addEdge(const V& src, const V& dst, const E& value);
+    Status tryAddVertex(const V& value);
+    Status tryAddEdge(const V& src, const V& dst, const E& value);
+    Status tryDeleteEdge(const V& src, const V& dst, const E& value);
+    void deleteVertex(const V& value);
+    void deleteEdge(const V& src, const V& dst, const E& value);
+    void addGroupExpense(const V& payer, const E& total, const std::vector<V>& participants,
+                         SplitRule rule = SPLIT_EQUAL, const std::vector<E>& shares = std::vector<E>());
+    void clear();
+
+    GraphSnapshot<V, E> snapshot() const;
+
+    /// The live graph, for the thread making changes
+    const Graph& getGraph() const {return graph;}
+
+  private:
+    void recordVertex(const Vertex<V, E>* vertex);
+    void recordEdge(const Edge<V, E>* edge);
+    void eraseEdge(const Edge<V, E>* edge);
+    /// Writes @param expense into its slot, a new one gets the next slot
+    void recordExpense(const GroupExpense<V, E>* expense);
+    void eraseExpense(const GroupExpense<V, E>* expense);
+    /// Bumps the version, drops tombstones once they outnumber live slots
+    void commit();
+    void rebuild();
+
+    mutable std::mutex mutex;
+    Graph graph;
+    GraphSnapshot<V, E> current;
+    std::unordered_map<const Vertex<V, E>*, size_t> vertexSlots;
+    std::unordered_map<const Edge<V, E>*, size_t> edgeSlots;
+    std::unordered_map<const GroupExpense<V, E>*, size_t> expenseSlots;
+  };
+
+
+  // ********************************************************************************************
+  // *********************************** implementation *****************************************
+  // ********************************************************************************************
+
+
+  template<typename V, typename E>
+  template<typename F>
+  void GraphSnapshot<V, E>::forEachVertex(F f) const
+  {
+    vertexes.forEach([&f](const SnapshotVertex<V>& i)
+    {
+      if(i.alive)
+        f(i.data);
+    });
+  }
+
+  template<typename V, typename E>
+  template<typename F>
+  void GraphSnapshot<V, E>::forEachEdge(F f) const
+  {
+    const PersistentVector<SnapshotVertex<V> >& vertexSlots = vertexes;
+    edges.forEach([&f, &vertexSlots](const SnapshotEdge<E>& i)
+    {
+      if(i.alive)
+        f(vertexSlots[i.source].data, vertexSlots[i.destination].data, i.value);
+    });
+  }
+
+  template<typename V, typename E>
+  template<typename F>
+  void GraphSnapshot<V, E>::forEachGroupExpense(F f) const
+  {
+    expenses.forEach([&f](const SnapshotExpense<E>& i)
+    {
+      if(i.alive)
+        f(i);
+    });
+  }
+
+  template<typename V, typename E>
+  void GraphSnapshot<V, E>::restore(Multigraph<V, E> &graph) const
+  {
+    forEachVertex([&graph](const V& data) {graph.addVertex(data);});
+    forEachEdge([&graph](const V& src, const V& dst, const E& value) {graph.addEdge(src, dst, value);});
+
+    forEachGroupExpense([this, &graph](const SnapshotExpense<E>& i)
+    {
+      std::vector<V> participants;
+      for(auto j = i.participants.begin(); j != i.participants.end(); ++j)
+        participants.push_back(getVertex(*j));
+      graph.addGroupExpense(getVertex(i.payer), i.total, participants, i.rule, i.shares);
+    });
+  }
+
+  template<typename V, typename E>
+  std::ostream& operator<< (std::ostream& os, const GraphSnapshot<V, E>& dt)
+  {
+    os << dt.vertexesCount << "\n";
+    dt.forEachVertex([&os](const V& data) {os << data << "\n";});
+
+    os << dt.edgesCount << "\n";
+    dt.forEachEdge([&os](const V& src, const V& dst, const E& value)
+    {
+      os << src << "\n" << dst << "\n" << value << "\n";
+    });
+
+    if(dt.expensesCount)
+    {
+      os << dt.expensesCount << "\n";
+      dt.forEachGroupExpense([&os, &dt](const SnapshotExpense<E>& i)
+      {
+        os << dt.getVertex(i.payer) << "\n"
+           << splitRuleName(i.rule) << "\n"
+           << i.total << "\n"
+           << i.participants.size() << "\n";
+        for(size_t j = 0; j < i.participants.size(); j++)
+        {
+          os << dt.getVertex(i.participants[j]) << "\n";
+          if(i.rule != SPLIT_EQUAL)
+            os << i.shares[j] << "\n";
+        }
+      });
+    }
+    return os;
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::addVertex(const V &value)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    graph.addVertex(value);
+    recordVertex(graph.getVertexes().back());
+    commit();
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::addEdge(const V &src, const V &dst, const E &value)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    graph.addEdge(src, dst, value);
+    recordEdge(graph.findVertex(src)->getOutgoingEdges().back());
+    commit();
+  }
+
+  template<typename V, typename E>
+  Status VersionedMultigraph<V, E>::tryAddVertex(const V &value)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Vertex<V, E>* added = NULL;
+    Status status = graph.tryAddVertex(value, &added);
+    if(status != MG_OK)
+      return status;
+
+    recordVertex(added);
+    commit();
+    return MG_OK;
+  }
+
+  template<typename V, typename E>
+  Status VersionedMultigraph<V, E>::tryAddEdge(const V &src, const V &dst, const E &value)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Edge<V, E>* added = NULL;
+    Status status = graph.tryAddEdge(src, dst, value, &added);
+    if(status != MG_OK)
+      return status;
+
+    recordEdge(added);
+    commit();
+    return MG_OK;
+  }
+
+  template<typename V, typename E>
+  Status VersionedMultigraph<V, E>::tryDeleteEdge(const V &src, const V &dst, const E &value)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Vertex<V, E>* srcPointer = graph.findVertex(src);
+    if(!srcPointer)
+      return MG_SRC_VERTEX_NOT_FOUND;
+
+    // the same edge Multigraph::tryDeleteEdge() would pick
+    const auto& outgoingEdges = srcPointer->getOutgoingEdges();
+    auto edgePos = std::find_if(outgoingEdges.begin(), outgoingEdges.end(),
+                               [&dst, &value](Edge<V, E>* i)
+    {
+      return (i->getDestination()->getData() == dst)
+          && (i->getValue() == value);
+    });
+
+    if(edgePos == outgoingEdges.end())
+      return MG_EDGE_NOT_FOUND;
+
+    eraseEdge(*edgePos);
+    graph.deleteEdge(*edgePos);
+    commit();
+    return MG_OK;
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::deleteVertex(const V &value)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Vertex<V, E>* vertexPointer = graph.findVertex(value);
+    if(!vertexPointer)
+    {
+      THROW_MG_VERTEX_EXISTING_EXCEPTION("Vertex doesn't exist!", NULL, value, V, E);
+      return;
+    }
+
+    const auto& incomingEdges = vertexPointer->getIncomingEdges();
+    for(auto i = incomingEdges.begin(); i != incomingEdges.end(); ++i)
+      eraseEdge(*i);
+    const auto& outgoingEdges = vertexPointer->getOutgoingEdges();
+    for(auto i = outgoingEdges.begin(); i != outgoingEdges.end(); ++i)
+      eraseEdge(*i);
+
+    // records the vertex paid or one left without parts are dropped by the graph, the others
+    // lose the participant; only these are written, while the vertex still has its slot
+    std::vector<const GroupExpense<V, E>*> changedExpenses;
+    const auto& groupExpenses = graph.getGroupExpenses();
+    for(auto i = groupExpenses.begin(); i != groupExpenses.end(); ++i)
+    {
+      const auto& participants = i->getParticipants();
+      if(i->getPayer() == vertexPointer)
+      {
+        eraseExpense(&*i);
+        continue;
+      }
+      if(std::find(participants.begin(), participants.end(), vertexPointer) == participants.end())
+        continue;
+
+      GroupExpense<V, E> remaining(*i);
+      remaining.removeParticipant(vertexPointer);
+      if(remaining.hasParts())
+        changedExpenses.push_back(&*i);
+      else
+        eraseExpense(&*i);
+    }
+
+    auto slot = vertexSlots.find(vertexPointer);
+    SnapshotVertex<V> tombstone = current.vertexes[slot->second];
+    tombstone.alive = false;
+    current.vertexes.set(slot->second, tombstone);
+    current.vertexesCount--;
+    vertexSlots.erase(slot);
+
+    graph.deleteVertex(value);
+    for(auto i = changedExpenses.begin(); i != changedExpenses.end(); ++i)
+      recordExpense(*i);
+    commit();
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::deleteEdge(const V &src, const V &dst, const E &value)
+  {
+    Status status = tryDeleteEdge(src, dst, value);
+    if(status == MG_SRC_VERTEX_NOT_FOUND)
+      THROW_MG_VERTEX_EXISTING_EXCEPTION(statusText(status), NULL, src, V, E);
+    else if(status != MG_OK)
+      THROW_MG_EDGE_EXISTING_EXCEPTION(statusText(status), NULL, V, E);
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::addGroupExpense(const V &payer, const E &total, const std::vector<V> &participants,
+                                                  SplitRule rule, const std::vector<E> &shares)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    recordExpense(graph.addGroupExpense(payer, total, participants, rule, shares));
+    commit();
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::clear()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    graph.clear();
+    rebuild();
+    commit();
+  }
+
+  template<typename V, typename E>
+  GraphSnapshot<V, E> VersionedMultigraph<V, E>::snapshot() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return current;
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::recordVertex(const Vertex<V, E> *vertex)
+  {
+    vertexSlots[vertex] = current.vertexes.size();
+    SnapshotVertex<V> slot = {vertex->getData(), true};
+    current.vertexes.pushBack(slot);
+    current.vertexesCount++;
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::recordEdge(const Edge<V, E> *edge)
+  {
+    edgeSlots[edge] = current.edges.size();
+    SnapshotEdge<E> slot = {vertexSlots[edge->getSource()], vertexSlots[edge->getDestination()], edge->getValue(), true};
+    current.edges.pushBack(slot);
+    current.edgesCount++;
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::eraseEdge(const Edge<V, E> *edge)
+  {
+    auto slot = edgeSlots.find(edge);
+    SnapshotEdge<E> tombstone = current.edges[slot->second];
+    tombstone.alive = false;
+    current.edges.set(slot->second, tombstone);
+    current.edgesCount--;
+    edgeSlots.erase(slot);
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::recordExpense(const GroupExpense<V, E> *expense)
+  {
+    SnapshotExpense<E> record = {vertexSlots[expense->getPayer()], expense->getTotal(), expense->getRule(),
+                                 std::vector<size_t>(), expense->getShares(), true};
+    const auto& participants = expense->getParticipants();
+    record.participants.reserve(participants.size());
+    for(auto i = participants.begin(); i != participants.end(); ++i)
+      record.participants.push_back(vertexSlots[*i]);
+
+    auto slot = expenseSlots.find(expense);
+    if(slot != expenseSlots.end())
+    {
+      current.expenses.set(slot->second, record);
+      return;
+    }
+    expenseSlots[expense] = current.expenses.size();
+    current.expenses.pushBack(record);
+    current.expensesCount++;
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::eraseExpense(const GroupExpense<V, E> *expense)
+  {
+    auto slot = expenseSlots.find(expense);
+    SnapshotExpense<E> tombstone = current.expenses[slot->second];
+    tombstone.alive = false;
+    current.expenses.set(slot->second, tombstone);
+    current.expensesCount--;
+    expenseSlots.erase(slot);
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::commit()
+  {
+    const size_t slack = 1024;
+    if(current.vertexes.size() > 2 * current.vertexesCount + slack
+       || current.edges.size() > 2 * current.edgesCount + slack
+       || current.expenses.size() > 2 * current.expensesCount + slack)
+      rebuild();
+
+    current.version++;
+    current.contentHash = graph.getContentHash();
+  }
+
+  template<typename V, typename E>
+  void VersionedMultigraph<V, E>::rebuild()
+  {
+    // fresh storage, older snapshots keep theirs
+    current.vertexes.clear();
+    current.edges.clear();
+    current.expenses.clear();
+    current.vertexesCount = 0;
+    current.edgesCount = 0;
+    current.expensesCount = 0;
+    vertexSlots.clear();
+    edgeSlots.clear();
+    expenseSlots.clear();
+
+    const auto& vertexes = graph.getVertexes();
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+      recordVertex(*i);
+    for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+    {
+      const auto& outgoingEdges = (*i)->getOutgoingEdges();
+      for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+        recordEdge(*j);
+    }
+    const auto& groupExpenses = graph.getGroupExpenses();
+    for(auto i = groupExpenses.begin(); i != groupExpenses.end(); ++i)
+      recordExpense(&*i);
+  }
+
+} // end of namespace
+
+#endif // VERSIONEDMULTIGRAPH_H
@@ -2,6 +2,7 @@
 #define VERTEX_H
 
 #include "mgexception.h"
+#include "mgstats.h"
 #include <list>
 #include <algorithm>
 
@@ -14,14 +15,14 @@ template<typename V, typename E>
 class Vertex
 {
 public:
-  Vertex(V& dt);
+  Vertex(const V& dt);
   virtual ~Vertex();
 
-  V getData() const;
+  const V& getData() const;
   void setData(const V &value);
 
-  std::list<Edge<V, E>* > getIncomingEdges() const;
-  std::list<Edge<V, E>* > getOutgoingEdges() const;
+  const std::list<Edge<V, E>* >& getIncomingEdges() const;
+  const std::list<Edge<V, E>* >& getOutgoingEdges() const;
 
   void addIncomingEdge(Edge<V, E> *edge);
   void delIncomingEdge(Edge<V, E> *edge);
@@ -41,7 +42,7 @@ private:
 
 
 template<typename V, typename E> inline
-Vertex<V, E>::Vertex(V& dt)
+Vertex<V, E>::Vertex(const V& dt)
 {
   data = dt;
 }
@@ -55,7 +56,7 @@ Vertex<V, E>::~Vertex()
 }
 
 template<typename V, typename E> inline
-V Vertex<V, E>::getData() const
+const V& Vertex<V, E>::getData() const
 {
   return data;
 }
@@ -67,13 +68,13 @@ void Vertex<V, E>::setData(const V &value)
 }
 
 template<typename V, typename E> inline
-std::list<Edge<V, E> *> Vertex<V, E>::getIncomingEdges() const
+const std::list<Edge<V, E> *>& Vertex<V, E>::getIncomingEdges() const
 {
   return incomingEdges;
 }
 
 template<typename V, typename E> inline
-std::list<Edge<V, E> *> Vertex<V, E>::getOutgoingEdges() const
+const std::list<Edge<V, E> *>& Vertex<V, E>::getOutgoingEdges() const
 {
   return outgoingEdges;
 }
@@ -93,6 +94,8 @@ template<typename V, typename E>
 void Vertex<V, E>::delIncomingEdge(Edge<V, E> *edge)
 {
   auto pos = std::find(incomingEdges.begin(), incomingEdges.end(), edge);
+  MG_STATS_COUNT(STATS_ADJACENCY_SCANS);
+  MG_STATS_ADD(STATS_ADJACENCY_SCAN_STEPS, std::distance(incomingEdges.begin(), pos));
 
   if(pos == incomingEdges.end())
   {
@@ -118,6 +121,8 @@ template<typename V, typename E> inline
 void Vertex<V, E>::delOutgoingEdge(Edge<V, E> *edge)
 {
   auto pos = std::find(outgoingEdges.begin(), outgoingEdges.end(), edge);
+  MG_STATS_COUNT(STATS_ADJACENCY_SCANS);
+  MG_STATS_ADD(STATS_ADJACENCY_SCAN_STEPS, std::distance(outgoingEdges.begin(), pos));
 
   if(pos == outgoingEdges.end())
   {
@@ -3,6 +3,9 @@
 
 #include <QGraphicsView>
 #include <QWheelEvent>
+#include <QPaintEvent>
+
+#include "tracer.h"
 
 class WheelEvent_forQSceneView:public QGraphicsView
 {
@@ -26,6 +29,12 @@ public:
         scale(1.0 / scaleFactor, 1.0 / scaleFactor);
       }
     }
+
+    void paintEvent(QPaintEvent *event)
+    {
+      MD_TRACE_SCOPE("paint");
+      QGraphicsView::paintEvent(event);
+    }
 };
 
 #endif // WHEELEVENT_FORQSCENEVIEW_H
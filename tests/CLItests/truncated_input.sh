@@ -0,0 +1,30 @@
+#!/bin/sh
+# Loads a complete and a truncated .mg file with multidiner-cli.
+# Usage: truncated_input.sh path/to/multidiner-cli
+set -e
+CLI=${1:?usage: truncated_input.sh path/to/multidiner-cli}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+# 15 persons, 60 edges in a ring
+{
+  echo 15
+  i=0; while [ $i -lt 15 ]; do echo "p$i"; i=$((i + 1)); done
+  echo 60
+  i=0; while [ $i -lt 60 ]; do echo "p$((i % 15))"; echo "p$(((i + 1) % 15))"; echo "$((i + 1)).5"; i=$((i + 1)); done
+} > "$DIR/complete.mg"
+
+# cut after seven and a half edges: the eighth has no amount, it must not be added with a stale one
+head -n $((1 + 15 + 1 + 7 * 3 + 2)) "$DIR/complete.mg" > "$DIR/truncated.mg"
+
+"$CLI" -o "$DIR" "$DIR/complete.mg" > "$DIR/complete.out" 2>&1 || { cat "$DIR/complete.out"; echo "FAIL complete file rejected"; exit 1; }
+grep -q "ok, 15 persons, 60 -> 60 edges" "$DIR/complete.out" || { cat "$DIR/complete.out"; echo "FAIL complete file"; exit 1; }
+
+if "$CLI" -o "$DIR" "$DIR/truncated.mg" > "$DIR/truncated.out" 2>&1; then
+  cat "$DIR/truncated.out"
+  echo "FAIL truncated file accepted"
+  exit 1
+fi
+grep -q "Malformed file" "$DIR/truncated.out" || { cat "$DIR/truncated.out"; echo "FAIL truncated file"; exit 1; }
+
+echo "PASS truncated_input"
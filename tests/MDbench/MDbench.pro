@@ -0,0 +1,62 @@
+#-------------------------------------------------
+#
+# Benchmarks of the multigraph core
+#
+# Results in machine readable form:
+#   tst_mdbench -csv -o results.csv,csv
+#   tst_mdbench -o results.xml,xml
+#
+#-------------------------------------------------
+
+QT       += testlib
+
+QT       -= gui
+
+TARGET = tst_mdbench
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+
+SOURCES += tst_mdbench.cpp \
+    ../../src/generator.cpp \
+    ../../src/money.cpp \
+    ../../src/currency.cpp \
+    ../../src/mgexception.cpp
+
+HEADERS += \
+    ../../src/edge.h \
+    ../../src/mgexception.h \
+    ../../src/mgstats.h \
+    ../../src/status.h \
+    ../../src/multigraph.h \
+    ../../src/dotwriter.h \
+    ../../src/threadpool.h \
+    ../../src/groupexpense.h \
+    ../../src/money.h \
+    ../../src/currency.h \
+    ../../src/multicurrency.h \
+    ../../src/mutation.h \
+    ../../src/reduction.h \
+    ../../src/cycles.h \
+    ../../src/balance.h \
+    ../../src/settlement.h \
+    ../../src/flowsettlement.h \
+    ../../src/sharedmutex.h \
+    ../../src/concurrentmultigraph.h \
+    ../../src/ringbuffer.h \
+    ../../src/edgeingestor.h \
+    ../../src/persistentvector.h \
+    ../../src/versionedmultigraph.h \
+    ../../src/generator.h \
+    ../../src/vertex.h
+
+INCLUDEPATH += ../../src/
+
+# operation counters and timers, qmake CONFIG+=mg_stats
+CONFIG(mg_stats) {
+    DEFINES += MG_ENABLE_STATS
+}
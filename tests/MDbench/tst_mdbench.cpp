@@ -0,0 +1,545 @@
+#include <QString>
+#include <QtTest>
+
+#include "multigraph.h"
+#include "balance.h"
+#include "reduction.h"
+#include "money.h"
+#include "multicurrency.h"
+#include "cycles.h"
+#include "settlement.h"
+#include "flowsettlement.h"
+#include "concurrentmultigraph.h"
+#include "edgeingestor.h"
+#include "versionedmultigraph.h"
+#include "generator.h"
+#include <string>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+using namespace mg;
+using namespace std;
+
+namespace
+{
+  typedef Multigraph<string, double> Graph;
+
+  // destructive operations are measured on this many elements of a graph of the given size
+  const int deletions = 100;
+
+  // lookups done by every reader thread of concurrentReads
+  const int lookups = 1000000;
+
+  void addSizes(int maxSize = 1000000)
+  {
+    QTest::addColumn<int>("size");
+    for(int size = 1000; size <= maxSize; size *= 10)
+      QTest::newRow(QByteArray::number(size)) << size;
+  }
+
+  vector<string> vertexNames(int count)
+  {
+    vector<string> names;
+    names.reserve(count);
+    for(int i = 0; i < count; i++)
+      names.push_back(DebtGenerator::vertexName(i));
+    return names;
+  }
+
+  // ten edges per vertex on average, fixed seed so every run measures the same graph
+  GeneratorOptions ledger(int edges)
+  {
+    GeneratorOptions options;
+    options.vertexes = max(edges / 10, 2);
+    options.edges = edges;
+    options.seed = 42;
+    options.communities = max(edges / 10000, 1);
+    return options;
+  }
+
+  void addVertexes(Graph& graph, int count)
+  {
+    vector<string> names = vertexNames(count);
+    for(auto i = names.begin(); i != names.end(); ++i)
+      graph.addVertex(*i);
+  }
+
+  void buildGraph(Graph& graph, int edges)
+  {
+    generateGraph(graph, ledger(edges));
+  }
+
+  // the exact settlement is exponential in the number of persons
+  void addPersons()
+  {
+    QTest::addColumn<int>("size");
+    for(int persons = 12; persons <= 20; persons += 4)
+      QTest::newRow(QByteArray::number(persons)) << persons;
+  }
+
+  void addThreads()
+  {
+    QTest::addColumn<int>("threads");
+    for(int threads = 1; threads <= 8; threads *= 2)
+      QTest::newRow(QByteArray::number(threads)) << threads;
+  }
+}
+
+class MDBench : public QObject
+{
+  Q_OBJECT
+
+private Q_SLOTS:
+  // mutation
+  void addVertex_data() {addSizes();}
+  void addVertex();
+  void addEdge_data() {addSizes();}
+  void addEdge();
+  void deleteVertex_data() {addSizes();}
+  void deleteVertex();
+  void deleteEdge_data() {addSizes();}
+  void deleteEdge();
+
+  // traversal
+  void checkGraphInvariant_data() {addSizes();}
+  void checkGraphInvariant();
+  void iteration_data() {addSizes();}
+  void iteration();
+
+  // serialization
+  void serialize_data() {addSizes();}
+  void serialize();
+  void deserialize_data() {addSizes();}
+  void deserialize();
+  void dotText_data() {addSizes();}
+  void dotText();
+
+  // algorithms
+  void reduceEdges_data() {addSizes();}
+  void reduceEdges();
+  void reduceEdgesMoney_data() {addSizes();}
+  void reduceEdgesMoney();
+  void balances_data() {addSizes();}
+  void balances();
+  void balancesMoney_data() {addSizes();}
+  void balancesMoney();
+  void balancesCurrency_data() {addSizes();}
+  void balancesCurrency();
+  void cancelCycles_data() {addSizes();}
+  void cancelCycles();
+  void exactSettlement_data() {addPersons();}
+  void exactSettlement();
+  void flowSettlement_data() {addSizes(100000);}
+  void flowSettlement();
+  void flowSettlementWarm_data() {addSizes(100000);}
+  void flowSettlementWarm();
+
+  // concurrency, every thread does the same work: constant time means linear scaling
+  void concurrentReads_data() {addThreads();}
+  void concurrentReads();
+  void concurrentIngest_data() {addThreads();}
+  void concurrentIngest();
+
+  // versions
+  void snapshot_data() {addSizes();}
+  void snapshot();
+  void snapshotMutation_data() {addSizes();}
+  void snapshotMutation();
+};
+
+void MDBench::addVertex()
+{
+  QFETCH(int, size);
+  vector<string> names = vertexNames(size);
+
+  QBENCHMARK
+  {
+    Graph graph;
+    for(auto i = names.begin(); i != names.end(); ++i)
+      graph.addVertex(*i);
+  }
+}
+
+void MDBench::addEdge()
+{
+  QFETCH(int, size);
+  GeneratorOptions options = ledger(size);
+  Graph graph;
+  addVertexes(graph, options.vertexes);
+
+  vector<Vertex<string, double>*> vertexes;
+  const auto& graphVertexes = graph.getVertexes();
+  vertexes.assign(graphVertexes.begin(), graphVertexes.end());
+  vector<GeneratedDebt> debts;
+  DebtGenerator generator(options);
+  for(GeneratedDebt debt; generator.next(debt); )
+    debts.push_back(debt);
+
+  QBENCHMARK_ONCE
+  {
+    for(auto i = debts.begin(); i != debts.end(); ++i)
+      graph.addEdge(vertexes[i->creditor], vertexes[i->debtor], i->amount());
+  }
+  QVERIFY(graph.getEdgesCount() == static_cast<size_t>(size));
+}
+
+void MDBench::deleteVertex()
+{
+  QFETCH(int, size);
+  Graph graph;
+  buildGraph(graph, size);
+  vector<string> names = vertexNames(min(deletions, static_cast<int>(ledger(size).vertexes)));
+
+  QBENCHMARK_ONCE
+  {
+    for(auto i = names.begin(); i != names.end(); ++i)
+      graph.deleteVertex(*i);
+  }
+}
+
+void MDBench::deleteEdge()
+{
+  QFETCH(int, size);
+  Graph graph;
+  buildGraph(graph, size);
+
+  vector<Edge<string, double>*> edges;
+  const auto& vertexes = graph.getVertexes();
+  for(auto i = vertexes.begin(); i != vertexes.end() && edges.size() < static_cast<size_t>(deletions); ++i)
+  {
+    const auto& outgoingEdges = (*i)->getOutgoingEdges();
+    edges.insert(edges.end(), outgoingEdges.begin(), outgoingEdges.end());
+  }
+  edges.resize(min(edges.size(), static_cast<size_t>(deletions)));
+
+  QBENCHMARK_ONCE
+  {
+    for(auto i = edges.begin(); i != edges.end(); ++i)
+      graph.deleteEdge(*i);
+  }
+}
+
+void MDBench::checkGraphInvariant()
+{
+  QFETCH(int, size);
+  Graph graph;
+  buildGraph(graph, size);
+
+  QBENCHMARK
+  {
+    QVERIFY(graph.checkGraphInvariant());
+  }
+}
+
+void MDBench::iteration()
+{
+  QFETCH(int, size);
+  Graph graph;
+  buildGraph(graph, size);
+
+  double total = 0;
+  QBENCHMARK
+  {
+    total = 0;
+    std::for_each(graph.beginV(), graph.endV(), [&total](Vertex<string, double>* i)
+    {
+      const auto& outgoingEdges = i->getOutgoingEdges();
+      for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+        total += (*j)->getValue();
+    });
+  }
+  QVERIFY(total > 0);
+}
+
+void MDBench::serialize()
+{
+  QFETCH(int, size);
+  Graph graph;
+  buildGraph(graph, size);
+
+  QBENCHMARK
+  {
+    ostringstream output;
+    output << graph;
+  }
+}
+
+void MDBench::deserialize()
+{
+  QFETCH(int, size);
+  string text;
+  {
+    Graph graph;
+    buildGraph(graph, size);
+    ostringstream output;
+    output << graph;
+    text = output.str();
+  }
+
+  QBENCHMARK
+  {
+    Graph graph;
+    istringstream input(text);
+    input >> graph;
+  }
+}
+
+void MDBench::dotText()
+{
+  QFETCH(int, size);
+  Graph graph;
+  buildGraph(graph, size);
+
+  QBENCHMARK
+  {
+    graph.dotText();
+  }
+}
+
+void MDBench::reduceEdges()
+{
+  QFETCH(int, size);
+  Graph graph;
+  buildGraph(graph, size);
+
+  QBENCHMARK_ONCE
+  {
+    mg::reduceEdges(graph);
+  }
+  QVERIFY(graph.getEdgesCount() <= static_cast<size_t>(size));
+}
+
+void MDBench::reduceEdgesMoney()
+{
+  QFETCH(int, size);
+  Multigraph<string, Money> graph;
+  generateGraph(graph, ledger(size));
+
+  QBENCHMARK_ONCE
+  {
+    mg::reduceEdges(graph);
+  }
+  QVERIFY(graph.getEdgesCount() <= static_cast<size_t>(size));
+}
+
+void MDBench::balances()
+{
+  QFETCH(int, size);
+  Graph graph;
+  buildGraph(graph, size);
+
+  vector<double> result;
+  QBENCHMARK
+  {
+    result = mg::balances(graph);
+  }
+  QVERIFY(result.size() == graph.getVertexes().size());
+}
+
+void MDBench::balancesMoney()
+{
+  QFETCH(int, size);
+  Multigraph<string, Money> graph;
+  generateGraph(graph, ledger(size));
+
+  vector<Money> result;
+  QBENCHMARK
+  {
+    result = mg::balances(graph);
+  }
+  QVERIFY(result.size() == graph.getVertexes().size());
+}
+
+void MDBench::balancesCurrency()
+{
+  QFETCH(int, size);
+  Multigraph<string, CurrencyAmount> graph;
+  generateGraph(graph, ledger(size));
+
+  // debts spread over four currencies, converted to euro
+  Currency currencies[] = {Currency("EUR"), Currency("USD"), Currency("GBP"), Currency("CHF")};
+  RateTable rates(currencies[0]);
+  rates.setRate(currencies[1], 0.92);
+  rates.setRate(currencies[2], 1.17);
+  rates.setRate(currencies[3], 1.04);
+  size_t count = 0;
+  const auto& vertexes = graph.getVertexes();
+  for(auto i = vertexes.begin(); i != vertexes.end(); ++i)
+  {
+    const auto& outgoingEdges = (*i)->getOutgoingEdges();
+    for(auto j = outgoingEdges.begin(); j != outgoingEdges.end(); ++j)
+      graph.setEdgeValue(*j, CurrencyAmount((*j)->getValue().getAmount(), currencies[count++ % 4]));
+  }
+
+  vector<Money> result;
+  QBENCHMARK
+  {
+    result = mg::balances(graph, rates);
+  }
+  QVERIFY(result.size() == graph.getVertexes().size());
+}
+
+void MDBench::cancelCycles()
+{
+  QFETCH(int, size);
+  Graph graph;
+  buildGraph(graph, size);
+
+  QBENCHMARK_ONCE
+  {
+    mg::cancelCycles(graph, 1e-9);
+  }
+  QVERIFY(graph.checkGraphInvariant());
+}
+
+void MDBench::exactSettlement()
+{
+  QFETCH(int, size);
+  GeneratorOptions options = ledger(size * 10);
+  options.vertexes = size;
+  Graph graph;
+  generateGraph(graph, options);
+
+  vector<Transfer<string, double> > transfers;
+  QBENCHMARK_ONCE
+  {
+    transfers = mg::exactSettlement(graph, 1e-9);
+  }
+  QVERIFY(transfers.size() < static_cast<size_t>(size));
+}
+
+void MDBench::flowSettlement()
+{
+  QFETCH(int, size);
+  Graph graph;
+  buildGraph(graph, size);
+
+  vector<Transfer<string, double> > transfers;
+  QBENCHMARK_ONCE
+  {
+    transfers = mg::flowSettlement(graph, 1e-6);
+  }
+  QVERIFY(transfers.size() <= 2 * static_cast<size_t>(size));
+}
+
+void MDBench::flowSettlementWarm()
+{
+  QFETCH(int, size);
+  Graph graph;
+  buildGraph(graph, size);
+  FlowSettlement<string, double> settlement(1e-6);
+  settlement.solve(graph);
+
+  // a few amounts change, the relationships stay
+  vector<Edge<string, double>*> edges;
+  const auto& vertexes = graph.getVertexes();
+  for(auto i = vertexes.begin(); i != vertexes.end() && edges.size() < static_cast<size_t>(deletions); ++i)
+    if(!(*i)->getOutgoingEdges().empty())
+      edges.push_back((*i)->getOutgoingEdges().front());
+  for(auto i = edges.begin(); i != edges.end(); ++i)
+    graph.setEdgeValue(*i, (*i)->getValue() + 1.);
+
+  QBENCHMARK_ONCE
+  {
+    settlement.solve(graph);
+  }
+  QVERIFY(settlement.isWarmStarted());
+}
+
+void MDBench::concurrentReads()
+{
+  QFETCH(int, threads);
+  const int size = 100000;
+  ConcurrentMultigraph<string, double> graph;
+  graph.write([](Graph& g) {buildGraph(g, size);});
+  vector<string> names = vertexNames(size / 10);
+
+  atomic<size_t> found(0);
+  QBENCHMARK
+  {
+    vector<thread> readers;
+    for(int t = 0; t < threads; t++)
+      readers.push_back(thread([&graph, &names, &found, t]()
+      {
+        size_t hits = 0;
+        for(size_t i = 0; i < static_cast<size_t>(lookups); i++)
+          hits += graph.hasVertex(names[(i * 7919 + t) % names.size()]);
+        found += hits;
+      }));
+    for(auto i = readers.begin(); i != readers.end(); ++i)
+      i->join();
+  }
+  QVERIFY(found > 0);
+}
+
+void MDBench::concurrentIngest()
+{
+  QFETCH(int, threads);
+  const int records = 100000;
+  vector<string> names = vertexNames(records / 10);
+
+  QBENCHMARK
+  {
+    ConcurrentMultigraph<string, double> graph;
+    EdgeIngestor<string, double> ingestor(graph);
+    vector<thread> producers;
+    for(int t = 0; t < threads; t++)
+      producers.push_back(thread([&ingestor, &names, t]()
+      {
+        for(size_t i = 0; i < static_cast<size_t>(records); i++)
+          ingestor.enqueue(names[(i + t) % names.size()], names[(i * 7919 + t + 1) % names.size()], 1.);
+      }));
+    for(auto i = producers.begin(); i != producers.end(); ++i)
+      i->join();
+    ingestor.flush();
+  }
+}
+
+void MDBench::snapshot()
+{
+  QFETCH(int, size);
+  VersionedMultigraph<string, double> graph;
+  GeneratedDebt debt;
+  DebtGenerator generator(ledger(size));
+  vector<string> names = vertexNames(ledger(size).vertexes);
+  for(auto i = names.begin(); i != names.end(); ++i)
+    graph.addVertex(*i);
+  while(generator.next(debt))
+    graph.addEdge(names[debt.creditor], names[debt.debtor], debt.amount());
+
+  QBENCHMARK
+  {
+    GraphSnapshot<string, double> version = graph.snapshot();
+    QVERIFY(version.getEdgesCount() == static_cast<size_t>(size));
+  }
+}
+
+void MDBench::snapshotMutation()
+{
+  QFETCH(int, size);
+  VersionedMultigraph<string, double> graph;
+  vector<string> names = vertexNames(size / 10);
+  for(auto i = names.begin(); i != names.end(); ++i)
+    graph.addVertex(*i);
+  for(int i = 0; i < size; i++)
+    graph.addEdge(names[i % names.size()], names[(i + 1) % names.size()], i);
+
+  // every mutation follows a snapshot, so each one copies its path
+  vector<GraphSnapshot<string, double> > versions;
+  versions.reserve(deletions);
+  QBENCHMARK_ONCE
+  {
+    for(int i = 0; i < deletions; i++)
+    {
+      versions.push_back(graph.snapshot());
+      graph.deleteEdge(names[i % names.size()], names[(i + 1) % names.size()], i);
+    }
+  }
+  QVERIFY(versions.front().getEdgesCount() == static_cast<size_t>(size));
+}
+
+QTEST_APPLESS_MAIN(MDBench)
+
+#include "tst_mdbench.moc"
@@ -27,13 +27,52 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 
 SOURCES += tst_mdtests.cpp \
-    ../../src/mgexception.cpp
+    ../../src/mgexception.cpp \
+    ../../src/expressioncache.cpp \
+    ../../src/money.cpp \
+    ../../src/currency.cpp \
+    ../../src/csvimporter.cpp \
+    ../../src/generator.cpp \
+    ../../src/tracer.cpp \
+    ../../ThirdParty/tinyexpr-master/tinyexpr.c
 DEFINES += SRCDIR=\\\"$$PWD/\\\"
 
 HEADERS += \
     ../../src/edge.h \
     ../../src/mgexception.h \
+    ../../src/mgstats.h \
+    ../../src/tracer.h \
+    ../../src/status.h \
     ../../src/multigraph.h \
+    ../../src/dotwriter.h \
+    ../../src/threadpool.h \
+    ../../src/components.h \
+    ../../src/expressioncache.h \
+    ../../src/money.h \
+    ../../src/currency.h \
+    ../../src/multicurrency.h \
+    ../../src/csvimporter.h \
+    ../../src/groupexpense.h \
+    ../../src/mutation.h \
+    ../../src/undohistory.h \
+    ../../src/balance.h \
+    ../../src/reduction.h \
+    ../../src/settlement.h \
+    ../../src/flowsettlement.h \
+    ../../src/cycles.h \
+    ../../src/sharedmutex.h \
+    ../../src/concurrentmultigraph.h \
+    ../../src/ringbuffer.h \
+    ../../src/edgeingestor.h \
+    ../../src/persistentvector.h \
+    ../../src/versionedmultigraph.h \
+    ../../src/generator.h \
+    ../../ThirdParty/tinyexpr-master/tinyexpr.h \
     ../../src/vertex.h
 
 INCLUDEPATH += ../../src/
+
+# operation counters and timers, qmake CONFIG+=mg_stats
+CONFIG(mg_stats) {
+    DEFINES += MG_ENABLE_STATS
+}
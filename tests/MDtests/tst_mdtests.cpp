@@ -2,8 +2,29 @@
 #include <QtTest>
 
 #include "multigraph.h"
+#include "components.h"
+#include "expressioncache.h"
+#include "money.h"
+#include "currency.h"
+#include "multicurrency.h"
+#include "csvimporter.h"
+#include "balance.h"
+#include "reduction.h"
+#include "settlement.h"
+#include "flowsettlement.h"
+#include "cycles.h"
+#include "generator.h"
+#include "mgstats.h"
+#include "tracer.h"
+#include "concurrentmultigraph.h"
+#include "edgeingestor.h"
+#include "versionedmultigraph.h"
+#include "undohistory.h"
+#include "../ThirdParty/tinyexpr-master/tinyexpr.h"
 #include <string>
 #include <sstream>
+#include <thread>
+#include <atomic>
 
 using namespace mg;
 using namespace std;
@@ -35,7 +56,50 @@ private Q_SLOTS:
   void mgDelVertex();
   void mgDelEdge();
   void mgClear();
+  void mgTryMutationsTest();
   void mgSerializeTest();
+  void mgDotTextTest();
+  void mgDotTextParallelTest();
+  void mgWeakComponentsTest();
+  void mgConnectedComponentsTest();
+  void mgContentHashTest();
+  void mgGroupExpenseTest();
+  void mgBalancesTest();
+  void mgReduceEdgesTest();
+  void mgGreedySettlementTest();
+  void mgExactSettlementTest();
+  void mgFlowSettlementTest();
+  void moneyTest();
+  void mgMoneyGraphTest();
+  void currencyTest();
+  void mgMultiCurrencyTest();
+  void mgCycleCancellationTest();
+  void mgUndoHistoryTest();
+
+  // expressions
+  void expressionCacheTest();
+  void expressionBatchTest();
+  void tinyexprProgramTest();
+
+  // concurrency
+  void concurrentMultigraphTest();
+  void ringBufferTest();
+  void edgeIngestorTest();
+  void persistentVectorTest();
+  void graphSnapshotTest();
+
+  // import
+  void csvImportTest();
+
+  // generator
+  void generatorTest();
+
+  // exceptions
+  void exceptionMessageTest();
+
+  // statistics
+  void statsTest();
+  void traceTest();
 };
 
 MDTests::MDTests()
@@ -234,6 +298,34 @@ void MDTests::mgClear()
   QVERIFY(graph.getVertexes().empty());
 }
 
+void MDTests::mgTryMutationsTest()
+{
+  Multigraph<string, float> graph;
+  Vertex<string, float>* vertex = NULL;
+  QVERIFY(graph.tryAddVertex("Vert1", &vertex) == MG_OK && vertex == graph.findVertex("Vert1"));
+  QVERIFY(graph.tryAddVertex("Vert1", &vertex) == MG_VERTEX_ALREADY_EXISTS && vertex == graph.findVertex("Vert1"));
+  QVERIFY(graph.tryAddVertex("Vert2") == MG_OK);
+
+  Edge<string, float>* edge = NULL;
+  QVERIFY(graph.tryAddEdge("Vert1", "Vert1", 1.f) == MG_LOOP_EDGE);
+  QVERIFY(graph.tryAddEdge("Vert3", "Vert1", 1.f) == MG_SRC_VERTEX_NOT_FOUND);
+  QVERIFY(graph.tryAddEdge("Vert1", "Vert3", 1.f) == MG_DST_VERTEX_NOT_FOUND);
+  QVERIFY(graph.tryAddEdge(vertex, NULL, 1.f) == MG_NULL_ENDPOINT);
+  QVERIFY(graph.tryAddEdge("Vert1", "Vert2", 1.f, &edge) == MG_OK && edge->getValue() == 1.f);
+  QVERIFY(graph.getEdgesCount() == 1 && graph.checkGraphInvariant());
+
+  QVERIFY(graph.tryDeleteEdge("Vert1", "Vert2", 2.f) == MG_EDGE_NOT_FOUND);
+  QVERIFY(graph.tryDeleteEdge("Vert3", "Vert2", 1.f) == MG_SRC_VERTEX_NOT_FOUND);
+  QVERIFY(graph.tryDeleteEdge("Vert1", "Vert2", 1.f) == MG_OK && graph.getEdgesCount() == 0);
+
+  // the throwing API reports the same failures
+  typedef VertexExistingException<string, float> VertexException;
+  typedef EdgeExistingException<string, float> EdgeException;
+  QVERIFY_EXCEPTION_THROWN(graph.addVertex("Vert1"), VertexException);
+  QVERIFY_EXCEPTION_THROWN(graph.addEdge("Vert1", "Vert1", 1.f), EdgeException);
+  QVERIFY_EXCEPTION_THROWN(graph.deleteEdge("Vert1", "Vert2", 1.f), EdgeException);
+}
+
 void MDTests::mgSerializeTest()
 {
   Multigraph<string, float> graph;
@@ -264,6 +356,1050 @@ void MDTests::mgSerializeTest()
           && i->getOutgoingEdges().front()->getValue() == 5.f;
     }) != vertexes.end()
   );
+  QVERIFY(!_istream.fail());
+
+  // a record cut short isn't added and fails the stream, like a missing one
+  string text = _ostream.str();
+  istringstream truncated(text.substr(0, text.rfind('\n', text.size() - 2) + 1));
+  Multigraph<string, float> partial;
+  truncated >> partial;
+  QVERIFY(truncated.fail() && partial.getVertexes().size() == 2 && partial.getEdgesCount() == 1);
+  istringstream missing("3\nVert1\nVert2\n");
+  Multigraph<string, float> fewer;
+  missing >> fewer;
+  QVERIFY(missing.fail() && fewer.getVertexes().size() == 2);
+}
+
+void MDTests::mgDotTextTest()
+{
+  Multigraph<string, float> graph;
+  graph.addVertex("Vert\"1\"");
+  graph.addVertex("Vert2");
+  graph.addEdge("Vert\"1\"", "Vert2", 10.5f);
+
+  string text;
+  graph.writeDot(text);
+
+  QVERIFY(text == "digraph {\n"
+                  "\"Vert\\\"1\\\"\";\n"
+                  "\"Vert2\";\n"
+                  "\"Vert\\\"1\\\"\"->\"Vert2\"[label=\"10.5\"];\n"
+                  "}\n");
+  QVERIFY(graph.dotText() == text);
+}
+
+void MDTests::mgDotTextParallelTest()
+{
+  Multigraph<string, float> graph;
+  const int vertexesCount = 10000;
+  for(int i = 0; i < vertexesCount; i++)
+    graph.addVertex("Vert" + to_string(i));
+  for(int i = 0; i < vertexesCount; i += 3)
+    graph.addEdge("Vert" + to_string(i), "Vert" + to_string((i * 7 + 1) % vertexesCount), i * 0.5f);
+
+  ThreadPool pool(4);
+  DotOptions options;
+  options.colorByBalance = true;
+
+  QVERIFY(graph.dotTextParallel(pool, options) == graph.dotText(options));
+  QVERIFY(graph.dotTextParallel(pool) == graph.dotText());
+}
+
+void MDTests::mgWeakComponentsTest()
+{
+  Multigraph<string, float> graph;
+  graph.addVertex("Vert1");
+  graph.addVertex("Vert2");
+  graph.addVertex("Vert3");
+  graph.addVertex("Vert4");
+  graph.addVertex("Vert5");
+  graph.addEdge("Vert1", "Vert2", 10.5f);
+  graph.addEdge("Vert4", "Vert2", 5.f);
+  graph.addEdge("Vert3", "Vert5", 1.f);
+
+  auto components = weakComponents(graph.getVertexes());
+
+  QVERIFY(components.size() == 2);
+  QVERIFY(components[0].size() == 3 && components[0][0]->getData() == "Vert1");
+  QVERIFY(components[1].size() == 2 && components[1][0]->getData() == "Vert3");
+}
+
+void MDTests::mgConnectedComponentsTest()
+{
+  Multigraph<string, float> graph;
+  graph.addVertex("Vert1");
+  graph.addVertex("Vert2");
+  graph.addVertex("Vert3");
+  graph.addVertex("Vert4");
+  graph.addEdge("Vert3", "Vert1", 10.5f);
+
+  vector<size_t> ids = connectedComponents(graph);
+  QVERIFY(ids == vector<size_t>({0, 1, 0, 2}));
+
+  ConnectedComponents<string, float> components(graph);
+  QVERIFY(components.count() == 3);
+
+  graph.addEdge("Vert2", "Vert4", 1.f);
+  auto vertexes = graph.getVertexes();
+  components.addEdge(vertexes.back()->getIncomingEdges().front());
+
+  QVERIFY(components.count() == 2);
+  QVERIFY(components.connected(vertexes.front(), *(++vertexes.begin())) == false);
+  QVERIFY(components.ids() == vector<size_t>({0, 1, 0, 1}));
+}
+
+void MDTests::mgContentHashTest()
+{
+  Multigraph<string, float> graph;
+  uint64_t emptyHash = graph.getContentHash();
+  graph.addVertex("Vert1");
+  graph.addVertex("Vert2");
+  uint64_t vertexesHash = graph.getContentHash();
+  graph.addEdge("Vert1", "Vert2", 10.5f);
+  uint64_t edgeHash = graph.getContentHash();
+
+  QVERIFY(emptyHash != vertexesHash && vertexesHash != edgeHash);
+
+  graph.deleteEdge("Vert1", "Vert2", 10.5f);
+  QVERIFY(graph.getContentHash() == vertexesHash);
+
+  Multigraph<string, float> reversed;
+  reversed.addVertex("Vert2");
+  reversed.addVertex("Vert1");
+  reversed.addEdge("Vert1", "Vert2", 1.f);
+  reversed.setEdgeValue(reversed.getVertexes().back()->getOutgoingEdges().front(), 10.5f);
+  graph.addEdge("Vert1", "Vert2", 10.5f);
+  QVERIFY(reversed.getContentHash() == graph.getContentHash());
+
+  graph.deleteVertex("Vert2");
+  graph.deleteVertex("Vert1");
+  QVERIFY(graph.getContentHash() == emptyHash);
+}
+
+void MDTests::mgGroupExpenseTest()
+{
+  Multigraph<string, float> graph;
+  graph.addVertex("Vert1");
+  graph.addVertex("Vert2");
+  graph.addVertex("Vert3");
+  graph.addVertex("Vert4");
+
+  auto dinner = graph.addGroupExpense("Vert1", 90.f, {"Vert1", "Vert2", "Vert3"});
+  graph.addGroupExpense("Vert2", 30.f, {"Vert3", "Vert4"}, SPLIT_WEIGHTED, {1.f, 2.f});
+  QVERIFY(graph.getGroupExpenses().size() == 2 && graph.getEdgesCount() == 0);
+  QVERIFY(dinner->partOf(1) == 30.f);
+  QVERIFY_EXCEPTION_THROWN(graph.addGroupExpense("Vert5", 1.f, {"Vert1"}), mg::Exception);
+  QVERIFY_EXCEPTION_THROWN(graph.addGroupExpense("Vert1", 1.f, {"Vert2"}, SPLIT_EXACT), mg::Exception);
+  QVERIFY_EXCEPTION_THROWN(graph.addGroupExpense("Vert1", 1.f, {"Vert2", "Vert3"}, SPLIT_WEIGHTED, {0.f, 0.f}),
+                           mg::Exception);
+  QVERIFY_EXCEPTION_THROWN(graph.addGroupExpense("Vert1", 1.f, {"Vert2", "Vert3"}, SPLIT_WEIGHTED, {2.f, -1.f}),
+                           mg::Exception);
+
+  // the optional section survives a round trip
+  ostringstream _ostream;
+  _ostream << graph;
+  uint64_t hash = graph.getContentHash();
+  graph.clear();
+  istringstream _istream(_ostream.str());
+  _istream >> graph;
+  QVERIFY(graph.getGroupExpenses().size() == 2 && graph.getContentHash() == hash);
+  QVERIFY(graph.getGroupExpenses().back().getRule() == SPLIT_WEIGHTED);
+
+  // the payer part of equal split is recomputed when a participant leaves
+  graph.deleteVertex("Vert3");
+  QVERIFY(graph.getGroupExpenses().size() == 2);
+  QVERIFY(graph.getGroupExpenses().front().partOf(1) == 45.f);
+  graph.deleteVertex("Vert2");
+  QVERIFY(graph.getGroupExpenses().size() == 1);
+
+  Multigraph<string, float> remaining;
+  remaining.addVertex("Vert1");
+  remaining.addVertex("Vert4");
+  graph.deleteGroupExpense(&graph.getGroupExpenses().front());
+  QVERIFY(graph.getGroupExpenses().empty() && graph.getContentHash() == remaining.getContentHash());
+
+  // a weighted record left with zero weights only splits nothing and is dropped
+  graph.addVertex("Vert5");
+  graph.addGroupExpense("Vert1", 10.f, {"Vert4", "Vert5"}, SPLIT_WEIGHTED, {0.f, 1.f});
+  graph.deleteVertex("Vert5");
+  QVERIFY(graph.getGroupExpenses().empty());
+
+  // equal parts of whole units add up to the total, the first participants take the rest
+  Multigraph<string, int> units;
+  for(const char* name: {"a", "b", "c"})
+    units.addVertex(name);
+  auto taxi = units.addGroupExpense("a", 10, {"a", "b", "c"});
+  QVERIFY(taxi->partOf(0) == 4 && taxi->partOf(1) == 3 && taxi->partOf(2) == 3);
+  QVERIFY(balances(units) == vector<int>({6, -3, -3}));
+
+  // weighted parts too, the units left go to the largest remainders
+  auto fuel = units.addGroupExpense("a", 10, {"a", "b", "c"}, SPLIT_WEIGHTED, {1, 1, 1});
+  QVERIFY(fuel->partOf(0) + fuel->partOf(1) + fuel->partOf(2) == 10);
+  auto ferry = units.addGroupExpense("a", 10, {"b", "c"}, SPLIT_WEIGHTED, {1, 2});
+  QVERIFY(ferry->partOf(0) == 3 && ferry->partOf(1) == 7);
+
+  Multigraph<string, Money> cents;
+  for(const char* name: {"a", "b", "c", "d"})
+    cents.addVertex(name);
+  auto tickets = cents.addGroupExpense("a", Money(10), {"b", "c", "d"}, SPLIT_WEIGHTED, {Money(1), Money(1), Money(1)});
+  QVERIFY(tickets->partOf(0) + tickets->partOf(1) + tickets->partOf(2) == Money(10));
+  QVERIFY(balances(cents)[0] == Money(10));
+}
+
+void MDTests::mgBalancesTest()
+{
+  Multigraph<string, float> graph;
+  graph.addVertex("Vert1");
+  graph.addVertex("Vert2");
+  graph.addVertex("Vert3");
+  graph.addEdge("Vert2", "Vert1", 10.f);
+  graph.addGroupExpense("Vert1", 60.f, {"Vert1", "Vert2", "Vert3"});
+  graph.addGroupExpense("Vert3", 0.f, {"Vert1", "Vert2"}, SPLIT_EXACT, {5.f, 15.f});
+
+  vector<float> result = balances(graph);
+  QVERIFY(result == vector<float>({25.f, -25.f, 0.f}));
+}
+
+void MDTests::mgReduceEdgesTest()
+{
+  Multigraph<string, float> graph;
+  graph.addVertex("Vert1");
+  graph.addVertex("Vert2");
+  graph.addVertex("Vert3");
+  graph.addEdge("Vert1", "Vert2", 10.f);
+  graph.addEdge("Vert1", "Vert2", 5.f);
+  graph.addEdge("Vert2", "Vert1", 3.f);
+  graph.addEdge("Vert2", "Vert3", 4.f);
+  graph.addEdge("Vert3", "Vert2", 4.f);
+
+  vector<float> before = balances(graph);
+  reduceEdges(graph);
+
+  QVERIFY(graph.getEdgesCount() == 1 && graph.checkGraphInvariant());
+  QVERIFY(graph.findVertex("Vert1")->getOutgoingEdges().front()->getValue() == 12.f);
+  QVERIFY(balances(graph) == before);
+}
+
+void MDTests::mgGreedySettlementTest()
+{
+  GeneratorOptions options;
+  options.vertexes = 50;
+  options.edges = 400;
+  Multigraph<string, double> graph;
+  generateGraph(graph, options);
+  graph.addGroupExpense("person1", 90., {"person1", "person2", "person3"});
+
+  vector<double> before = balances(graph);
+  auto transfers = greedySettlement(graph, 1e-9);
+  QVERIFY(!transfers.empty() && transfers.size() < 50);
+  QVERIFY(transfers.front().amount > 0 && transfers.front().creditor != transfers.front().debtor);
+
+  applySettlement(graph, transfers);
+  QVERIFY(graph.getEdgesCount() == transfers.size() && graph.getGroupExpenses().empty());
+  QVERIFY(graph.checkGraphInvariant());
+
+  vector<double> after = balances(graph);
+  for(size_t i = 0; i < before.size(); i++)
+    QVERIFY(fabs(before[i] - after[i]) < 1e-6);
+  QVERIFY(greedySettlement(graph, 1e-9).size() == transfers.size());
+}
+
+void MDTests::mgExactSettlementTest()
+{
+  // balances 9, 7, 1 against 8, 4, 5: greedy needs five transfers, {9, 4, 5} and {7, 1, 8} settle with four
+  Multigraph<string, double> graph;
+  for(const char* name: {"a", "b", "c", "d", "e", "f"})
+    graph.addVertex(name);
+  graph.addEdge("a", "d", 8.);
+  graph.addEdge("a", "f", 1.);
+  graph.addEdge("b", "e", 4.);
+  graph.addEdge("b", "f", 3.);
+  graph.addEdge("c", "f", 1.);
+
+  vector<double> before = balances(graph);
+  auto transfers = exactSettlement(graph, 1e-9);
+  QVERIFY(transfers.size() == 4 && greedySettlement(graph, 1e-9).size() == 5);
+
+  applySettlement(graph, transfers);
+  QVERIFY(graph.getEdgesCount() == 4 && graph.checkGraphInvariant());
+  vector<double> after = balances(graph);
+  for(size_t i = 0; i < before.size(); i++)
+    QVERIFY(fabs(before[i] - after[i]) < 1e-6);
+  QVERIFY(exactSettlement(graph, 1e-9).size() == 4);
+
+  // never worse than greedy, large groups fall back to it
+  GeneratorOptions options;
+  options.vertexes = 14;
+  options.edges = 40;
+  Multigraph<string, double> generated;
+  generateGraph(generated, options);
+  QVERIFY(exactSettlement(generated, 1e-6).size() <= greedySettlement(generated, 1e-6).size());
+  QVERIFY(exactSettlement(generated, 1e-6, 4).size() == greedySettlement(generated, 1e-6).size());
+
+  Multigraph<string, double> empty;
+  QVERIFY(exactSettlement(empty, 1e-9).empty());
+}
+
+void MDTests::mgFlowSettlementTest()
+{
+  // a chain can only be settled along itself, a shortcut is taken where one exists
+  Multigraph<string, double> graph;
+  for(const char* name: {"a", "b", "c", "d", "e"})
+    graph.addVertex(name);
+  graph.addEdge("a", "b", 5.);
+  graph.addEdge("b", "c", 5.);
+  graph.addEdge("c", "d", 4.);
+  graph.addEdge("b", "d", 2.);
+  graph.addGroupExpense("e", 20., {"e", "d"});
+
+  FlowSettlement<string, double> settlement(1e-9);
+  vector<double> before = balances(graph);
+  auto transfers = settlement.solve(graph);
+  QVERIFY(!settlement.isWarmStarted() && settlement.getPhases() > 0);
+
+  // balances a: 5, b: 2, c: -1, d: -16, e: 10; money of a reaches d only through b
+  double volume = 0.;
+  for(auto i = transfers.begin(); i != transfers.end(); ++i)
+  {
+    const string& creditor = i->creditor->getData();
+    const string& debtor = i->debtor->getData();
+    QVERIFY((creditor == "a" && debtor == "b") || (creditor == "b" && (debtor == "c" || debtor == "d"))
+            || (creditor == "e" && debtor == "d"));
+    volume += i->amount;
+  }
+  QVERIFY(transfers.size() == 4 && fabs(volume - 22.) < 1e-9);
+
+  applySettlement(graph, transfers);
+  QVERIFY(graph.checkGraphInvariant() && graph.getGroupExpenses().empty());
+  vector<double> after = balances(graph);
+  for(size_t i = 0; i < before.size(); i++)
+    QVERIFY(fabs(before[i] - after[i]) < 1e-9);
+
+  // a changed amount keeps the old solution optimal, a new relationship may not
+  graph.setEdgeValue(graph.findVertex("e")->getOutgoingEdges().front(), 12.);
+  transfers = settlement.solve(graph);
+  QVERIFY(settlement.isWarmStarted() && transfers.size() == 4);
+  graph.addVertex("f");
+  QVERIFY(settlement.solve(graph).size() == 4 && settlement.isWarmStarted());
+  graph.addEdge("a", "d", 1.);
+  settlement.solve(graph);
+  QVERIFY(!settlement.isWarmStarted());
+
+  // warm and cold solutions move the same total on a generated ledger
+  GeneratorOptions options;
+  options.vertexes = 200;
+  options.edges = 2000;
+  Multigraph<string, double> generated;
+  generateGraph(generated, options);
+  generated.addGroupExpense("person1", 90., {"person1", "person2", "person3"});
+  FlowSettlement<string, double> incremental(1e-6);
+  incremental.solve(generated);
+  Edge<string, double>* edge = generated.getVertexes().front()->getOutgoingEdges().front();
+  generated.setEdgeValue(edge, edge->getValue() + 3.);
+
+  before = balances(generated);
+  auto warm = incremental.solve(generated);
+  auto cold = flowSettlement(generated, 1e-6);
+  double warmVolume = 0., coldVolume = 0.;
+  for(auto i = warm.begin(); i != warm.end(); ++i)
+    warmVolume += i->amount;
+  for(auto i = cold.begin(); i != cold.end(); ++i)
+    coldVolume += i->amount;
+  QVERIFY(incremental.isWarmStarted() && fabs(warmVolume - coldVolume) < 1e-3);
+
+  applySettlement(generated, warm);
+  after = balances(generated);
+  for(size_t i = 0; i < before.size(); i++)
+    QVERIFY(fabs(before[i] - after[i]) < 1e-3);
+}
+
+void MDTests::moneyTest()
+{
+  QVERIFY(Money(3).getMinor() == 300 && Money(0.29).getMinor() == 29 && Money(-2.675).getMinor() == -268);
+  QVERIFY(Money(0.1) + Money(0.2) == Money(0.3));
+  QVERIFY(Money(10) / Money(3) == Money::fromMinor(333) && Money(-10) / Money(3) == Money::fromMinor(-333));
+  QVERIFY(Money(2.5) * Money(0.5) == Money::fromMinor(125) && Money::fromMinor(5) * Money(0.5) == Money::fromMinor(3));
+  QVERIFY(Money(1000000000) * Money(1000) == Money(1000000000000LL));
+  QVERIFY(Money(1) < Money(1.01) && -Money(1) < Money() && Money(1.5).toDouble() == 1.5);
+  QVERIFY(hash<Money>()(Money(7)) == hash<Money>()(Money::fromMinor(700)));
+
+  // decimal text is exact, extra digits round half away from zero
+  Money value;
+  QVERIFY(parseMoney("12.345", 6, value) && value.getMinor() == 1235);
+  QVERIFY(parseMoney("-0.005", 6, value) && value.getMinor() == -1);
+  QVERIFY(parseMoney("1.2345e+06", 10, value) && value.getMinor() == 123450000);
+  QVERIFY(parseMoney("5e-3", 4, value) && value.getMinor() == 1);
+  QVERIFY(parseMoney("7.", 2, value) && value == Money(7));
+  QVERIFY(!parseMoney("", 0, value) && !parseMoney("1.2.3", 5, value) && !parseMoney("abc", 3, value));
+  QVERIFY(!parseMoney("99999999999999999999", 20, value) && !parseMoney("1e", 2, value));
+
+  ostringstream os;
+  os << Money(-0.05) << " " << Money(1234.5) << " " << Money::fromMinor(numeric_limits<int64_t>::min());
+  QVERIFY(os.str() == "-0.05 1234.50 -92233720368547758.08");
+
+  istringstream is("3.10 -7 x");
+  Money a, b, c;
+  is >> a >> b;
+  QVERIFY(!is.fail() && a == Money(3.1) && b == Money(-7));
+  is >> c;
+  QVERIFY(is.fail());
+
+  // numbers are taken as written, expressions go through tinyexpr and are rounded
+  ExpressionCache expressions;
+  int error = -1;
+  QVERIFY(evaluateMoney(" 0.07 ", expressions, &error) == Money::fromMinor(7) && error == 0);
+  QVERIFY(evaluateMoney("100/3", expressions, &error) == Money::fromMinor(3333) && error == 0);
+  evaluateMoney("2*(3", expressions, &error);
+  QVERIFY(error != 0);
+  evaluateMoney("1e30", expressions, &error);
+  QVERIFY(error != 0);
+}
+
+void MDTests::mgMoneyGraphTest()
+{
+  Multigraph<string, Money> graph;
+  for(const char* name: {"a", "b", "c"})
+    graph.addVertex(name);
+  // a thousand dimes against a hundred dollars cancel exactly, doubles would leave a residue
+  for(int i = 0; i < 1000; i++)
+    graph.addEdge("a", "b", Money(0.1));
+  graph.addEdge("b", "a", Money(100));
+  graph.addEdge("b", "c", Money(12.34));
+  graph.addEdge("b", "c", Money(0.66));
+  graph.addGroupExpense("c", Money(10), {"a", "b", "c"});
+
+  vector<Money> before = balances(graph);
+  QVERIFY(before[0] == Money(-3.34) && before[1] == Money(9.67) && before[2] == Money(-6.33));
+  Money sum;
+  for(auto i = before.begin(); i != before.end(); ++i)
+    sum += *i;
+  QVERIFY(sum == Money());
+
+  reduceEdges(graph);
+  QVERIFY(graph.getEdgesCount() == 1 && graph.checkGraphInvariant());
+  QVERIFY(graph.findVertex("b")->getOutgoingEdges().front()->getValue() == Money(13));
+  QVERIFY(balances(graph) == before);
+
+  // the .mg text round trips exactly and double files load
+  ostringstream os;
+  os << graph;
+  Multigraph<string, Money> loaded;
+  istringstream is(os.str());
+  is >> loaded;
+  QVERIFY(loaded.getContentHash() == graph.getContentHash());
+
+  istringstream doubles("2\nx\ny\n1\nx\ny\n0.1\n");
+  Multigraph<string, Money> fromDoubles;
+  doubles >> fromDoubles;
+  QVERIFY(fromDoubles.findVertex("x")->getOutgoingEdges().front()->getValue() == Money::fromMinor(10));
+
+  QVERIFY(graph.dotText().find("\"13.00\"") != string::npos);
+
+  istringstream csv("creditor,debtor,amount\nx,y,0.29\nx,y,1/3\n");
+  importCsv(csv, fromDoubles);
+  reduceEdges(fromDoubles);
+  QVERIFY(fromDoubles.findVertex("x")->getOutgoingEdges().front()->getValue() == Money::fromMinor(72));
+
+  // half cents are rounded as typed, not as their nearest double
+  istringstream halfCents("creditor,debtor,amount\nu,v,0.285\nu,w,1.005\n");
+  Multigraph<string, Money> typed;
+  importCsv(halfCents, typed);
+  QVERIFY(typed.findVertex("v")->getIncomingEdges().front()->getValue() == Money::fromMinor(29));
+  QVERIFY(typed.findVertex("w")->getIncomingEdges().front()->getValue() == Money::fromMinor(101));
+}
+
+void MDTests::currencyTest()
+{
+  Currency eur("EUR"), usd("USD"), gbp("GBP"), jpy("JPY");
+  QVERIFY(eur.getName() == "EUR" && eur.getCode() < Currency::codes && eur != usd && Currency().isNone());
+  QVERIFY(Currency::fromCode(gbp.getCode()) == gbp && Currency().getName().empty());
+  Currency parsed;
+  QVERIFY(!Currency::parse("eur", 3, parsed) && !Currency::parse("EURO", 4, parsed) && parsed.isNone());
+  QVERIFY_EXCEPTION_THROWN(Currency("E1R"), mg::Exception);
+
+  // amounts without a currency take the other one, different currencies don't mix
+  CurrencyAmount tenEuro(Money(10), eur);
+  QVERIFY(tenEuro + CurrencyAmount() == tenEuro && CurrencyAmount() - tenEuro == -tenEuro);
+  QVERIFY(tenEuro / CurrencyAmount(4) == CurrencyAmount(Money(2.5), eur) && CurrencyAmount(3) < tenEuro);
+  QVERIFY(CurrencyAmount(Money(10), usd) != tenEuro);
+  QVERIFY_EXCEPTION_THROWN(tenEuro + CurrencyAmount(Money(1), usd), mg::Exception);
+  QVERIFY_EXCEPTION_THROWN(tenEuro < CurrencyAmount(Money(1), usd), mg::Exception);
+
+  ostringstream os;
+  os << tenEuro << " " << CurrencyAmount(-3);
+  QVERIFY(os.str() == "10.00EUR -3.00");
+  istringstream is("12.5GBP 1e2USD 7 3.00eur");
+  CurrencyAmount a, b, c, d;
+  is >> a >> b >> c;
+  QVERIFY(!is.fail() && a == CurrencyAmount(Money(12.5), gbp) && b == CurrencyAmount(Money(100), usd)
+          && c == CurrencyAmount(7));
+  is >> d;
+  QVERIFY(is.fail());
+
+  RateTable rates;
+  istringstream table("# rates of one unit in euro\nbase EUR\n\nUSD 0.5\nGBP 1.25  # pound\n");
+  rates.load(table);
+  QVERIFY(rates.getBase() == eur && rates.size() == 3 && rates.getRate(usd) == 0.5 && !rates.hasRate(jpy));
+  QVERIFY(rates.convert(CurrencyAmount(Money(10), usd)) == Money(5) && rates.convert(CurrencyAmount(2)) == Money(2));
+  QVERIFY(rates.convert(CurrencyAmount(Money(3), gbp), usd) == CurrencyAmount(Money(7.5), usd));
+  QVERIFY_EXCEPTION_THROWN(rates.convert(CurrencyAmount(Money(1), jpy)), mg::Exception);
+
+  // bulk conversion rounds half away from zero, unknown currencies are reported
+  int64_t minor[] = {100, -101, 333, 0};
+  uint16_t codes[] = {usd.getCode(), usd.getCode(), gbp.getCode(), 0};
+  int64_t result[4];
+  QVERIFY(rates.convertMinor(minor, codes, 4, result, eur));
+  QVERIFY(result[0] == 50 && result[1] == -51 && result[2] == 416 && result[3] == 0);
+  codes[3] = jpy.getCode();
+  QVERIFY(!rates.convertMinor(minor, codes, 4, result));
+
+  rates.setBase(usd);
+  QVERIFY(rates.getRate(eur) == 2 && rates.getRate(usd) == 1 && rates.getRate(gbp) == 2.5);
+
+  istringstream badRate("USD abc\n"), badBase("base euro\n");
+  QVERIFY_EXCEPTION_THROWN(rates.load(badRate), mg::Exception);
+  QVERIFY_EXCEPTION_THROWN(rates.load(badBase), mg::Exception);
+  QVERIFY_EXCEPTION_THROWN(rates.loadFile("/nonexistent/rates.txt"), mg::Exception);
+}
+
+void MDTests::mgMultiCurrencyTest()
+{
+  Currency eur("EUR"), usd("USD"), gbp("GBP");
+  RateTable rates(eur);
+  rates.setRate(usd, 0.5);
+  rates.setRate(gbp, 1.25);
+
+  Multigraph<string, CurrencyAmount> graph;
+  for(const char* name: {"a", "b", "c"})
+    graph.addVertex(name);
+  graph.addEdge("a", "b", CurrencyAmount(Money(10), eur));
+  graph.addEdge("a", "b", CurrencyAmount(Money(20), usd));
+  graph.addEdge("b", "c", CurrencyAmount(Money(4), gbp));
+  graph.addEdge("c", "a", CurrencyAmount(2));
+  graph.addGroupExpense("c", CurrencyAmount(Money(30), usd), {"a", "b", "c"});
+
+  // in euro: a lent 10 + 10, owes 2 and 5 of the dinner; b owes 20 and 5, lent 5
+  vector<Money> before = balances(graph, rates);
+  QVERIFY(before.size() == 3 && before[0] == Money(13) && before[1] == Money(-20) && before[2] == Money(7));
+  QVERIFY_EXCEPTION_THROWN(balances(graph), mg::Exception);
+
+  vector<Transfer<string, CurrencyAmount> > transfers = greedySettlement(graph, rates);
+  QVERIFY(transfers.size() == 2 && transfers[0].amount == CurrencyAmount(Money(13), eur)
+          && transfers[0].creditor->getData() == "a" && transfers[0].debtor->getData() == "b");
+
+  // the .mg text keeps the currencies
+  ostringstream os;
+  os << graph;
+  Multigraph<string, CurrencyAmount> inDollars, inEuro, settled;
+  istringstream copy1(os.str()), copy2(os.str()), copy3(os.str());
+  copy1 >> inDollars;
+  copy2 >> inEuro;
+  copy3 >> settled;
+  QVERIFY(inDollars.getContentHash() == graph.getContentHash());
+
+  QVERIFY(convertCurrency(inDollars, rates, usd) == 3);
+  QVERIFY(balances(inDollars, rates) == before);
+  vector<CurrencyAmount> dollars = balances(inDollars);
+  QVERIFY(dollars[0] == CurrencyAmount(Money(26), usd) && dollars[2] == CurrencyAmount(Money(14), usd));
+
+  reduceEdges(inEuro, rates);
+  QVERIFY(inEuro.getEdgesCount() == 3 && inEuro.checkGraphInvariant());
+  QVERIFY(inEuro.findVertex("a")->getOutgoingEdges().front()->getValue() == CurrencyAmount(Money(20), eur));
+  QVERIFY(inEuro.getGroupExpenses().front().getTotal() == CurrencyAmount(Money(15), eur));
+  QVERIFY(balances(inEuro, rates) == before);
+
+  applySettlement(settled, greedySettlement(settled, rates));
+  QVERIFY(settled.getEdgesCount() == 2 && balances(settled, rates) == before);
+
+  rates = RateTable(eur);
+  QVERIFY_EXCEPTION_THROWN(balances(graph, rates), mg::Exception);
+}
+
+void MDTests::mgUndoHistoryTest()
+{
+  Multigraph<string, double> graph;
+  UndoHistory<string, double> history(graph, 3, 100);
+  QVERIFY(!history.canUndo() && !history.canRedo());
+
+  graph.addVertex("a");
+  graph.addVertex("b");
+  graph.addVertex("c");
+  graph.addEdge("a", "b", 10.);
+  {
+    UndoStep<string, double> step(history, "debts");
+    graph.addEdge("b", "c", 5.);
+    graph.addEdge("c", "a", 2.);
+    graph.addGroupExpense("a", 30., {"a", "b", "c"}, SPLIT_WEIGHTED, {1., 1., 2.});
+  }
+  uint64_t beforeDelete = graph.getContentHash();
+  QVERIFY(history.getUndoName() == "debts");
+
+  // deletion cascades to the edges and the group expense, one step reverts all of it
+  graph.deleteVertex("c");
+  QVERIFY(graph.getEdgesCount() == 1 && graph.getGroupExpenses().size() == 1);
+  history.undo();
+  QVERIFY(graph.getContentHash() == beforeDelete && graph.checkGraphInvariant());
+  QVERIFY(graph.getEdgesCount() == 3 && graph.getGroupExpenses().front().getParticipants().size() == 3);
+
+  history.redo();
+  QVERIFY(graph.findVertex("c") == NULL && !history.canRedo());
+  history.undo();
+
+  graph.addEdge("a", "b", 4.);
+  graph.addEdge("b", "a", 1.);
+  uint64_t beforeReduce = graph.getContentHash();
+  {
+    UndoStep<string, double> step(history, "reduce");
+    reduceEdges(graph);
+  }
+  QVERIFY(graph.getEdgesCount() == 3);
+  history.undo();
+  QVERIFY(graph.getContentHash() == beforeReduce && history.getRedoName() == "reduce");
+  history.undo();
+  history.undo();
+  QVERIFY(graph.getContentHash() == beforeDelete);
+
+  // a new change drops redo, old steps are forgotten past the limit
+  graph.clear();
+  QVERIFY(!history.canRedo() && graph.getVertexes().empty());
+  history.undo();
+  QVERIFY(graph.getContentHash() == beforeDelete);
+  // only three steps are kept, the graph returns to the state after "debts"
+  QVERIFY(!history.canUndo() && graph.getEdgesCount() == 3);
+
+  for(int i = 0; i < 150; i++)
+    graph.addEdge("a", "b", i);
+  QVERIFY(history.getMutationsCount() <= 100);
+  {
+    UndoStep<string, double> step(history, "too big");
+    for(int i = 0; i < 150; i++)
+      graph.deleteEdge("a", "b", i);
+  }
+  QVERIFY(!history.canUndo() && history.getMutationsCount() == 0);
+}
+
+void MDTests::mgCycleCancellationTest()
+{
+  Multigraph<string, double> graph;
+  for(const char* name : {"a", "b", "c", "d", "e"})
+    graph.addVertex(name);
+  graph.addEdge("a", "b", 10.);
+  graph.addEdge("b", "c", 4.);
+  graph.addEdge("c", "a", 6.);
+  graph.addEdge("c", "d", 3.);
+  graph.addEdge("d", "e", 2.);
+  graph.addEdge("e", "d", 5.);
+
+  vector<size_t> ids = stronglyConnectedComponents(graph);
+  QVERIFY(ids[0] == ids[1] && ids[1] == ids[2] && ids[3] == ids[4] && ids[0] != ids[3]);
+
+  vector<double> before = balances(graph);
+  ThreadPool pool(4);
+  CycleCancellation<double> result = cancelCycles(graph, 0., pool);
+  QVERIFY(result.cycles == 2 && result.removedEdges == 2 && result.cancelled == 12. + 4.);
+  QVERIFY(balances(graph) == before && graph.getEdgesCount() == 4 && graph.checkGraphInvariant());
+
+  // a random ledger ends up acyclic: every component is a single vertex
+  GeneratorOptions options;
+  options.vertexes = 300;
+  options.edges = 3000;
+  options.communities = 6;
+  Multigraph<string, double> ledger;
+  generateGraph(ledger, options);
+  before = balances(ledger);
+
+  result = cancelCycles(ledger, 1e-9, pool);
+  QVERIFY(result.cycles > 0 && ledger.getEdgesCount() < 3000);
+  vector<double> after = balances(ledger);
+  for(size_t i = 0; i < before.size(); i++)
+    QVERIFY(fabs(before[i] - after[i]) < 1e-6);
+
+  ids = stronglyConnectedComponents(ledger);
+  sort(ids.begin(), ids.end());
+  QVERIFY(unique(ids.begin(), ids.end()) == ids.end());
+}
+
+void MDTests::expressionCacheTest()
+{
+  ExpressionCache expressions;
+  int error = 0;
+
+  QVERIFY(expressions.evaluate("120/3", NULL, &error) == 40. && error == 0);
+  QVERIFY(expressions.evaluate("120/3") == 40.);
+  QVERIFY(expressions.size() == 1);
+
+  double value = expressions.evaluate("120/", NULL, &error);
+  QVERIFY(value != value && error != 0);
+  QVERIFY(expressions.size() == 1);
+
+  expressions.setVariables({"price", "qty"});
+  double values[] = {2.5, 4};
+  QVERIFY(expressions.evaluate("price*qty", values, &error) == 10. && error == 0);
+}
+
+void MDTests::expressionBatchTest()
+{
+  ExpressionCache expressions;
+  expressions.setVariables({"price", "qty"});
+
+  double prices[] = {1, 2.5, 10};
+  double quantities[] = {3, 2, 0.5};
+  double results[3];
+
+  QVERIFY(expressions.evaluateBatch("price*qty+1", {prices, quantities}, 3, results));
+  QVERIFY(results[0] == 4. && results[1] == 6. && results[2] == 6.);
+  QVERIFY(!expressions.evaluateBatch("price*", {prices, quantities}, 3, results));
+}
+
+void MDTests::tinyexprProgramTest()
+{
+  double x = 0, y = 0;
+  te_variable variables[] = {{"x", &x, TE_VARIABLE, NULL}, {"y", &y, TE_VARIABLE, NULL}};
+  const char* expressions[] = {"x*y+1", "120/3", "-x^2+sqrt(y)*(x-y)/3", "atan2(x,y)+pow(x,2)", "(x,y)"};
+
+  const int rows = 100;
+  double xs[rows], ys[rows], results[rows];
+  for(int i = 0; i < rows; i++)
+  {
+    xs[i] = i * 0.37 + 1;
+    ys[i] = (i % 17) * 1.3 + 0.5;
+  }
+  const double* bindings[] = {&x, &y};
+  const double* columns[] = {xs, ys};
+
+  for(const char* expression : expressions)
+  {
+    int error = 0;
+    te_expr* tree = te_compile(expression, variables, 2, &error);
+    QVERIFY(tree && error == 0);
+    te_program* program = te_lower(tree);
+    QVERIFY(program);
+
+    te_run_batch(program, bindings, columns, 2, rows, results);
+    for(int i = 0; i < rows; i++)
+    {
+      x = xs[i];
+      y = ys[i];
+      double expected = te_eval(tree);
+      double scalar = te_run(program);
+      QVERIFY(memcmp(&expected, &scalar, sizeof(double)) == 0);
+      QVERIFY(memcmp(&expected, &results[i], sizeof(double)) == 0);
+    }
+
+    te_program_free(program);
+    te_free(tree);
+  }
+}
+
+void MDTests::concurrentMultigraphTest()
+{
+  const int writers = 4, batches = 50, batchSize = 20;
+  ConcurrentMultigraph<string, double> graph;
+  graph.addVertex("bank");
+
+  atomic<bool> done(false);
+  atomic<bool> consistent(true);
+  thread reader([&]()
+  {
+    size_t last = 0;
+    while(!done)
+    {
+      size_t edges = graph.read([](const Multigraph<string, double>& g) {return g.getEdgesCount();});
+      if(edges < last || edges % batchSize || !graph.hasVertex("bank"))
+        consistent = false;
+      last = edges;
+    }
+  });
+
+  vector<thread> ingest;
+  for(int w = 0; w < writers; w++)
+    ingest.push_back(thread([&graph, w]()
+    {
+      for(int b = 0; b < batches; b++)
+      {
+        vector<EdgeRecord<string, double> > batch;
+        for(int i = 0; i < batchSize; i++)
+          batch.push_back(EdgeRecord<string, double>("bank", "client" + to_string(w * 1000 + i), 1.));
+        graph.addEdges(batch);
+      }
+    }));
+  for(auto i = ingest.begin(); i != ingest.end(); ++i)
+    i->join();
+  done = true;
+  reader.join();
+
+  QVERIFY(consistent);
+  QVERIFY(graph.getEdgesCount() == static_cast<size_t>(writers * batches * batchSize));
+  QVERIFY(graph.getVertexesCount() == static_cast<size_t>(writers * batchSize + 1));
+  QVERIFY(graph.write([](Multigraph<string, double>& g) {return g.checkGraphInvariant();}));
+
+  vector<EdgeRecord<string, double> > rejected;
+  rejected.push_back(EdgeRecord<string, double>("bank", "bank", 1.));
+  rejected.push_back(EdgeRecord<string, double>("bank", "stranger", 1.));
+  QVERIFY(graph.addEdges(rejected, false) == 0 && !graph.hasVertex("stranger"));
+  QVERIFY(graph.tryAddEdge("bank", "stranger", 1.) == MG_DST_VERTEX_NOT_FOUND);
+}
+
+void MDTests::ringBufferTest()
+{
+  MpscRingBuffer<int> queue(3);
+  QVERIFY(queue.capacity() == 4);
+
+  int value = 0;
+  QVERIFY(!queue.tryPop(value));
+  for(int i = 1; i <= 4; i++)
+    QVERIFY(queue.tryPush(i));
+  value = 5;
+  QVERIFY(!queue.tryPush(value) && value == 5);
+
+  QVERIFY(queue.tryPop(value) && value == 1);
+  value = 5;
+  QVERIFY(queue.tryPush(value));
+
+  vector<int> batch;
+  QVERIFY(queue.popBatch(batch, 3) == 3 && queue.popBatch(batch, 10) == 1);
+  QVERIFY((batch == vector<int>{2, 3, 4, 5}));
+}
+
+void MDTests::edgeIngestorTest()
+{
+  const int producers = 4, records = 5000;
+  ConcurrentMultigraph<string, double> graph;
+  {
+    EdgeIngestor<string, double> ingestor(graph, 256, 64);
+    vector<thread> threads;
+    for(int p = 0; p < producers; p++)
+      threads.push_back(thread([&ingestor, p]()
+      {
+        for(int i = 0; i < records; i++)
+          ingestor.enqueue("producer" + to_string(p), "person" + to_string(i % 100), 1.);
+      }));
+    for(auto i = threads.begin(); i != threads.end(); ++i)
+      i->join();
+
+    ingestor.flush();
+    QVERIFY(ingestor.getApplied() == static_cast<size_t>(producers * records) && ingestor.getRejected() == 0);
+    QVERIFY(graph.getEdgesCount() == static_cast<size_t>(producers * records));
+
+    ingestor.enqueue("producer0", "producer0", 1.);
+    QVERIFY(ingestor.tryEnqueue("producer0", "late", 2.));
+  }
+  QVERIFY(graph.getEdgesCount() == static_cast<size_t>(producers * records + 1));
+  QVERIFY(graph.getVertexesCount() == static_cast<size_t>(producers + 101));
+}
+
+void MDTests::persistentVectorTest()
+{
+  PersistentVector<int> values;
+  for(int i = 0; i < 2000; i++)
+    values.pushBack(i);
+
+  PersistentVector<int> copy = values;
+  values.set(1500, -1);
+  values.pushBack(2000);
+
+  QVERIFY(values.size() == 2001 && copy.size() == 2000);
+  QVERIFY(values[1500] == -1 && copy[1500] == 1500 && values[1499] == 1499 && values[2000] == 2000);
+
+  long long sum = 0;
+  copy.forEach([&sum](int i) {sum += i;});
+  QVERIFY(sum == 1999LL * 2000 / 2);
+}
+
+void MDTests::graphSnapshotTest()
+{
+  VersionedMultigraph<string, double> graph;
+  graph.addVertex("a");
+  graph.addVertex("b");
+  graph.addVertex("c");
+  graph.addEdge("a", "b", 10.);
+  graph.addEdge("b", "c", 5.);
+  graph.addGroupExpense("a", 30., {"a", "b", "c"});
+
+  GraphSnapshot<string, double> before = graph.snapshot();
+  ostringstream beforeText;
+  beforeText << graph.getGraph();
+
+  graph.addEdge("c", "a", 1.);
+  QVERIFY(graph.tryDeleteEdge("a", "b", 10.) == MG_OK);
+  QVERIFY(graph.tryDeleteEdge("a", "b", 10.) == MG_EDGE_NOT_FOUND);
+  graph.deleteVertex("b");
+  GraphSnapshot<string, double> after = graph.snapshot();
+  ostringstream afterText;
+  afterText << graph.getGraph();
+
+  QVERIFY(before.getVertexesCount() == 3 && before.getEdgesCount() == 2 && before.getGroupExpensesCount() == 1);
+  QVERIFY(after.getVertexesCount() == 2 && after.getEdgesCount() == 1 && after.getVersion() > before.getVersion());
+  QVERIFY(after.getContentHash() == graph.getGraph().getContentHash());
+
+  ostringstream snapshotText;
+  snapshotText << before;
+  QVERIFY(snapshotText.str() == beforeText.str());
+  // the group expense lost a participant in its own slot
+  ostringstream afterSnapshotText;
+  afterSnapshotText << after;
+  QVERIFY(after.getGroupExpensesCount() == 1 && afterSnapshotText.str() == afterText.str());
+
+  Multigraph<string, double> restored;
+  before.restore(restored);
+  QVERIFY(restored.getContentHash() == before.getContentHash() && restored.checkGraphInvariant());
+
+  // tombstones are compacted away, snapshots taken earlier keep their storage
+  for(int i = 0; i < 3000; i++)
+  {
+    graph.addEdge("a", "c", i);
+    graph.deleteEdge("a", "c", i);
+  }
+  QVERIFY(after.getEdgesCount() == 1 && graph.snapshot().getEdgesCount() == 1);
+  size_t edges = 0;
+  after.forEachEdge([&edges](const string& src, const string& dst, double value)
+  {
+    edges += src == "c" && dst == "a" && value == 1.;
+  });
+  QVERIFY(edges == 1);
+
+  // records the deleted vertex paid are dropped, the others lose it
+  graph.addGroupExpense("c", 4., {"a", "c"});
+  QVERIFY(graph.snapshot().getGroupExpensesCount() == 2);
+  graph.deleteVertex("c");
+  GraphSnapshot<string, double> last = graph.snapshot();
+  QVERIFY(last.getGroupExpensesCount() == 1 && after.getGroupExpensesCount() == 1);
+  Multigraph<string, double> lastRestored;
+  last.restore(lastRestored);
+  QVERIFY(lastRestored.getContentHash() == graph.getGraph().getContentHash());
+}
+
+void MDTests::csvImportTest()
+{
+  string csv = "creditor,debtor,amount\n"
+               "Vert1,Vert2,10.5\n"
+               "\"Vert 1\",\"Vert\"\"3\"\"\",120/3\r\n"
+               "Vert2,Vert2,1\n"
+               "Loop,Loop,5\n"
+               "Vert2,Vert1,abc\n"
+               "short,row\n"
+               "Vert3,Vert1, 2*3 \n";
+
+  // tiny chunks make rows cross chunk borders
+  CsvImportOptions options;
+  options.chunkSize = 7;
+  ThreadPool pool(2);
+
+  Multigraph<string, float> graph;
+  istringstream input(csv);
+  CsvImportResult result = importCsv(input, graph, options, pool);
+
+  QVERIFY(result.rows == 8 && result.imported == 3);
+  QVERIFY(result.failedRows == vector<size_t>({4, 5, 6, 7}));
+  QVERIFY(graph.findVertex("Vert_1") && graph.findVertex("Vert\"3\"") && !graph.findVertex("Loop"));
+  QVERIFY(graph.findVertex("Vert_1")->getOutgoingEdges().front()->getValue() == 40.f);
+  QVERIFY(graph.findVertex("Vert3")->getOutgoingEdges().front()->getValue() == 6.f);
+  QVERIFY(graph.getEdgesCount() == 3 && graph.checkGraphInvariant());
+}
+
+void MDTests::exceptionMessageTest()
+{
+  string longText(300, 'x');
+  mg::Exception shortException("Vertex already exist!", 7, "addVertex", "today");
+  mg::Exception longException(longText, 8, "addEdge", "today");
+
+  // every thread gets the same message, formatted once
+  vector<future<const char*> > messages;
+  for(int i = 0; i < 4; i++)
+    messages.push_back(async(launch::async, [&shortException]() {return shortException.what();}));
+  for(auto i = messages.begin(); i != messages.end(); ++i)
+    QVERIFY(i->get() == shortException.what());
+
+  QVERIFY(string(shortException.what()) ==
+          "mg::Exception\n\"Vertex already exist!\" in function \"addVertex\" in line: 7. Build from: today");
+  QVERIFY(string(longException.getText()) == longText.substr(0, 127));
+
+  mg::Exception copy(shortException);
+  QVERIFY(string(copy.what()) == shortException.what() && copy.what() != shortException.what());
+}
+
+void MDTests::generatorTest()
+{
+  GeneratorOptions options;
+  options.vertexes = 200;
+  options.edges = 3000;
+  options.communities = 4;
+  options.parallelEdgeRate = 0.2;
+  options.reverseDebtRate = 0.1;
+
+  Multigraph<string, double> graph;
+  Multigraph<string, double> same;
+  generateGraph(graph, options);
+  generateGraph(same, options);
+  QVERIFY(graph.getEdgesCount() == 3000 && graph.getVertexes().size() == 200);
+  QVERIFY(graph.getContentHash() == same.getContentHash() && graph.checkGraphInvariant());
+
+  // the fast writer produces the same ledger
+  ostringstream _ostream;
+  writeGeneratedMg(_ostream, options);
+  Multigraph<string, double> read;
+  istringstream _istream(_ostream.str());
+  _istream >> read;
+  QVERIFY(read.getContentHash() == graph.getContentHash());
+
+  // power law: the first person of a community has the most debts
+  size_t first = graph.findVertex("person0")->getOutgoingEdges().size();
+  size_t last = graph.findVertex("person49")->getOutgoingEdges().size();
+  QVERIFY(first > 4 * last);
+
+  options.seed = 2;
+  Multigraph<string, double> other;
+  generateGraph(other, options);
+  QVERIFY(other.getContentHash() != graph.getContentHash());
+}
+
+void MDTests::statsTest()
+{
+  resetStats();
+  Multigraph<string, float> graph;
+  graph.addVertex("Vert1");
+  graph.addVertex("Vert2");
+  graph.addEdge("Vert1", "Vert2", 1.f);
+  QVERIFY(graph.tryAddVertex("Vert1") == MG_VERTEX_ALREADY_EXISTS);
+  graph.deleteVertex("Vert2");
+
+  StatsSnapshot snapshot = statsSnapshot();
+  if(!statsEnabled())
+  {
+    QVERIFY(snapshot.counters[STATS_VERTEX_LOOKUPS] == 0 && snapshot.timers[TIMER_ADD_VERTEX].calls == 0);
+    return;
+  }
+
+  QVERIFY(snapshot.counters[STATS_VERTEX_ALLOCATIONS] == 2 && snapshot.counters[STATS_VERTEX_RETURNS] == 1);
+  QVERIFY(snapshot.counters[STATS_EDGE_ALLOCATIONS] == 1 && snapshot.counters[STATS_EDGE_RETURNS] == 1);
+  QVERIFY(snapshot.counters[STATS_VERTEX_LOOKUPS] >= 5 && snapshot.counters[STATS_ADJACENCY_SCANS] == 2);
+  QVERIFY(snapshot.timers[TIMER_ADD_VERTEX].calls == 3 && snapshot.timers[TIMER_DELETE_VERTEX].calls == 1);
+  QVERIFY(snapshot.timers[TIMER_ADD_EDGE].maxNs <= snapshot.timers[TIMER_ADD_EDGE].totalNs);
+
+  resetStats();
+  QVERIFY(statsSnapshot().counters[STATS_VERTEX_ALLOCATIONS] == 0);
+}
+
+void MDTests::traceTest()
+{
+  string path = "tst_mdtests_trace.json";
+  Tracer tracer;
+  tracer.addEvent("ignored", 0, 1);
+  QVERIFY(tracer.start(path) && tracer.isRecording());
+  tracer.addEvent("first \"stage\"", 10, 5);
+  thread([&tracer]() {tracer.addEvent("second", 12, 2);}).join();
+  tracer.stop();
+  tracer.addEvent("ignored", 20, 1);
+
+  ifstream input(path);
+  string text((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+  input.close();
+  remove(path.c_str());
+
+  QVERIFY(text.front() == '[' && text.find(']') != string::npos);
+  QVERIFY(text.find("{\"name\":\"first \\\"stage\\\"\",\"cat\":\"md\",\"ph\":\"X\",\"ts\":10,\"dur\":5") != string::npos);
+  QVERIFY(text.find("\"name\":\"second\"") != string::npos && text.find("ignored") == string::npos);
+  QVERIFY(!tracer.isRecording());
 }
 
 
@@ -0,0 +1,94 @@
+#include "generator.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+
+namespace
+{
+  void usage()
+  {
+    std::cerr << "Usage: mggen [options] output.mg  (- writes to stdout)\n"
+                 "  --vertexes N      persons, default 1000\n"
+                 "  --edges N         debts, default 10000\n"
+                 "  --seed N          default 1\n"
+                 "  --exponent X      power-law degree exponent, 0 for uniform, default 2.5\n"
+                 "  --communities N   default 1\n"
+                 "  --mixing X        share of debts between communities, default 0.1\n"
+                 "  --parallel X      share of parallel edges, default 0.05\n"
+                 "  --reverse X       share of reverse debts, default 0.05\n"
+                 "  --min X --max X   amount bounds, default 1 and 1000\n";
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  mg::GeneratorOptions options;
+  const char* path = NULL;
+
+  for(int i = 1; i < argc; i++)
+  {
+    const char* name = argv[i];
+    if(name[0] != '-' || !std::strcmp(name, "-"))
+    {
+      path = name;
+      continue;
+    }
+    if(i + 1 == argc)
+    {
+      usage();
+      return 1;
+    }
+
+    const char* value = argv[++i];
+    if(!std::strcmp(name, "--vertexes")) options.vertexes = std::strtoull(value, NULL, 10);
+    else if(!std::strcmp(name, "--edges")) options.edges = std::strtoull(value, NULL, 10);
+    else if(!std::strcmp(name, "--seed")) options.seed = std::strtoull(value, NULL, 10);
+    else if(!std::strcmp(name, "--exponent")) options.degreeExponent = std::atof(value);
+    else if(!std::strcmp(name, "--communities")) options.communities = std::strtoull(value, NULL, 10);
+    else if(!std::strcmp(name, "--mixing")) options.communityMixing = std::atof(value);
+    else if(!std::strcmp(name, "--parallel")) options.parallelEdgeRate = std::atof(value);
+    else if(!std::strcmp(name, "--reverse")) options.reverseDebtRate = std::atof(value);
+    else if(!std::strcmp(name, "--min")) options.minAmount = std::atof(value);
+    else if(!std::strcmp(name, "--max")) options.maxAmount = std::atof(value);
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+
+  if(!path)
+  {
+    usage();
+    return 1;
+  }
+
+  try
+  {
+    auto started = std::chrono::steady_clock::now();
+    if(!std::strcmp(path, "-"))
+      mg::writeGeneratedMg(std::cout, options);
+    else
+    {
+      std::ofstream output(path, std::ios::binary);
+      if(!output.is_open())
+      {
+        std::cerr << "Can't open file \"" << path << "\"\n";
+        return 1;
+      }
+      mg::writeGeneratedMg(output, options);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+    std::cerr << options.edges << " edges in " << elapsed.count() << " s\n";
+  }
+  catch(std::exception& e)
+  {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
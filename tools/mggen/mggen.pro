@@ -0,0 +1,25 @@
+#-------------------------------------------------
+#
+# Synthetic ledger generator, writes .mg files
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = mggen
+CONFIG   += console
+CONFIG   -= app_bundle qt
+
+TEMPLATE = app
+
+
+SOURCES += main.cpp \
+    ../../src/generator.cpp \
+    ../../src/mgexception.cpp
+
+HEADERS += \
+    ../../src/generator.h \
+    ../../src/multigraph.h \
+    ../../src/mgexception.h
+
+INCLUDEPATH += ../../src/
@@ -0,0 +1,250 @@
+#include "multigraph.h"
+#include "reduction.h"
+#include "cycles.h"
+#include "settlement.h"
+#include "flowsettlement.h"
+#include "balance.h"
+#include "threadpool.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <deque>
+#include <future>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <stdexcept>
+
+namespace
+{
+  typedef mg::Multigraph<std::string, double> Graph;
+
+  struct Options
+  {
+    Options(): reduce(false), cancelCycles(false), settle(false), exact(false), constrained(false), writeBalances(false), writeDot(false),
+      outputDir("."), threads(0), epsilon(1e-9), componentsPool(NULL) {}
+
+    bool reduce;
+    bool cancelCycles;
+    bool settle;
+    bool exact;
+    bool constrained;
+    bool writeBalances;
+    bool writeDot;
+    std::string outputDir;
+    size_t threads;
+    double epsilon;
+    /// Components of one graph are processed here, workers of the files pool wait for them
+    mg::ThreadPool* componentsPool;
+  };
+
+  struct Report
+  {
+    Report(): succeeded(false), vertexes(0), edgesBefore(0), edgesAfter(0) {}
+
+    std::string path;
+    bool succeeded;
+    std::string error;
+    size_t vertexes;
+    size_t edgesBefore;
+    size_t edgesAfter;
+  };
+
+  void usage()
+  {
+    std::cerr << "Usage: multidiner-cli [options] files.mg...\n"
+                 "Every file is loaded and validated, then processed in the order below.\n"
+                 "  --reduce          merge parallel edges and cancel mutual debts\n"
+                 "  --cancel-cycles   cancel debt cycles of any length\n"
+                 "  --settle          replace debts with greedy settlement transfers\n"
+                 "  --exact           settle with the fewest transfers, greedily above 20 persons\n"
+                 "  --constrained     settle along existing debts only, least total amount moved\n"
+                 "  --balances        write <name>.balances.csv\n"
+                 "  --dot             write <name>.dot\n"
+                 "  -o DIR            output directory, default is the current one\n"
+                 "  -j N              worker threads, default is the number of cores\n"
+                 "  --epsilon X       balances below it are settled, default 1e-9\n"
+                 "Processed graphs are written as <name>.reduced.mg, <name>.acyclic.mg\n"
+                 "or <name>.settled.mg, named after the last step.\n";
+  }
+
+  // file name without directories and the .mg extension
+  std::string stem(const std::string& path)
+  {
+    size_t slash = path.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    if(name.size() > 3 && name.compare(name.size() - 3, 3, ".mg") == 0)
+      name.resize(name.size() - 3);
+    return name;
+  }
+
+  void writeFile(const std::string& path, const std::string& text)
+  {
+    std::ofstream output(path.c_str(), std::ios::binary);
+    if(!output.is_open())
+      throw std::runtime_error("Can't open file \"" + path + "\"!");
+    output.write(text.data(), text.size());
+  }
+
+  /// Runs on a worker thread, every file has its own graph
+  struct ProcessFile
+  {
+    ProcessFile(const std::string& path, const Options& options): path(path), options(options) {}
+
+    Report operator()() const
+    {
+      Report report;
+      report.path = path;
+      try
+      {
+        Graph graph;
+        std::ifstream input(path.c_str(), std::ios::binary);
+        if(!input.is_open())
+          throw std::runtime_error("Can't open file \"" + path + "\"!");
+        // a record that can't be read, or fewer records than the file declares, fail the stream
+        input >> graph;
+        if(input.fail())
+          throw std::runtime_error("Malformed file \"" + path + "\"!");
+        if(!graph.checkGraphInvariant())
+          throw std::runtime_error("Graph invariant is broken!");
+
+        report.vertexes = graph.getVertexes().size();
+        report.edgesBefore = graph.getEdgesCount();
+
+        std::string base = options.outputDir + "/" + stem(path);
+        std::string suffix;
+        if(options.reduce)
+        {
+          mg::reduceEdges(graph);
+          suffix = ".reduced";
+        }
+        if(options.cancelCycles)
+        {
+          mg::cancelCycles(graph, options.epsilon, *options.componentsPool);
+          suffix = ".acyclic";
+        }
+        if(options.settle)
+        {
+          if(options.constrained)
+            mg::applySettlement(graph, mg::flowSettlement(graph, options.epsilon));
+          else if(options.exact)
+            mg::applySettlement(graph, mg::exactSettlement(graph, options.epsilon, 20, *options.componentsPool));
+          else
+            mg::applySettlement(graph, mg::greedySettlement(graph, options.epsilon));
+          suffix = ".settled";
+        }
+        if(!suffix.empty())
+        {
+          std::ostringstream text;
+          text << graph;
+          writeFile(base + suffix + ".mg", text.str());
+        }
+
+        if(options.writeBalances)
+        {
+          std::ostringstream text;
+          text << "person,balance\n" << std::fixed << std::setprecision(2);
+          std::vector<double> vertexBalances = mg::balances(graph);
+          const auto& vertexes = graph.getVertexes();
+          size_t position = 0;
+          for(auto i = vertexes.begin(); i != vertexes.end(); ++i, ++position)
+            text << (*i)->getData() << "," << vertexBalances[position] << "\n";
+          writeFile(base + ".balances.csv", text.str());
+        }
+
+        if(options.writeDot)
+          writeFile(base + ".dot", graph.dotText());
+
+        report.edgesAfter = graph.getEdgesCount();
+        report.succeeded = true;
+      }
+      catch(std::exception& e)
+      {
+        report.error = e.what();
+      }
+      return report;
+    }
+
+    std::string path;
+    Options options;
+  };
+
+  void print(const Report& report)
+  {
+    if(report.succeeded)
+      std::cout << report.path << ": ok, " << report.vertexes << " persons, "
+                << report.edgesBefore << " -> " << report.edgesAfter << " edges\n";
+    else
+      std::cout << report.path << ": failed\n" << report.error << "\n";
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  Options options;
+  std::vector<std::string> paths;
+
+  for(int i = 1; i < argc; i++)
+  {
+    const char* name = argv[i];
+    bool hasValue = i + 1 < argc;
+    if(!std::strcmp(name, "--reduce")) options.reduce = true;
+    else if(!std::strcmp(name, "--cancel-cycles")) options.cancelCycles = true;
+    else if(!std::strcmp(name, "--settle")) options.settle = true;
+    else if(!std::strcmp(name, "--exact")) options.settle = options.exact = true;
+    else if(!std::strcmp(name, "--constrained")) options.settle = options.constrained = true;
+    else if(!std::strcmp(name, "--balances")) options.writeBalances = true;
+    else if(!std::strcmp(name, "--dot")) options.writeDot = true;
+    else if(!std::strcmp(name, "-o") && hasValue) options.outputDir = argv[++i];
+    else if(!std::strcmp(name, "-j") && hasValue) options.threads = std::strtoull(argv[++i], NULL, 10);
+    else if(!std::strcmp(name, "--epsilon") && hasValue) options.epsilon = std::atof(argv[++i]);
+    else if(name[0] == '-')
+    {
+      usage();
+      return 1;
+    }
+    else
+      paths.push_back(name);
+  }
+
+  if(paths.empty())
+  {
+    usage();
+    return 1;
+  }
+
+  auto started = std::chrono::steady_clock::now();
+  mg::ThreadPool pool(options.threads);
+  mg::ThreadPool componentsPool(options.threads);
+  options.componentsPool = &componentsPool;
+
+  // a bounded window of files in flight, reports are printed in input order
+  std::deque<std::future<Report> > inFlight;
+  const size_t maxInFlight = pool.size() * 4;
+  size_t failed = 0;
+  auto printFront = [&]()
+  {
+    Report report = inFlight.front().get();
+    inFlight.pop_front();
+    print(report);
+    failed += report.succeeded ? 0 : 1;
+  };
+
+  for(auto i = paths.begin(); i != paths.end(); ++i)
+  {
+    if(inFlight.size() >= maxInFlight)
+      printFront();
+    inFlight.push_back(pool.submit(ProcessFile(*i, options)));
+  }
+  while(!inFlight.empty())
+    printFront();
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+  std::cerr << paths.size() << " files, " << failed << " failed, "
+            << pool.size() << " threads, " << elapsed.count() << " s\n";
+  return failed ? 1 : 0;
+}
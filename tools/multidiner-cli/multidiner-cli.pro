@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# Headless batch processing of .mg files
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = multidiner-cli
+CONFIG   += console
+CONFIG   -= app_bundle qt
+
+TEMPLATE = app
+
+
+SOURCES += main.cpp \
+    ../../src/mgexception.cpp
+
+HEADERS += \
+    ../../src/multigraph.h \
+    ../../src/reduction.h \
+    ../../src/cycles.h \
+    ../../src/settlement.h \
+    ../../src/flowsettlement.h \
+    ../../src/balance.h \
+    ../../src/threadpool.h \
+    ../../src/mgexception.h
+
+INCLUDEPATH += ../../src/
+
+unix: LIBS += -lpthread